@@ -0,0 +1,137 @@
+/*
+ * Shared inputs for the cron micro-benchmarks.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "cron/date.hh"
+#include "cron/time.hh"
+
+namespace cron {
+namespace bench {
+
+//------------------------------------------------------------------------------
+
+/*
+ * Number of distinct inputs each benchmark cycles through.  Large enough to
+ * defeat branch prediction on the input values, small enough to stay in L1.
+ */
+size_t constexpr NUM_INPUTS = 4096;
+
+/*
+ * A small, deterministic pseudorandom generator, so that runs are comparable.
+ */
+class Random
+{
+public:
+
+  Random(uint64_t seed=0x2545f4914f6cdd1d) : state_(seed) {}
+
+  uint64_t
+  next()
+  {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545f4914f6cdd1dull;
+  }
+
+  /*
+   * Returns a value in the closed range [`min`, `max`].
+   */
+  int64_t
+  next(
+    int64_t const min,
+    int64_t const max)
+  {
+    return min + (int64_t) (next() % (uint64_t) (max - min + 1));
+  }
+
+private:
+
+  uint64_t state_;
+
+};
+
+
+/*
+ * Returns datenums uniformly distributed in [`min`, `max`].
+ */
+inline std::vector<Datenum>
+make_datenums(
+  Datenum const min=DATENUM_MIN,
+  Datenum const max=DATENUM_MAX)
+{
+  Random random;
+  std::vector<Datenum> datenums(NUM_INPUTS);
+  for (auto& datenum : datenums)
+    datenum = (Datenum) random.next(min, max);
+  return datenums;
+}
+
+
+/*
+ * Returns valid dates of type `DATE`, covering the years 1970-2149, which every
+ * date type can represent.
+ */
+template<class DATE>
+inline std::vector<DATE>
+make_dates()
+{
+  std::vector<DATE> dates;
+  dates.reserve(NUM_INPUTS);
+  for (auto const datenum : make_datenums(719162, 719162 + 65000))
+    dates.push_back(DATE::from_datenum(datenum));
+  return dates;
+}
+
+
+/*
+ * Returns valid times of type `TIME`, covering 1970-01-01 to 2038-01-19, which
+ * every time type can represent, with random subsecond parts.
+ */
+template<class TIME>
+inline std::vector<TIME>
+make_times()
+{
+  Random random;
+  std::vector<TIME> times;
+  times.reserve(NUM_INPUTS);
+  for (size_t i = 0; i < NUM_INPUTS; ++i) {
+    struct timespec const ts{
+      (time_t) random.next(0, 0x7ffffffe), (long) random.next(0, 999999999)};
+    times.push_back(TIME::from_offset(timespec_to_offset<TIME>(ts)));
+  }
+  return times;
+}
+
+
+/*
+ * Returns times of type `TIME`, increasing monotonically by roughly a
+ * millisecond each, as in a log file.
+ */
+template<class TIME>
+inline std::vector<TIME>
+make_sequential_times()
+{
+  Random random;
+  std::vector<TIME> times;
+  times.reserve(NUM_INPUTS);
+  struct timespec const ts{1374863198, 0};
+  auto offset = timespec_to_offset<TIME>(ts);
+  for (size_t i = 0; i < NUM_INPUTS; ++i) {
+    times.push_back(TIME::from_offset(offset));
+    offset += TIME::DENOMINATOR / 1000 + random.next(0, 1);
+  }
+  return times;
+}
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace bench
+}  // namespace cron
+
@@ -0,0 +1,180 @@
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "cron/calendar.hh"
+
+#include "bench.hh"
+
+using namespace cron;
+using namespace cron::bench;
+
+namespace {
+
+/*
+ * Returns a workday calendar with a few fixed holidays each year, including
+ * `month` and `day`, from 1970 through 2199.
+ */
+WorkdayCalendar
+make_workday_calendar(
+  Month const month=6,
+  Day const day=3)
+{
+  std::vector<Date> holidays;
+  for (Year year = 1970; year < 2200; ++year) {
+    holidays.push_back(Date::from_ymd(year,  0,  0));
+    holidays.push_back(Date::from_ymd(year, month, day));
+    holidays.push_back(Date::from_ymd(year, 11, 24));
+  }
+  return WorkdayCalendar(
+    WeekdaysCalendar({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY}),
+    HolidayCalendar(
+      Date::from_ymd(1970, 0, 0), Date::from_ymd(2200, 0, 0), holidays));
+}
+
+
+}  // anonymous namespace
+
+//------------------------------------------------------------------------------
+// Class WeekdaysCalendar
+//------------------------------------------------------------------------------
+
+static void
+BM_WeekdaysCalendar_shift(
+  benchmark::State& state)
+{
+  WeekdaysCalendar const cal({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY});
+  auto const dates = make_dates<Date>();
+  ssize_t const shift = state.range(0);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cal.shift(dates[i], shift));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_WeekdaysCalendar_shift)->Arg(1)->Arg(250);
+
+
+static void
+BM_WeekdaysCalendar_contains_array(
+  benchmark::State& state)
+{
+  WeekdaysCalendar const cal({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY});
+  auto const dates = make_dates<Date>();
+  std::unique_ptr<bool[]> contained(new bool[NUM_INPUTS]);
+  for (auto _ : state)
+    cal.contains(dates.data(), NUM_INPUTS, contained.get());
+  state.SetItemsProcessed(state.iterations() * NUM_INPUTS);
+}
+
+BENCHMARK(BM_WeekdaysCalendar_contains_array);
+
+
+//------------------------------------------------------------------------------
+// Class WorkdayCalendar
+//------------------------------------------------------------------------------
+
+static void
+BM_WorkdayCalendar_shift(
+  benchmark::State& state)
+{
+  auto const cal = make_workday_calendar();
+  auto const dates = make_dates<Date>();
+  ssize_t const shift = state.range(0);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cal.shift(dates[i], shift));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_WorkdayCalendar_shift)->Arg(1)->Arg(250)->Arg(-250);
+
+
+static void
+BM_WorkdayCalendar_count(
+  benchmark::State& state)
+{
+  auto const cal = make_workday_calendar();
+  auto const dates = make_dates<Date>();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cal.count(dates[i], dates[i] + 365));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_WorkdayCalendar_count);
+
+
+static void
+BM_WorkdayCalendar_shift_array(
+  benchmark::State& state)
+{
+  auto const cal = make_workday_calendar();
+  auto const dates = make_dates<Date>();
+  std::vector<Date> shifted(NUM_INPUTS);
+  for (auto _ : state)
+    cal.shift(dates.data(), NUM_INPUTS, state.range(0), shifted.data());
+  state.SetItemsProcessed(state.iterations() * NUM_INPUTS);
+}
+
+BENCHMARK(BM_WorkdayCalendar_shift_array)->Arg(1)->Arg(250);
+
+
+static void
+BM_WorkdayCalendar_contains_array(
+  benchmark::State& state)
+{
+  auto const cal = make_workday_calendar();
+  auto const dates = make_dates<Date>();
+  std::unique_ptr<bool[]> contained(new bool[NUM_INPUTS]);
+  for (auto _ : state)
+    cal.contains(dates.data(), NUM_INPUTS, contained.get());
+  state.SetItemsProcessed(state.iterations() * NUM_INPUTS);
+}
+
+BENCHMARK(BM_WorkdayCalendar_contains_array);
+
+
+static void
+BM_WorkdayCalendar_contains(
+  benchmark::State& state)
+{
+  auto const cal = make_workday_calendar();
+  auto const dates = make_dates<Date>();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cal.contains(dates[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_WorkdayCalendar_contains);
+
+
+//------------------------------------------------------------------------------
+// Class CompositeCalendar
+//------------------------------------------------------------------------------
+
+static void
+BM_CompositeCalendar_shift(
+  benchmark::State& state)
+{
+  // Open in either of two places, each with its own extra holiday.
+  auto const cal = get_union_calendar(
+    std::make_shared<WorkdayCalendar const>(make_workday_calendar(6, 3)),
+    std::make_shared<WorkdayCalendar const>(make_workday_calendar(4, 6)));
+  auto const dates = make_dates<Date>();
+  ssize_t const shift = state.range(0);
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(cal->shift(dates[i], shift));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_CompositeCalendar_shift)->Arg(1)->Arg(250);
+
+
@@ -0,0 +1,184 @@
+#include "benchmark/benchmark.h"
+#include "cron/date.hh"
+#include "cron/date_math.hh"
+
+#include "bench.hh"
+
+using namespace cron;
+using namespace cron::bench;
+
+//------------------------------------------------------------------------------
+// Date math functions
+//------------------------------------------------------------------------------
+
+static void
+BM_datenum_to_ordinal_date(
+  benchmark::State& state)
+{
+  auto const datenums = make_datenums();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(datenum_to_ordinal_date(datenums[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_datenum_to_ordinal_date);
+
+
+static void
+BM_datenum_to_ymd(
+  benchmark::State& state)
+{
+  auto const datenums = make_datenums();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(datenum_to_ymd(datenums[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_datenum_to_ymd);
+
+
+static void
+BM_datenum_to_week_date(
+  benchmark::State& state)
+{
+  auto const datenums = make_datenums();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(datenum_to_week_date(datenums[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_datenum_to_week_date);
+
+
+static void
+BM_ymd_to_datenum(
+  benchmark::State& state)
+{
+  std::vector<YmdDate> ymds;
+  for (auto const datenum : make_datenums())
+    ymds.push_back(datenum_to_ymd(datenum));
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& ymd = ymds[i];
+    benchmark::DoNotOptimize(ymd_to_datenum(ymd.year, ymd.month, ymd.day));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_ymd_to_datenum);
+
+
+static void
+BM_datenum_to_ymd_batch(
+  benchmark::State& state)
+{
+  auto const datenums = make_datenums();
+  std::vector<YmdDate> ymds(datenums.size());
+  for (auto _ : state) {
+    datenum_to_ymd(datenums.data(), datenums.size(), ymds.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * datenums.size());
+}
+
+BENCHMARK(BM_datenum_to_ymd_batch);
+
+
+static void
+BM_ymd_to_datenum_batch(
+  benchmark::State& state)
+{
+  std::vector<YmdDate> ymds;
+  for (auto const datenum : make_datenums())
+    ymds.push_back(datenum_to_ymd(datenum));
+  std::vector<Datenum> datenums(ymds.size());
+  for (auto _ : state) {
+    ymd_to_datenum(ymds.data(), ymds.size(), datenums.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * ymds.size());
+}
+
+BENCHMARK(BM_ymd_to_datenum_batch);
+
+
+//------------------------------------------------------------------------------
+// Date types
+//------------------------------------------------------------------------------
+
+template<class DATE>
+static void
+BM_DateTemplate_get_ordinal_date(
+  benchmark::State& state)
+{
+  auto const dates = make_dates<DATE>();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dates[i].get_ordinal_date());
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateTemplate_get_ordinal_date, Date);
+BENCHMARK_TEMPLATE(BM_DateTemplate_get_ordinal_date, Date16);
+
+
+template<class DATE>
+static void
+BM_DateTemplate_get_ymd(
+  benchmark::State& state)
+{
+  auto const dates = make_dates<DATE>();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dates[i].get_ymd());
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateTemplate_get_ymd, Date);
+BENCHMARK_TEMPLATE(BM_DateTemplate_get_ymd, Date16);
+
+
+template<class DATE>
+static void
+BM_DateTemplate_get_week_date(
+  benchmark::State& state)
+{
+  auto const dates = make_dates<DATE>();
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dates[i].get_week_date());
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateTemplate_get_week_date, Date);
+BENCHMARK_TEMPLATE(BM_DateTemplate_get_week_date, Date16);
+
+
+template<class DATE>
+static void
+BM_DateTemplate_from_ymd(
+  benchmark::State& state)
+{
+  std::vector<YmdDate> ymds;
+  for (auto const& date : make_dates<DATE>())
+    ymds.push_back(date.get_ymd());
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& ymd = ymds[i];
+    benchmark::DoNotOptimize(DATE::from_ymd(ymd.year, ymd.month, ymd.day));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateTemplate_from_ymd, Date);
+BENCHMARK_TEMPLATE(BM_DateTemplate_from_ymd, Date16);
+
@@ -0,0 +1,194 @@
+#include "benchmark/benchmark.h"
+#include "cron/fixed_format.hh"
+#include "cron/format.hh"
+
+#include "bench.hh"
+
+using namespace cron;
+using namespace cron::bench;
+
+//------------------------------------------------------------------------------
+// Class TimeFormat
+//------------------------------------------------------------------------------
+
+template<class TIME>
+static void
+BM_TimeFormat_utc(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  auto const& format = TimeFormat::ISO_UTC_EXTENDED;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format(times[i], *UTC));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeFormat_utc, Time);
+BENCHMARK_TEMPLATE(BM_TimeFormat_utc, SmallTime);
+BENCHMARK_TEMPLATE(BM_TimeFormat_utc, NsecTime);
+BENCHMARK_TEMPLATE(BM_TimeFormat_utc, Unix32Time);
+BENCHMARK_TEMPLATE(BM_TimeFormat_utc, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_TimeFormat_zone(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  auto const tz = get_time_zone("America/New_York");
+  auto const& format = TimeFormat::ISO_ZONE_EXTENDED;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format(times[i], *tz));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeFormat_zone, Time);
+BENCHMARK_TEMPLATE(BM_TimeFormat_zone, SmallTime);
+BENCHMARK_TEMPLATE(BM_TimeFormat_zone, NsecTime);
+BENCHMARK_TEMPLATE(BM_TimeFormat_zone, Unix32Time);
+BENCHMARK_TEMPLATE(BM_TimeFormat_zone, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_TimeFormat_nsec(
+  benchmark::State& state)
+{
+  auto const times = make_sequential_times<TIME>();
+  auto const tz = get_time_zone("America/New_York");
+  TimeFormat const format("%Y-%m-%dT%H:%M:%.9S%U%Q:%q");
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format(times[i], *tz));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeFormat_nsec, Time);
+BENCHMARK_TEMPLATE(BM_TimeFormat_nsec, NsecTime);
+
+
+template<class TIME>
+static void
+BM_TimeFormat_format_to(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  auto const& format = TimeFormat::ISO_UTC_EXTENDED;
+  char buf[64];
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format.format_to(buf, sizeof(buf), times[i], *UTC));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeFormat_format_to, Time);
+BENCHMARK_TEMPLATE(BM_TimeFormat_format_to, Unix64Time);
+
+
+
+template<class TIME>
+static void
+BM_TimeFormatter_nsec(
+  benchmark::State& state)
+{
+  auto const times = make_sequential_times<TIME>();
+  TimeFormatter formatter(
+    TimeFormat("%Y-%m-%dT%H:%M:%.9S%U%Q:%q"),
+    get_time_zone("America/New_York"));
+  char buf[64];
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(formatter.format_to(buf, sizeof(buf), times[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeFormatter_nsec, Time);
+BENCHMARK_TEMPLATE(BM_TimeFormatter_nsec, NsecTime);
+
+
+//------------------------------------------------------------------------------
+// Class FixedFormat
+//------------------------------------------------------------------------------
+
+template<class TIME>
+static void
+BM_FixedFormat_utc(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  char buf[fixed::IsoUtcExtended::WIDTH];
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format<fixed::IsoUtcExtended>(times[i], *UTC, buf));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_FixedFormat_utc, Time);
+BENCHMARK_TEMPLATE(BM_FixedFormat_utc, Unix64Time);
+
+
+template<class DATE>
+static void
+BM_FixedFormat_date(
+  benchmark::State& state)
+{
+  auto const dates = make_dates<DATE>();
+  char buf[fixed::IsoCalendarBasic::WIDTH];
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format<fixed::IsoCalendarBasic>(dates[i], buf));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_FixedFormat_date, Date);
+
+
+//------------------------------------------------------------------------------
+// Class DateFormat
+//------------------------------------------------------------------------------
+
+template<class DATE>
+static void
+BM_DateFormat(
+  benchmark::State& state)
+{
+  auto const dates = make_dates<DATE>();
+  auto const& format = DateFormat::ISO_CALENDAR_EXTENDED;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format(dates[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateFormat, Date);
+BENCHMARK_TEMPLATE(BM_DateFormat, Date16);
+
+
+template<class DATE>
+static void
+BM_DateFormat_week_date(
+  benchmark::State& state)
+{
+  auto const dates = make_dates<DATE>();
+  auto const& format = DateFormat::ISO_WEEK_EXTENDED;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(format(dates[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateFormat_week_date, Date);
+BENCHMARK_TEMPLATE(BM_DateFormat_week_date, Date16);
+
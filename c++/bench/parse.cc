@@ -0,0 +1,200 @@
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "cron/format.hh"
+#include "cron/parse.hh"
+
+#include "bench.hh"
+
+using namespace cron;
+using namespace cron::bench;
+
+namespace {
+
+/*
+ * Returns `times` formatted in `tz` with `format`.
+ */
+template<class TIME>
+std::vector<std::string>
+format_times(
+  std::vector<TIME> const& times,
+  TimeFormat const& format,
+  TimeZone const& tz)
+{
+  std::vector<std::string> strs;
+  strs.reserve(times.size());
+  for (auto const time : times)
+    strs.push_back(format(time, tz));
+  return strs;
+}
+
+
+}  // anonymous namespace
+
+//------------------------------------------------------------------------------
+// Class TimeParser
+//------------------------------------------------------------------------------
+
+template<class TIME>
+static void
+BM_TimeParser_utc(
+  benchmark::State& state)
+{
+  auto const strs = format_times(
+    make_times<TIME>(), TimeFormat::ISO_UTC_EXTENDED, *UTC);
+  TimeParser const parser(TimeFormat::ISO_UTC_EXTENDED);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& str = strs[i];
+    ErrorCode error;
+    benchmark::DoNotOptimize(parser.parse<TIME>(
+      str.data(), str.data() + str.size(), *UTC, true, error));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeParser_utc, Time);
+BENCHMARK_TEMPLATE(BM_TimeParser_utc, Unix64Time);
+
+
+/*
+ * The same, with strptime() and timegm(), for comparison.
+ */
+static void
+BM_strptime_utc(
+  benchmark::State& state)
+{
+  auto const strs = format_times(
+    make_times<Unix64Time>(), TimeFormat::ISO_UTC_EXTENDED, *UTC);
+  size_t i = 0;
+  for (auto _ : state) {
+    struct tm tm = {};
+    strptime(strs[i].c_str(), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    benchmark::DoNotOptimize(timegm(&tm));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_strptime_utc);
+
+
+template<class TIME>
+static void
+BM_TimeParser_zone(
+  benchmark::State& state)
+{
+  auto const strs = format_times(
+    make_times<TIME>(), TimeFormat::ISO_ZONE_EXTENDED, *UTC);
+  TimeParser const parser(TimeFormat::ISO_ZONE_EXTENDED);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& str = strs[i];
+    ErrorCode error;
+    benchmark::DoNotOptimize(parser.parse<TIME>(
+      str.data(), str.data() + str.size(), *UTC, true, error));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeParser_zone, Time);
+
+
+/*
+ * Parses a newline-delimited buffer of sequential local times.
+ */
+template<class TIME>
+static void
+BM_TimeParser_batch(
+  benchmark::State& state)
+{
+  auto const tz = get_time_zone("America/New_York");
+  TimeFormat const format("%Y-%m-%d %H:%M:%.6S");
+  std::string buffer;
+  for (auto const& str : format_times(make_sequential_times<TIME>(), format, *tz))
+    buffer += str + "\n";
+  TimeParser const parser(format);
+  std::vector<TIME> times(NUM_INPUTS);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(parser.parse(
+      buffer.data(), buffer.data() + buffer.size(), '\n',
+      times.data(), times.size(), *tz));
+  state.SetItemsProcessed(state.iterations() * NUM_INPUTS);
+}
+
+BENCHMARK_TEMPLATE(BM_TimeParser_batch, Time);
+
+
+//------------------------------------------------------------------------------
+// ISO 8601 fast path
+//------------------------------------------------------------------------------
+
+template<class TIME>
+static void
+BM_parse_iso_time(
+  benchmark::State& state)
+{
+  auto const strs = format_times(
+    make_times<TIME>(), TimeFormat::ISO_UTC_EXTENDED, *UTC);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& str = strs[i];
+    ErrorCode error;
+    benchmark::DoNotOptimize(
+      parse_iso_time<TIME>(str.data(), str.data() + str.size(), error));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_parse_iso_time, Time);
+BENCHMARK_TEMPLATE(BM_parse_iso_time, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_parse_iso_times(
+  benchmark::State& state)
+{
+  std::string buffer;
+  for (auto const& str : format_times(
+         make_times<TIME>(), TimeFormat::ISO_ZONE_EXTENDED, *UTC))
+    buffer += str + "\n";
+  std::vector<TIME> times(NUM_INPUTS);
+  for (auto _ : state)
+    benchmark::DoNotOptimize(parse_iso_times(
+      buffer.data(), buffer.data() + buffer.size(),
+      times.data(), times.size()));
+  state.SetItemsProcessed(state.iterations() * NUM_INPUTS);
+}
+
+BENCHMARK_TEMPLATE(BM_parse_iso_times, Time);
+
+
+//------------------------------------------------------------------------------
+// Class DateParser
+//------------------------------------------------------------------------------
+
+template<class DATE>
+static void
+BM_DateParser(
+  benchmark::State& state)
+{
+  auto const& format = DateFormat::ISO_CALENDAR_EXTENDED;
+  std::vector<std::string> strs;
+  for (auto const& date : make_dates<DATE>())
+    strs.push_back(format(date));
+  DateParser const parser(format);
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& str = strs[i];
+    ErrorCode error;
+    benchmark::DoNotOptimize(
+      parser.parse<DATE>(str.data(), str.data() + str.size(), error));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_DateParser, Date);
+BENCHMARK_TEMPLATE(BM_DateParser, Date16);
+
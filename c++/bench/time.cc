@@ -0,0 +1,113 @@
+#include "benchmark/benchmark.h"
+#include "cron/time.hh"
+#include "cron/time_zone.hh"
+
+#include "bench.hh"
+
+using namespace cron;
+using namespace cron::bench;
+
+//------------------------------------------------------------------------------
+// Class TimeTemplate
+//------------------------------------------------------------------------------
+
+template<class TIME>
+static void
+BM_TimeTemplate_get_parts_utc(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  auto const& tz = *UTC;
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(times[i].get_parts(tz));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts_utc, Time);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts_utc, SmallTime);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts_utc, NsecTime);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts_utc, Unix32Time);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts_utc, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_TimeTemplate_get_parts(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  auto const tz = get_time_zone("America/New_York");
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(times[i].get_parts(*tz));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts, Time);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts, SmallTime);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts, NsecTime);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts, Unix32Time);
+BENCHMARK_TEMPLATE(BM_TimeTemplate_get_parts, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_from_local(
+  benchmark::State& state)
+{
+  auto const tz = get_time_zone("America/New_York");
+  std::vector<LocalDatenumDaytick> locals;
+  for (auto const time : make_times<TIME>()) {
+    auto const parts = time.get_parts(*tz);
+    locals.emplace_back(
+      ymd_to_datenum(parts.date.year, parts.date.month, parts.date.day),
+      hms_to_daytick(
+        parts.daytime.hour, parts.daytime.minute, parts.daytime.second));
+  }
+  size_t i = 0;
+  for (auto _ : state) {
+    auto const& local = locals[i];
+    benchmark::DoNotOptimize(
+      cron::from_local<TIME>(local.datenum, local.daytick, *tz));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_from_local, Time);
+BENCHMARK_TEMPLATE(BM_from_local, SmallTime);
+BENCHMARK_TEMPLATE(BM_from_local, NsecTime);
+BENCHMARK_TEMPLATE(BM_from_local, Unix32Time);
+BENCHMARK_TEMPLATE(BM_from_local, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_from_local_batch(
+  benchmark::State& state)
+{
+  // Local times a second apart, as in a column of timestamps.
+  auto const tz = get_time_zone("America/New_York");
+  std::vector<Datenum> datenums;
+  std::vector<Daytick> dayticks;
+  for (auto const time : make_sequential_times<TIME>()) {
+    auto const local = to_local_datenum_daytick(time, *tz);
+    datenums.push_back(local.datenum);
+    dayticks.push_back(local.daytick);
+  }
+  std::vector<TIME> times(NUM_INPUTS);
+  std::vector<LocalTimeStatus> statuses(NUM_INPUTS);
+  for (auto _ : state) {
+    cron::from_local(
+      datenums.data(), dayticks.data(), NUM_INPUTS, *tz, true,
+      times.data(), statuses.data());
+    benchmark::DoNotOptimize(times.data());
+  }
+  state.SetItemsProcessed(state.iterations() * NUM_INPUTS);
+}
+
+BENCHMARK_TEMPLATE(BM_from_local_batch, Time);
+BENCHMARK_TEMPLATE(BM_from_local_batch, Unix64Time);
+
@@ -0,0 +1,108 @@
+#include "benchmark/benchmark.h"
+#include "cron/time.hh"
+#include "cron/time_zone.hh"
+
+#include "bench.hh"
+
+using namespace cron;
+using namespace cron::bench;
+
+//------------------------------------------------------------------------------
+// Class TimeZone
+//------------------------------------------------------------------------------
+
+template<class TIME>
+static void
+BM_TimeZone_get_parts(
+  benchmark::State& state)
+{
+  auto const times = make_times<TIME>();
+  auto const tz = get_time_zone("America/New_York");
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tz->get_parts(times[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts, Time);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts, SmallTime);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts, NsecTime);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts, Unix32Time);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts, Unix64Time);
+
+
+template<class TIME>
+static void
+BM_TimeZone_get_parts_sequential(
+  benchmark::State& state)
+{
+  auto const times = make_sequential_times<TIME>();
+  auto const tz = get_time_zone("America/New_York");
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tz->get_parts(times[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts_sequential, Time);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts_sequential, SmallTime);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts_sequential, NsecTime);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts_sequential, Unix32Time);
+BENCHMARK_TEMPLATE(BM_TimeZone_get_parts_sequential, Unix64Time);
+
+
+static void
+BM_TimeZone_get_parts_future(
+  benchmark::State& state)
+{
+  // Random times from 2040 through 2239, governed by the zone's TZ rule.
+  Random random;
+  std::vector<TimeOffset> times;
+  for (size_t i = 0; i < NUM_INPUTS; ++i)
+    times.push_back(random.next(2208988800, 8520335999));
+  auto const tz = get_time_zone("America/New_York");
+  size_t i = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(tz->get_parts(times[i]));
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_TimeZone_get_parts_future);
+
+
+static void
+BM_TimeZone_get_parts_local(
+  benchmark::State& state)
+{
+  auto const tz = get_time_zone("America/New_York");
+  std::vector<TimeOffset> locals;
+  for (auto const time : make_times<Unix64Time>())
+    locals.push_back(time.get_offset() + tz->get_parts(time).offset);
+  size_t i = 0;
+  for (auto _ : state) {
+    // Skip the few local times that don't exist.
+    try {
+      benchmark::DoNotOptimize(tz->get_parts_local(locals[i]));
+    }
+    catch (NonexistentLocalTime const&) {
+    }
+    i = (i + 1) % NUM_INPUTS;
+  }
+}
+
+BENCHMARK(BM_TimeZone_get_parts_local);
+
+
+static void
+BM_get_time_zone_by_name(
+  benchmark::State& state)
+{
+  for (auto _ : state)
+    benchmark::DoNotOptimize(get_time_zone("America/New_York"));
+}
+
+BENCHMARK(BM_get_time_zone_by_name);
+
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string>
 
 #include "filename.hh"
@@ -14,6 +16,33 @@ extern std::string load_text(int fd);
 extern std::string load_text(Filename const& filename);
 extern std::string load_text_for_arg(std::string const& arg);
 
+//------------------------------------------------------------------------------
+
+/*
+ * A file mapped read-only into memory, for the life of the object.
+ */
+class MappedFile
+{
+public:
+
+  MappedFile(Filename const& filename);
+  MappedFile(MappedFile&&);
+  MappedFile(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile const&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+  ~MappedFile();
+
+  char const* get_data() const { return data_; }
+  size_t get_size() const { return size_; }
+
+private:
+
+  char const* data_;
+  size_t size_;
+
+};
+
+
 //------------------------------------------------------------------------------
 
 }  // namespace fs
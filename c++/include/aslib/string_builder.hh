@@ -1,11 +1,66 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 
 namespace aslib {
 
+//------------------------------------------------------------------------------
+
+/*
+ * The two decimal digits of each number 0 through 99, in order.
+ */
+char constexpr
+DIGIT_PAIRS[201]
+  = "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/*
+ * Returns the number of decimal digits in `value`; at least one.
+ */
+inline size_t
+count_digits(
+  uint64_t value)
+{
+  for (size_t digits = 0; ; value /= 10000, digits += 4)
+    if (value < 10)
+      return digits + 1;
+    else if (value < 100)
+      return digits + 2;
+    else if (value < 1000)
+      return digits + 3;
+    else if (value < 10000)
+      return digits + 4;
+}
+
+
+/*
+ * Writes the decimal digits of `value` so that they end at `end`, two at a
+ * time.
+ */
+inline void
+write_digits(
+  char* end,
+  uint64_t value)
+{
+  while (value >= 100) {
+    memcpy(end -= 2, DIGIT_PAIRS + 2 * (value % 100), 2);
+    value /= 100;
+  }
+  if (value >= 10)
+    memcpy(end - 2, DIGIT_PAIRS + 2 * value, 2);
+  else
+    end[-1] = '0' + value;
+}
+
+
 //------------------------------------------------------------------------------
 
 class StringBuilder
@@ -16,15 +71,42 @@ public:
     size_t hint=32)
     : length_(0),
       size_(0),
-      buffer_(nullptr)
+      buffer_(nullptr),
+      owned_(true)
   {
     assert(hint > 0);
     resize(hint);
   }
 
+  /*
+   * Builds the string in `buf`, which has room for `size` chars.  Doesn't
+   * allocate unless the string outgrows it, in which case the string moves
+   * to the heap.  Either way, the result is not nul-terminated.
+   */
+  StringBuilder(
+    char* const buf,
+    size_t const size)
+    : length_(0),
+      size_(size),
+      buffer_(buf),
+      owned_(false)
+  {
+  }
+
+  StringBuilder(StringBuilder const&) = delete;
+  StringBuilder& operator=(StringBuilder const&) = delete;
+
+  ~StringBuilder()
+  {
+    if (owned_)
+      free(buffer_);
+  }
+
   size_t length() const { return length_; }
   operator char const*() const { return buffer_; }
+  char const* data() const { return buffer_; }
   std::string str() const { return std::string(buffer_, length_); }
+  bool on_heap() const { return owned_; }
 
   StringBuilder&
   operator<<(
@@ -63,45 +145,32 @@ public:
     size_t width=0,
     char fill=' ')
   {
-    maybe_resize(width);
-
-    // Count the number of digits needed to represent the value.  At least one
-    // digit is required.
-    size_t digits = 1;
-    for (uint64_t rem = value / 10; rem > 0; digits++, rem /= 10)
-      ;
-
+    size_t const digits = count_digits(value);
+    // Expand the width to accommodate the entire value.
     if (digits > width)
-      // Expand the width to accommodate the entire value.
       width = digits;
-    else if (digits < width)
-      // Pad.
-      for (size_t i = 0; i < width - digits; ++i)
-        *this << fill;
-
-    // Generate the digits, from least to most significant.
-    // Buffer size: log_10(1 << 64) ~ 19.3
-    char buf[20];
-    assert(digits <= sizeof(buf));
-    for (ssize_t i = digits - 1; i >= 0; --i) {
-      buf[i] = '0' + value % 10;
-      value /= 10;
-    }
-    assert(value == 0);
-    // Now produce the digits in order.
-    for (size_t i = 0; i < digits; ++i)
-      *this << buf[i];
+    maybe_resize(width);
 
+    char* const begin = buffer_ + length_;
+    // Pad.
+    memset(begin, fill, width - digits);
+    write_digits(begin + width, value);
+    length_ += width;
     return *this;
   }
 
+  /*
+   * Makes room for at least `length` more chars without resizing.
+   */
+  void reserve(size_t length) { maybe_resize(length); }
+
 private:
 
   void
   maybe_resize(
     size_t increment)
   {
-    size_t const new_size = length_ + increment + 1;
+    size_t const new_size = length_ + increment;
     if (new_size > size_)
       resize(std::max(new_size, length_ * 2));
   }
@@ -111,7 +180,16 @@ private:
     size_t new_size)
   {
     assert(new_size > length_);
-    buffer_ = (char*) realloc(buffer_, new_size);
+    if (owned_)
+      buffer_ = (char*) realloc(buffer_, new_size);
+    else {
+      // Move out of the caller's buffer.
+      char* const buffer = (char*) malloc(new_size);
+      assert(buffer != nullptr);
+      memcpy(buffer, buffer_, length_);
+      buffer_ = buffer;
+      owned_ = true;
+    }
     assert(buffer_ != nullptr);
     size_ = new_size;
   }
@@ -119,6 +197,8 @@ private:
   size_t length_;
   size_t size_;
   char* buffer_;
+  // True if `buffer_` is ours, on the heap.
+  bool owned_;
 
 };
 
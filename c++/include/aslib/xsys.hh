@@ -2,6 +2,7 @@
 
 #include <cassert>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -152,6 +153,24 @@ inline int xmkstemp(char* name_template)
 }
 
 
+inline void* xmmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+{
+  void* const ptr = mmap(addr, length, prot, flags, fd, offset);
+  if (ptr == MAP_FAILED)
+    throw aslib::SystemError("mmap");
+  return ptr;
+}
+
+
+inline void xmunmap(void* addr, size_t length)
+{
+  int const rval = munmap(addr, length);
+  if (rval == -1)
+    throw aslib::SystemError("munmap");
+  assert(rval == 0);
+}
+
+
 inline int xopen(const char* pathname, int flags, mode_t mode=0666)
 {
   int const fd = open(pathname, flags, mode);
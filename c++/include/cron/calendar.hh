@@ -1,11 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# define CRON_CALENDAR_X86 1
+# include <immintrin.h>
+#endif
+
 #include "aslib/filename.hh"
 #include "cron/date.hh"
 
@@ -19,9 +27,15 @@ using namespace aslib;
 class Calendar;
 class HolidayCalendar;
 
+using Calendar_ptr = std::shared_ptr<Calendar const>;
+
 extern HolidayCalendar parse_holiday_calendar(std::istream& in);
 extern HolidayCalendar load_holiday_calendar(fs::Filename const& filename);
 
+extern Calendar_ptr get_union_calendar(Calendar_ptr cal0, Calendar_ptr cal1);
+extern Calendar_ptr get_intersection_calendar(Calendar_ptr cal0, Calendar_ptr cal1);
+extern Calendar_ptr get_difference_calendar(Calendar_ptr cal0, Calendar_ptr cal1);
+
 //------------------------------------------------------------------------------
 
 class CalendarInterval
@@ -55,8 +69,18 @@ class Calendar
 public:
 
   Calendar() : DAY(*this, 1) {}
+  // A copy's interval refers to the copy.
+  Calendar(Calendar const&) : DAY(*this, 1) {}
   virtual ~Calendar() {}
 
+  /*
+   * The range [min, max) of dates over which the calendar has specific
+   * contents, such as holidays.  Outside it, the calendar follows a rule, if
+   * any.  A calendar that only follows a rule covers all dates.
+   */
+  virtual Date get_min() const { return Date::MIN; }
+  virtual Date get_max() const { return Date::MAX; }
+
   virtual inline Date 
   shift(
     Date date, 
@@ -64,7 +88,6 @@ public:
     const
   {
     // FIXME: What if 'date' is not in the calendar?
-    // FIXME: Avoid virtual calls to contains()?
 
     while (shift > 0 && date.is_valid())
       if (contains_(++date))
@@ -86,11 +109,48 @@ public:
     return date;
   }
 
+  /*
+   * Returns the number of contained dates in [date0, date1), or the negative
+   * of the number in [date1, date0) if `date1` precedes `date0`.
+   */
+  virtual inline ssize_t
+  count(
+    Date date0,
+    Date date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    if (date1 < date0)
+      return -count(date1, date0);
+
+    ssize_t count = 0;
+    for (; date0 < date1; ++date0)
+      if (contains_(date0))
+        ++count;
+    return count;
+  }
+
   template<class DATE> bool contains(DATE date) const { return contains_(Date(date)); }
   template<class DATE> DATE shift(DATE date, ssize_t shift) const { return DATE(this->shift(Date(date), shift)); }
   template<class DATE> DATE nearest(DATE date, bool forward=true) const { return DATE(nearest(Date(date), forward)); }
+  template<class DATE> ssize_t count(DATE date0, DATE date1) const { return count(Date(date0), Date(date1)); }
 
   template<class DATE> bool operator[](DATE date) const { return contains<DATE>(date); }
+
+  // Array versions of the above, for `size` dates at a time.  CalendarTemplate
+  // overrides these with a loop that calls the calendar's own scalar
+  // operations directly, so there's one virtual call per array, not per date.
+
+  virtual void contains(Date const* dates, size_t size, bool* contained) const;
+  virtual void shift(Date const* dates, size_t size, ssize_t shift, Date* shifted) const;
+  virtual void nearest(Date const* dates, size_t size, bool forward, Date* nearest) const;
+
+  /*
+   * Counts contained dates between corresponding elements of `dates0` and
+   * `dates1`.  Throws <InvalidDateError> if any date is invalid.
+   */
+  virtual void count(Date const* dates0, Date const* dates1, size_t size, ssize_t* counts) const;
   
   CalendarInterval const DAY;
 
@@ -151,22 +211,180 @@ operator>>=(
 }
 
 
+//------------------------------------------------------------------------------
+// Class CalendarTemplate.
+
+/*
+ * Base for concrete calendars, which implements the virtual interface of
+ * `Calendar` in terms of the derived calendar `CAL`.
+ *
+ * `CAL` provides a non-virtual `contains(Date)`, and may hide `shift()`,
+ * `nearest()`, and `count()` with its own.  The rest, including the array
+ * versions, call these directly, so they are inlined into the loops.  Likewise
+ * for templated code that takes a `CAL` rather than a `Calendar`; since
+ * concrete calendars are final, calls through them are never virtual.
+ */
+template<class CAL>
+class CalendarTemplate
+  : public Calendar
+{
+public:
+
+  virtual Date shift(Date date, ssize_t shift) const { return step_shift(date, shift); }
+  virtual Date nearest(Date date, bool forward=true) const { return step_nearest(date, forward); }
+
+  virtual ssize_t
+  count(
+    Date const date0,
+    Date const date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    return date0 <= date1 ? step_count(date0, date1) : -step_count(date1, date0);
+  }
+
+  virtual void
+  contains(
+    Date const* const dates,
+    size_t const size,
+    bool* const contained)
+    const
+  {
+    for (size_t i = 0; i < size; ++i)
+      contained[i] = self().contains(dates[i]);
+  }
+
+  virtual void
+  shift(
+    Date const* const dates,
+    size_t const size,
+    ssize_t const shift,
+    Date* const shifted)
+    const
+  {
+    for (size_t i = 0; i < size; ++i)
+      shifted[i] = self().CAL::shift(dates[i], shift);
+  }
+
+  virtual void
+  nearest(
+    Date const* const dates,
+    size_t const size,
+    bool const forward,
+    Date* const nearest)
+    const
+  {
+    for (size_t i = 0; i < size; ++i)
+      nearest[i] = self().CAL::nearest(dates[i], forward);
+  }
+
+  virtual void
+  count(
+    Date const* const dates0,
+    Date const* const dates1,
+    size_t const size,
+    ssize_t* const counts)
+    const
+  {
+    for (size_t i = 0; i < size; ++i)
+      counts[i] = self().CAL::count(dates0[i], dates1[i]);
+  }
+
+  using Calendar::contains;
+  using Calendar::shift;
+  using Calendar::nearest;
+  using Calendar::count;
+
+protected:
+
+  /*
+   * Shifts by stepping a day at a time.
+   */
+  inline Date
+  step_shift(
+    Date date,
+    ssize_t shift)
+    const
+  {
+    while (shift > 0 && date.is_valid())
+      if (self().contains(++date))
+        shift--;
+    while (shift < 0 && date.is_valid())
+      if (self().contains(--date))
+        shift++;
+    return date;
+  }
+
+  /*
+   * Searches by stepping a day at a time.
+   */
+  inline Date
+  step_nearest(
+    Date date,
+    bool const forward)
+    const
+  {
+    while (date.is_valid() && !self().contains(date))
+      date += forward ? 1 : -1;
+    return date;
+  }
+
+  /*
+   * Counts contained dates in [date0, date1), a day at a time.
+   */
+  inline ssize_t
+  step_count(
+    Date date0,
+    Date const date1)
+    const
+  {
+    ssize_t count = 0;
+    for (; date0 < date1; ++date0)
+      count += self().contains(date0);
+    return count;
+  }
+
+  virtual bool contains_(Date date) const final { return self().contains(date); }
+
+private:
+
+  CAL const& self() const { return static_cast<CAL const&>(*this); }
+
+};
+
+
 //------------------------------------------------------------------------------
 
 class AllCalendar 
   final
-  : public Calendar
+  : public CalendarTemplate<AllCalendar>
 {
 public:
 
   AllCalendar() {}
   virtual ~AllCalendar() {}
 
-  virtual Date shift(Date date, ssize_t days) const { return shift(date, days); }
+  bool contains(Date date) const { return date.is_valid(); }
 
-protected:
+  Date shift(Date date, ssize_t days) const { return date.is_valid() ? date + days : date; }
+  Date nearest(Date date, bool=true) const { return date; }
 
-  virtual bool contains_(Date date) const { return date.is_valid(); }
+  ssize_t
+  count(
+    Date const date0,
+    Date const date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    return date1 - date0;
+  }
+
+  using CalendarTemplate::contains;
+  using CalendarTemplate::shift;
+  using CalendarTemplate::nearest;
+  using CalendarTemplate::count;
 
 };
 
@@ -174,7 +392,8 @@ protected:
 //------------------------------------------------------------------------------
 
 class WeekdaysCalendar
-  : public Calendar
+  final
+  : public CalendarTemplate<WeekdaysCalendar>
 {
 public:
 
@@ -186,25 +405,373 @@ public:
     mask_.fill(false);
     for (auto const weekday : weekdays)
       mask_[weekday] = true;
+    num_ = std::count(mask_.begin(), mask_.end(), true);
   }
 
   virtual ~WeekdaysCalendar() {}
 
-  // FIXME: Optimize shift()?
-
-protected:
-
-  virtual inline bool 
-  contains_(
+  inline bool 
+  contains(
     Date date) 
     const
   {
     return mask_[date.get_weekday()];
   }
 
+  // Any seven consecutive days contain each weekday once, so these skip whole
+  // weeks at a time.
+
+  inline Date
+  shift(
+    Date date,
+    ssize_t shift)
+    const
+  {
+    if (date.is_valid() && num_ > 0 && (shift > num_ || shift < -num_)) {
+      // Leave between one and num_ dates to step over.
+      ssize_t const weeks = shift > 0 ? (shift - 1) / num_ : (shift + 1) / num_;
+      date += 7 * weeks;
+      shift -= weeks * num_;
+    }
+    return step_shift(date, shift);
+  }
+
+  inline ssize_t
+  count(
+    Date date0,
+    Date const date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    if (date1 < date0)
+      return -count(date1, date0);
+
+    ssize_t const weeks = (date1 - date0) / 7;
+    date0 += 7 * weeks;
+    return weeks * num_ + step_count(date0, date1);
+  }
+
+  using CalendarTemplate::contains;
+  using CalendarTemplate::shift;
+  using CalendarTemplate::nearest;
+  using CalendarTemplate::count;
+
 private:
 
   Mask mask_;
+  ssize_t num_;
+
+};
+
+
+//------------------------------------------------------------------------------
+// Class CalendarIndex.
+
+/*
+ * Rank and select index of the contained dates in a range [min, max).
+ *
+ * Stores the contained dates as a bitset packed into 64-bit words, with the
+ * number of contained dates before each word, and the word containing every
+ * 64th contained date.  With these, a calendar counts and shifts within the
+ * range with a few word operations, and searches a word at a time.  The whole
+ * index takes about 1.5 bits per date.
+ */
+class CalendarIndex
+{
+public:
+
+  /*
+   * Builds the index of dates in [min, max) for which `contains` is true.
+   */
+  template<class PRED>
+  CalendarIndex(
+    Date const min,
+    Date const max,
+    PRED&& contains)
+    : min_(min),
+      size_(std::max(max - min, 0)),
+      // One extra word, so that the rank of `max` is always defined.
+      words_(size_ / BITS + 1, 0)
+  {
+    assert(min.is_valid() && max.is_valid());
+    for (size_t i = 0; i < size_; ++i)
+      if (contains(min + i))
+        words_[i / BITS] |= (uint64_t) 1 << (i % BITS);
+    build();
+  }
+
+  Date get_min() const { return min_; }
+  Date get_max() const { return min_ + size_; }
+  size_t get_count() const { return ranks_.back(); }
+
+  inline bool
+  covers(
+    Date const date)
+    const
+  {
+    if (!date.is_valid())
+      return false;
+    ssize_t const i = date - min_;
+    return 0 <= i && i < (ssize_t) size_;
+  }
+
+  /*
+   * True if `date`, which must be in range, is contained.
+   */
+  inline bool
+  contains(
+    Date const date)
+    const
+  {
+    size_t const i = date - min_;
+    return (words_[i / BITS] >> (i % BITS)) & 1;
+  }
+
+  /*
+   * Returns the number of contained dates before `date`, which must be in
+   * [min, max].
+   */
+  size_t rank(Date const date) const { return rank_(date - min_); }
+
+  /*
+   * Returns the contained date of rank `k`, which must be less than the count.
+   */
+  Date select(size_t const k) const { return min_ + select_(k); }
+
+  /*
+   * Shifts `date`, which must be in range, by `shift` contained dates, as far
+   * as the range allows.  Returns the part of the shift that remains; if this
+   * is nonzero, `date` is left on the last or first date in the range.
+   */
+  inline ssize_t
+  shift(
+    Date& date,
+    ssize_t const shift)
+    const
+  {
+    size_t const i = date - min_;
+    if (shift > 0) {
+      size_t const k = rank_(i + 1) + shift - 1;
+      if (k < get_count()) {
+        date = min_ + select_(k);
+        return 0;
+      }
+      date = get_max() - 1;
+      return k + 1 - get_count();
+    }
+    else if (shift < 0) {
+      ssize_t const k = rank_(i) + shift;
+      if (k >= 0) {
+        date = min_ + select_(k);
+        return 0;
+      }
+      date = min_;
+      return k;
+    }
+    else
+      return 0;
+  }
+
+  /*
+   * Finds the nearest contained date on or after `date`, which must be in
+   * range, if `forward`, or on or before it otherwise.  If there is none in
+   * range, returns false and leaves `date` on the first date after the range,
+   * or on the first date in the range, respectively.
+   */
+  inline bool
+  nearest(
+    Date& date,
+    bool const forward)
+    const
+  {
+    size_t const i = date - min_;
+    size_t w = i / BITS;
+    if (forward) {
+      // Scan whole words for the next set bit.
+      uint64_t word = words_[w] & (~(uint64_t) 0 << (i % BITS));
+      while (word == 0 && ++w < words_.size())
+        word = words_[w];
+      if (word != 0) {
+        date = min_ + (w * BITS + __builtin_ctzll(word));
+        return true;
+      }
+      date = get_max();
+      return false;
+    }
+    else {
+      uint64_t word = words_[w] & (~(uint64_t) 0 >> (BITS - 1 - i % BITS));
+      while (word == 0 && w-- > 0)
+        word = words_[w];
+      if (word != 0) {
+        date = min_ + (w * BITS + BITS - 1 - __builtin_clzll(word));
+        return true;
+      }
+      date = min_;
+      return false;
+    }
+  }
+
+  /*
+   * Returns the number of contained dates in the range that are also in
+   * [date0, date1).  Both dates must be valid.
+   */
+  inline size_t
+  count(
+    Date date0,
+    Date date1)
+    const
+  {
+    date0 = std::max(date0, min_);
+    date1 = std::min(date1, get_max());
+    return date0 < date1 ? rank(date1) - rank(date0) : 0;
+  }
+
+  /*
+   * Adds `date`, which must be in range, to or removes it from the contained
+   * dates.  This adjusts the ranks of the words after `date`'s, rather than
+   * rebuilding the index.
+   */
+  void set(Date date, bool contained);
+
+  // Bit operations on the index words.  Each has a portable version and, on
+  // x86-64, one using the instruction for it; the index uses the latter when
+  // compiled for that instruction.  These are public for testing.
+
+  static inline unsigned
+  popcount_portable(
+    uint64_t const word)
+  {
+    return (byte_counts(word) * ONES) >> 56;
+  }
+
+  /*
+   * Returns the position of the set bit of rank `k` in `word`.
+   */
+  static inline unsigned
+  select_in_word_portable(
+    uint64_t const word,
+    unsigned k)
+  {
+    // Running counts through each byte; the bit is in the first byte whose
+    // running count exceeds `k`.
+    uint64_t const counts = byte_counts(word) * ONES;
+    uint64_t const le = ((k * ONES | HIGHS) - counts) & HIGHS;
+    unsigned const byte = ((le >> 7) * ONES) >> 56;
+    k -= ((counts << 8) >> (8 * byte)) & 0xff;
+    return 8 * byte + SELECT_IN_BYTE[(word >> (8 * byte)) & 0xff][k];
+  }
+
+#ifdef CRON_CALENDAR_X86
+
+  __attribute__((target("popcnt"))) static inline unsigned
+  popcount_popcnt(
+    uint64_t const word)
+  {
+    return __builtin_popcountll(word);
+  }
+
+  __attribute__((target("bmi2"))) static inline unsigned
+  select_in_word_bmi2(
+    uint64_t const word,
+    unsigned const k)
+  {
+    return __builtin_ctzll(_pdep_u64((uint64_t) 1 << k, word));
+  }
+
+#endif
+
+private:
+
+  static size_t constexpr BITS = 64;
+
+  /* Position of the set bit of each rank in each byte value.  */
+  static std::array<std::array<uint8_t, 8>, 256> const SELECT_IN_BYTE;
+
+  static uint64_t constexpr ONES = 0x0101010101010101;
+  static uint64_t constexpr HIGHS = 0x8080808080808080;
+
+  /*
+   * Returns, in each byte, the number of set bits in that byte of `word`.
+   */
+  static inline uint64_t
+  byte_counts(
+    uint64_t word)
+  {
+    word -= (word >> 1) & 0x5555555555555555;
+    word = (word & 0x3333333333333333) + ((word >> 2) & 0x3333333333333333);
+    return (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0f;
+  }
+
+  static inline unsigned
+  popcount(
+    uint64_t const word)
+  {
+#if defined(CRON_CALENDAR_X86) && defined(__POPCNT__)
+    return popcount_popcnt(word);
+#else
+    return popcount_portable(word);
+#endif
+  }
+
+  static inline unsigned
+  select_in_word(
+    uint64_t const word,
+    unsigned const k)
+  {
+#if defined(CRON_CALENDAR_X86) && defined(__BMI2__)
+    return select_in_word_bmi2(word, k);
+#else
+    return select_in_word_portable(word, k);
+#endif
+  }
+
+  /*
+   * Number of contained dates before position `i`, in [0, size].
+   */
+  inline size_t
+  rank_(
+    size_t const i)
+    const
+  {
+    uint64_t const below = ((uint64_t) 1 << (i % BITS)) - 1;
+    return ranks_[i / BITS] + popcount(words_[i / BITS] & below);
+  }
+
+  /*
+   * Position of the contained date of rank `k`.
+   */
+  inline size_t
+  select_(
+    size_t const k)
+    const
+  {
+    // The samples bracket the words that may contain rank `k`.  Scan these
+    // if there are few, as in a dense calendar; otherwise, bisect.
+    size_t const s = k / BITS;
+    size_t w = samples_[s];
+    size_t const end = s + 1 < samples_.size() ? samples_[s + 1] : words_.size();
+    if (end - w < 8)
+      while (ranks_[w + 1] <= k)
+        ++w;
+    else
+      w = std::upper_bound(
+        ranks_.begin() + w, ranks_.begin() + end + 1, k) - ranks_.begin() - 1;
+    return w * BITS + select_in_word(words_[w], k - ranks_[w]);
+  }
+
+  /*
+   * Builds `ranks_` and `samples_` from `words_`.
+   */
+  void build();
+
+  Date min_;
+  size_t size_;
+  std::vector<uint64_t> words_;
+  /* Number of contained dates before each word, and in total.  */
+  std::vector<uint32_t> ranks_;
+  /* Index of the word containing each contained date of rank 64 k.  */
+  std::vector<uint32_t> samples_;
 
 };
 
@@ -213,23 +780,40 @@ private:
 
 class HolidayCalendar
   final 
-  : public Calendar
+  : public CalendarTemplate<HolidayCalendar>
 {
 public:
 
   HolidayCalendar(
     Date min, 
     Date max)
-    : min_(min),
-      holidays_(max - min, false)
+    : index_(min, max, [](Date) { return false; })
+  {
+  }
+
+  /*
+   * Constructs the calendar of `holidays` in [min, max).
+   */
+  HolidayCalendar(
+    Date min,
+    Date max,
+    std::vector<Date> const& holidays)
+    : index_(make_index(min, max, holidays))
   {
-    assert(min.is_valid() && max.is_valid());
   }
 
   ~HolidayCalendar() {}
 
-  Date get_min() const { return min_; }
-  Date get_max() const { return min_ + holidays_.size(); }
+  Date get_min() const { return index_.get_min(); }
+  Date get_max() const { return index_.get_max(); }
+
+  inline bool
+  contains(
+    Date date)
+    const
+  {
+    return index_.covers(date) && index_.contains(date);
+  }
 
   Date 
   shift(
@@ -237,15 +821,42 @@ public:
     ssize_t shift) 
     const
   {
-    while (shift > 0 && date.is_valid())
-      if (contains_(++date))
-        shift--;
-    while (shift < 0 && date.is_valid())
-      if (contains_(--date))
-        shift++;
-    return date;
+    if (index_.covers(date))
+      shift = index_.shift(date, shift);
+    return step_shift(date, shift);
+  }
+
+  Date
+  nearest(
+    Date date,
+    bool forward=true)
+    const
+  {
+    if (index_.covers(date) && index_.nearest(date, forward))
+      return date;
+    return step_nearest(date, forward);
   }
 
+  ssize_t
+  count(
+    Date date0,
+    Date date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    // No dates outside the range are contained.
+    return
+        date0 <= date1
+      ? index_.count(date0, date1)
+      : -(ssize_t) index_.count(date1, date0);
+  }
+
+  using CalendarTemplate::contains;
+  using CalendarTemplate::shift;
+  using CalendarTemplate::nearest;
+  using CalendarTemplate::count;
+
   // Mutators
 
   inline void
@@ -253,30 +864,33 @@ public:
     Date date,
     bool contained)
   {
-    ssize_t const index = date - min_;
-    if (!(0 <= index && index < (ssize_t) holidays_.size()))
+    if (!index_.covers(date))
       throw ValueError("date out of calendar range");
-    holidays_[index] = contained;
+    index_.set(date, contained);
   }
 
   void add(Date date)       { set(date, true); }
   void remove(Date date)    { set(date, false); }
 
-protected:
+private:
 
-  inline bool
-  contains_(
-    Date date)
-    const
+  static inline CalendarIndex
+  make_index(
+    Date min,
+    Date max,
+    std::vector<Date> const& holidays)
   {
-    return holidays_[date - min_];
+    std::vector<bool> mask(std::max(max - min, 0), false);
+    for (auto const& date : holidays) {
+      ssize_t const index = date - min;
+      if (!(date.is_valid() && 0 <= index && index < (ssize_t) mask.size()))
+        throw ValueError("date out of calendar range");
+      mask[index] = true;
+    }
+    return CalendarIndex(min, max, [&](Date date) { return mask[date - min]; });
   }
 
-
-private:
-
-  Date min_;
-  std::vector<bool> holidays_;
+  CalendarIndex index_;
 
 };
 
@@ -285,7 +899,8 @@ private:
 // Class WorkdayCalendar.
 
 class WorkdayCalendar
-  : public Calendar
+  final
+  : public CalendarTemplate<WorkdayCalendar>
 {
 public:
 
@@ -293,7 +908,11 @@ public:
     WeekdaysCalendar const& workdays, 
     HolidayCalendar const& holidays)
     : workdays_(workdays),
-      holidays_(holidays)
+      index_(
+        holidays.get_min(), holidays.get_max(),
+        [&](Date date) {
+          return workdays.contains(date) && !holidays.contains(date); 
+        })
   {
   }
 
@@ -305,21 +924,225 @@ public:
   }
 
   virtual ~WorkdayCalendar() {}
-  
-protected:
 
-  virtual inline bool 
-  contains_(
+  virtual Date get_min() const { return index_.get_min(); }
+  virtual Date get_max() const { return index_.get_max(); }
+
+  // Outside the range of the holiday calendar, only weekdays are considered;
+  // within it, the index is used.
+
+  inline bool 
+  contains(
     Date date) 
     const
   {
-    return workdays_.contains(date) && ! holidays_.contains(date);
+    return index_.covers(date) ? index_.contains(date) : workdays_.contains(date);
+  }
+
+  inline Date
+  shift(
+    Date date,
+    ssize_t shift)
+    const
+  {
+    if (index_.covers(date))
+      // Any remaining shift is away from the range.
+      shift = index_.shift(date, shift);
+    else if (date.is_valid() && (date < index_.get_min()) == (shift > 0))
+      // Toward the range.
+      return step_shift(date, shift);
+    return workdays_.shift(date, shift);
   }
 
+  inline Date
+  nearest(
+    Date date,
+    bool forward=true)
+    const
+  {
+    if (index_.covers(date) && index_.nearest(date, forward))
+      return date;
+    return step_nearest(date, forward);
+  }
+
+  inline ssize_t
+  count(
+    Date date0,
+    Date date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    if (date1 < date0)
+      return -count(date1, date0);
+
+    auto const min = index_.get_min();
+    auto const max = index_.get_max();
+    ssize_t count = index_.count(date0, date1);
+    if (date0 < min)
+      count += workdays_.count(date0, std::min(date1, min));
+    if (max < date1)
+      count += workdays_.count(std::max(date0, max), date1);
+    return count;
+  }
+
+  using CalendarTemplate::contains;
+  using CalendarTemplate::shift;
+  using CalendarTemplate::nearest;
+  using CalendarTemplate::count;
+
 private:
 
   WeekdaysCalendar workdays_;
-  HolidayCalendar holidays_;
+  CalendarIndex index_;
+
+};
+
+
+//------------------------------------------------------------------------------
+// Class CompositeCalendar.
+
+/*
+ * The union, intersection, or difference of two calendars.
+ *
+ * Over the range the two calendars have in common, the composite is
+ * materialized into its own index the first time it is used, so that it costs
+ * the same as a plain calendar, however it was built up.  Outside this range,
+ * the composite asks the two calendars.
+ *
+ * Use the get_*_calendar() functions, which share a composite for each
+ * combination of calendars while any caller holds it.
+ */
+class CompositeCalendar
+  final
+  : public CalendarTemplate<CompositeCalendar>
+{
+public:
+
+  enum Op
+  {
+    UNION,
+    INTERSECTION,
+    DIFFERENCE,
+  };
+
+  CompositeCalendar(
+    Op const op,
+    Calendar_ptr cal0,
+    Calendar_ptr cal1)
+    : op_(op),
+      cal0_(std::move(cal0)),
+      cal1_(std::move(cal1)),
+      min_(std::max(cal0_->get_min(), cal1_->get_min())),
+      max_(std::max(std::min(cal0_->get_max(), cal1_->get_max()), min_))
+  {
+  }
+
+  CompositeCalendar(CompositeCalendar const&) = delete;
+  void operator=(CompositeCalendar const&) = delete;
+
+  virtual ~CompositeCalendar() { delete index_.load(); }
+
+  Op get_op() const { return op_; }
+  Calendar_ptr const& get_calendar0() const { return cal0_; }
+  Calendar_ptr const& get_calendar1() const { return cal1_; }
+
+  virtual Date get_min() const { return min_; }
+  virtual Date get_max() const { return max_; }
+
+  inline bool
+  contains(
+    Date date)
+    const
+  {
+    auto const& index = get_index();
+    return index.covers(date) ? index.contains(date) : apply(date);
+  }
+
+  Date
+  shift(
+    Date date,
+    ssize_t shift)
+    const
+  {
+    auto const& index = get_index();
+    if (index.covers(date))
+      shift = index.shift(date, shift);
+    return step_shift(date, shift);
+  }
+
+  Date
+  nearest(
+    Date date,
+    bool forward=true)
+    const
+  {
+    auto const& index = get_index();
+    if (index.covers(date) && index.nearest(date, forward))
+      return date;
+    return step_nearest(date, forward);
+  }
+
+  ssize_t
+  count(
+    Date date0,
+    Date date1)
+    const
+  {
+    if (!date0.is_valid() || !date1.is_valid())
+      throw InvalidDateError();
+    if (date1 < date0)
+      return -count(date1, date0);
+
+    ssize_t count = get_index().count(date0, date1);
+    if (date0 < min_)
+      count += step_count(date0, std::min(date1, min_));
+    if (max_ < date1)
+      count += step_count(std::max(date0, max_), date1);
+    return count;
+  }
+
+  using CalendarTemplate::contains;
+  using CalendarTemplate::shift;
+  using CalendarTemplate::nearest;
+  using CalendarTemplate::count;
+
+private:
+
+  inline bool
+  apply(
+    Date const date)
+    const
+  {
+    switch (op_) {
+    case UNION:         return cal0_->contains(date) || cal1_->contains(date);
+    case INTERSECTION:  return cal0_->contains(date) && cal1_->contains(date);
+    case DIFFERENCE:    return cal0_->contains(date) && !cal1_->contains(date);
+    default:            return false;
+    }
+  }
+
+  /*
+   * Returns the index, materializing it on first use.
+   */
+  inline CalendarIndex const&
+  get_index()
+    const
+  {
+    auto index = index_.load(std::memory_order_acquire);
+    return index == nullptr ? materialize() : *index;
+  }
+
+  CalendarIndex const& materialize() const;
+
+  Op const op_;
+  Calendar_ptr const cal0_;
+  Calendar_ptr const cal1_;
+  Date const min_;
+  Date const max_;
+
+  mutable std::atomic<CalendarIndex const*> index_{nullptr};
+  mutable std::mutex mutex_;
 
 };
 
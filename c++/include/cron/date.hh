@@ -248,6 +248,105 @@ public:
       throw InvalidDateError();
   }
 
+  // Non-throwing factory methods  ---------------------------------------------
+
+  // Each of these is like the corresponding factory method above, but instead
+  // of throwing, returns `INVALID` and sets `error`.  On success, sets `error`
+  // to `ErrorCode::NONE`.
+
+  static DateTemplate
+  from_offset(
+    Offset const offset,
+    ErrorCode& error)
+  {
+    if (offset_is_valid(offset)) {
+      error = ErrorCode::NONE;
+      return DateTemplate(offset);
+    }
+    else {
+      error = ErrorCode::DATE_RANGE;
+      return INVALID;
+    }
+  }
+
+  static DateTemplate
+  from_datenum(
+    Datenum const datenum,
+    ErrorCode& error)
+  {
+    if (datenum_is_valid(datenum))
+      return from_offset(datenum_to_offset(datenum), error);
+    else {
+      error = ErrorCode::INVALID_DATE;
+      return INVALID;
+    }
+  }
+
+  static DateTemplate
+  from_ordinal_date(
+    Year const year,
+    Ordinal const ordinal,
+    ErrorCode& error)
+  {
+    if (ordinal_date_is_valid(year, ordinal))
+      return from_datenum(ordinal_date_to_datenum(year, ordinal), error);
+    else {
+      error = ErrorCode::INVALID_DATE;
+      return INVALID;
+    }
+  }
+
+  static DateTemplate
+  from_ymd(
+    Year const year,
+    Month const month,
+    Day const day,
+    ErrorCode& error)
+  {
+    if (ymd_is_valid(year, month, day))
+      return from_datenum(ymd_to_datenum(year, month, day), error);
+    else {
+      error = ErrorCode::INVALID_DATE;
+      return INVALID;
+    }
+  }
+
+  static DateTemplate
+  from_ymd(
+    DateParts const& parts,
+    ErrorCode& error)
+  {
+    return from_ymd(parts.year, parts.month, parts.day, error);
+  }
+
+  static DateTemplate
+  from_week_date(
+    Year const week_year,
+    Week const week,
+    Weekday const weekday,
+    ErrorCode& error)
+  {
+    if (week_date_is_valid(week_year, week, weekday))
+      return from_datenum(week_date_to_datenum(week_year, week, weekday), error);
+    else {
+      error = ErrorCode::INVALID_DATE;
+      return INVALID;
+    }
+  }
+
+  static DateTemplate
+  from_ymdi(
+    int const ymdi,
+    ErrorCode& error)
+  {
+    if (ymdi_is_valid(ymdi))
+      return from_datenum(ymdi_to_datenum(ymdi), error);
+    else {
+      error = ErrorCode::INVALID_DATE;
+      return INVALID;
+    }
+  }
+
   // Accessors  ----------------------------------------------------------------
 
   bool      is_valid()      const { return offset_is_valid(offset_); }
@@ -26,9 +26,33 @@ using namespace aslib;
 extern OrdinalDate datenum_to_ordinal_date(Datenum);
 
 /*
- * Returns YMD date parts for a date.
+ * Returns YMD date parts for a date.  Like datenum_to_ordinal_date(), returns
+ * invalid parts for an invalid datenum.
  */
-extern YmdDate datenum_to_ymd(Datenum, OrdinalDate);
+extern YmdDate datenum_to_ymd(Datenum);
+
+/*
+ * Returns YMD date parts for a date, given its ordinal date parts.  Only
+ * `ordinal_date`, which must be valid, is used; the datenum is accepted for
+ * symmetry with datenum_to_week_date().
+ */
+extern YmdDate datenum_to_ymd(Datenum, OrdinalDate ordinal_date);
+
+/*
+ * Returns YMD date parts for each of `count` dates.
+ *
+ * Unlike the scalar functions, checks validity: an invalid datenum produces
+ * invalid parts.  Uses SIMD instructions, if the CPU supports them.
+ */
+extern void datenum_to_ymd(Datenum const* datenums, size_t count, YmdDate* ymds);
+
+/*
+ * Returns the datenum for each of `count` YMD dates.
+ *
+ * Invalid date parts produce `DATENUM_INVALID`.  Uses SIMD instructions, if
+ * the CPU supports them.
+ */
+extern void ymd_to_datenum(YmdDate const* ymds, size_t count, Datenum* datenums);
 
 /*
  * Returns week date parts for a date.
@@ -43,7 +67,7 @@ extern DateParts datenum_to_parts(Datenum);
 /*
  * Parses an ISO-8601 extended date ("YYYY-MM-DD" format) into parts.
  *
- * FIXME: Remove this and use DateFormat.
+ * FIXME: Remove this in favor of DateParser.
  */
 extern DateParts iso_parse(std::string const& text);  
 
@@ -255,17 +279,6 @@ week_date_to_datenum(
 }
 
 
-/*
- * Returns YMD date parts for a date.
- */
-inline YmdDate
-datenum_to_ymd(
-  Datenum const datenum)
-{
-  return datenum_to_ymd(datenum, datenum_to_ordinal_date(datenum));
-}
-
-
 /*
  * Returns week date parts for a date.
  */
@@ -155,7 +155,8 @@ public:
     return {
       (Hour)   (minutes / MINS_PER_HOUR),
       (Minute) (minutes % MINS_PER_HOUR),
-      (Second) seconds / TRAITS::denominator
+      (Second) seconds / TRAITS::denominator,
+      make_fraction<Offset>(seconds % TRAITS::denominator, TRAITS::denominator)
     };
   }
 
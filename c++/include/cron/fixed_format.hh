@@ -0,0 +1,436 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "aslib/math.hh"
+#include "aslib/string_builder.hh"
+#include "cron/date.hh"
+#include "cron/daytime.hh"
+#include "cron/time.hh"
+#include "cron/time_zone.hh"
+#include "cron/types.hh"
+
+namespace cron {
+
+using namespace aslib;
+
+//------------------------------------------------------------------------------
+// Fixed format operations
+//------------------------------------------------------------------------------
+
+namespace fixed {
+
+/*
+ * The parts being formatted.  Parts that aren't available are null.
+ */
+struct Parts
+{
+  DateParts const*     date;
+  HmsDaytime const*    daytime;
+  TimeZoneParts const* time_zone;
+};
+
+
+// Parts a field needs.
+unsigned constexpr NEEDS_DATE       = 1 << 0;
+unsigned constexpr NEEDS_DAYTIME    = 1 << 1;
+unsigned constexpr NEEDS_TIME_ZONE  = 1 << 2;
+
+/*
+ * Writes exactly `WIDTH` decimal digits of `value` to `buf`, zero-padded.
+ */
+template<size_t WIDTH>
+inline char*
+write_digits(
+  char* const buf,
+  unsigned value)
+{
+  size_t i = WIDTH;
+  for (; i >= 2; i -= 2) {
+    memcpy(buf + i - 2, DIGIT_PAIRS + 2 * (value % 100), 2);
+    value /= 100;
+  }
+  if (i == 1)
+    buf[0] = '0' + value % 10;
+  return buf + WIDTH;
+}
+
+
+/*
+ * Each field has a fixed `WIDTH`, the parts it `NEEDS`, and a `write()`
+ * function that writes it and returns the end.  Fields produce the same
+ * text as the corresponding `Format` escapes with default modifiers.
+ */
+
+template<char CHR>
+struct Literal
+{
+  static size_t constexpr WIDTH = 1;
+  static unsigned constexpr NEEDS = 0;
+  static char* write(char* const buf, Parts const&)
+    { *buf = CHR; return buf + 1; }
+};
+
+
+/*
+ * A zero-padded numeric field, from a function of the parts.
+ */
+template<size_t WIDTH_, unsigned NEEDS_, unsigned (*GET)(Parts const&)>
+struct Numeric
+{
+  static size_t constexpr WIDTH = WIDTH_;
+  static unsigned constexpr NEEDS = NEEDS_;
+  static char* write(char* const buf, Parts const& parts)
+    { return write_digits<WIDTH>(buf, GET(parts)); }
+};
+
+
+inline unsigned get_year(Parts const& p)       { return p.date->year; }
+inline unsigned get_year2(Parts const& p)      { return p.date->year % 100; }
+inline unsigned get_month(Parts const& p)      { return p.date->month + 1; }
+inline unsigned get_day(Parts const& p)        { return p.date->day + 1; }
+inline unsigned get_ordinal(Parts const& p)    { return p.date->ordinal + 1; }
+inline unsigned get_week_year(Parts const& p)  { return p.date->week_year; }
+inline unsigned get_week_year2(Parts const& p) { return p.date->week_year % 100; }
+inline unsigned get_week(Parts const& p)       { return p.date->week + 1; }
+inline unsigned get_weekday(Parts const& p)
+  { return (p.date->weekday + (7 - SUNDAY)) % 7; }
+inline unsigned get_hour(Parts const& p)       { return p.daytime->hour; }
+inline unsigned get_minute(Parts const& p)     { return p.daytime->minute; }
+inline unsigned get_tz_hour(Parts const& p)
+  { return std::abs(p.time_zone->offset) / SECS_PER_HOUR; }
+inline unsigned get_tz_minute(Parts const& p)
+  { return std::abs(p.time_zone->offset) % SECS_PER_HOUR / SECS_PER_MIN; }
+
+
+/*
+ * Seconds, with `PRECISION` fractional digits, or -1 for no decimal point.
+ * Rounds as `Format` does.
+ */
+template<int PRECISION>
+struct Second
+{
+  static size_t constexpr WIDTH = 2 + (PRECISION >= 0 ? 1 + PRECISION : 0);
+  static unsigned constexpr NEEDS = NEEDS_DAYTIME;
+
+  static char*
+  write(
+    char* buf,
+    Parts const& parts)
+  {
+    unsigned const prec = PRECISION < 0 ? 0 : PRECISION;
+    auto const& daytime = *parts.daytime;
+    unsigned long long const digits
+      = daytime.fraction != FRACTION_INVALID
+        ? (unsigned long long) daytime.second * pow10(prec)
+          + get_fraction_digits(daytime.fraction, prec, true)
+        : daytime.second * pow10(prec) + 0.5;
+    buf = write_digits<2>(buf, digits / pow10(prec));
+    if (PRECISION >= 0) {
+      *buf++ = '.';
+      buf = write_digits<PRECISION < 0 ? 0 : PRECISION>(
+        buf, digits % pow10(prec));
+    }
+    return buf;
+  }
+};
+
+
+struct TimeZoneSign
+{
+  static size_t constexpr WIDTH = 1;
+  static unsigned constexpr NEEDS = NEEDS_TIME_ZONE;
+  static char* write(char* const buf, Parts const& parts)
+    { *buf = parts.time_zone->offset < 0 ? '-' : '+'; return buf + 1; }
+};
+
+
+//------------------------------------------------------------------------------
+
+/*
+ * The sequence of fields for a pattern, matched at compile time.
+ */
+template<char... PATTERN>
+struct Ops;
+
+
+template<>
+struct Ops<>
+{
+  static size_t constexpr WIDTH = 0;
+  static unsigned constexpr NEEDS = 0;
+  static char* write(char* const buf, Parts const&) { return buf; }
+};
+
+
+/*
+ * `FIELD`, followed by the rest of the pattern.
+ */
+template<class FIELD, char... REST>
+struct Then
+{
+  using Rest = Ops<REST...>;
+
+  static size_t constexpr WIDTH = FIELD::WIDTH + Rest::WIDTH;
+  static unsigned constexpr NEEDS = FIELD::NEEDS | Rest::NEEDS;
+
+  static char* write(char* const buf, Parts const& parts)
+    { return Rest::write(FIELD::write(buf, parts), parts); }
+};
+
+
+template<char CHR, char... REST>
+struct Ops<CHR, REST...>
+  : Then<Literal<CHR>, REST...>
+{
+  static_assert(CHR != '%', "unterminated escape in pattern");
+};
+
+
+template<char CODE, char... REST>
+struct Ops<'%', CODE, REST...>
+  : Ops<>
+{
+  static_assert(CODE == 0, "escape not supported in a fixed format");
+};
+
+
+template<char DIGIT, char... REST>
+struct Ops<'%', '.', DIGIT, 'S', REST...>
+  : Then<Second<DIGIT - '0'>, REST...>
+{
+  static_assert('0' <= DIGIT && DIGIT <= '9', "bad precision");
+};
+
+
+#define CRON_FIXED_ESCAPE_(CODE, ...)                                         \
+  template<char... REST>                                                      \
+  struct Ops<'%', CODE, REST...>                                              \
+    : Then<__VA_ARGS__, REST...> {};
+
+CRON_FIXED_ESCAPE_('%', Literal<'%'>)
+CRON_FIXED_ESCAPE_('Y', Numeric<4, NEEDS_DATE, get_year>)
+CRON_FIXED_ESCAPE_('y', Numeric<2, NEEDS_DATE, get_year2>)
+CRON_FIXED_ESCAPE_('m', Numeric<2, NEEDS_DATE, get_month>)
+CRON_FIXED_ESCAPE_('d', Numeric<2, NEEDS_DATE, get_day>)
+CRON_FIXED_ESCAPE_('j', Numeric<3, NEEDS_DATE, get_ordinal>)
+CRON_FIXED_ESCAPE_('G', Numeric<4, NEEDS_DATE, get_week_year>)
+CRON_FIXED_ESCAPE_('g', Numeric<2, NEEDS_DATE, get_week_year2>)
+CRON_FIXED_ESCAPE_('V', Numeric<2, NEEDS_DATE, get_week>)
+CRON_FIXED_ESCAPE_('w', Numeric<1, NEEDS_DATE, get_weekday>)
+CRON_FIXED_ESCAPE_('H', Numeric<2, NEEDS_DAYTIME, get_hour>)
+CRON_FIXED_ESCAPE_('M', Numeric<2, NEEDS_DAYTIME, get_minute>)
+CRON_FIXED_ESCAPE_('S', Second<-1>)
+CRON_FIXED_ESCAPE_('U', TimeZoneSign)
+CRON_FIXED_ESCAPE_('Q', Numeric<2, NEEDS_TIME_ZONE, get_tz_hour>)
+CRON_FIXED_ESCAPE_('q', Numeric<2, NEEDS_TIME_ZONE, get_tz_minute>)
+
+#undef CRON_FIXED_ESCAPE_
+
+// Case modifiers don't affect numbers.
+template<char... REST>
+struct Ops<'%', '^', 'w', REST...>
+  : Ops<'%', 'w', REST...> {};
+
+
+}  // namespace fixed
+
+//------------------------------------------------------------------------------
+// Class FixedFormat
+//------------------------------------------------------------------------------
+
+/*
+ * A format whose pattern is fixed at compile time, as a sequence of chars.
+ *
+ * The pattern is matched at compile time, so formatting is straight-line
+ * code that writes digits of known widths into a caller's buffer.  Every
+ * field has a fixed width; the supported escapes are %Y %y %m %d %j %G %g %V
+ * %w %H %M %S %.nS %U %Q %q and %%, without width or pad modifiers.  The
+ * output is the same as `Format` with the same pattern.
+ *
+ * An invalid or missing value is written as "INVALID" or "MISSING", padded
+ * or truncated to `WIDTH`.
+ */
+template<char... PATTERN>
+class FixedFormat
+{
+private:
+
+  using Ops = fixed::Ops<PATTERN...>;
+
+  static char*
+  write_special(
+    char* const buf,
+    char const* const str)
+  {
+    size_t const length = std::min<size_t>(strlen(str), WIDTH);
+    memcpy(buf, str, length);
+    memset(buf + length, ' ', WIDTH - length);
+    return buf + WIDTH;
+  }
+
+public:
+
+  /*
+   * The number of chars written.  The output isn't nul-terminated.
+   */
+  static size_t constexpr WIDTH = Ops::WIDTH;
+
+  static char*
+  format(
+    TimeParts const& parts,
+    char* const buf)
+  {
+    return Ops::write(buf, {&parts.date, &parts.daytime, &parts.time_zone});
+  }
+
+  template<class TRAITS>
+  static char*
+  format(
+    TimeTemplate<TRAITS> const time,
+    TimeZone const& tz,
+    char* const buf)
+  {
+    return
+      time.is_valid() ? format(time.get_parts(tz), buf)
+      : write_special(buf, time.is_missing() ? "MISSING" : "INVALID");
+  }
+
+  template<class TRAITS>
+  static char*
+  format(
+    TimeTemplate<TRAITS> const time,
+    char* const buf)
+  {
+    return format(time, *get_display_time_zone(), buf);
+  }
+
+  static char*
+  format(
+    DateParts const& parts,
+    char* const buf)
+  {
+    static_assert(
+      (Ops::NEEDS & ~fixed::NEEDS_DATE) == 0,
+      "pattern needs more than a date");
+    return Ops::write(buf, {&parts, nullptr, nullptr});
+  }
+
+  template<class TRAITS>
+  static char*
+  format(
+    DateTemplate<TRAITS> const date,
+    char* const buf)
+  {
+    return
+      date.is_valid() ? format(date.get_parts(), buf)
+      : write_special(buf, date.is_missing() ? "MISSING" : "INVALID");
+  }
+
+  static char*
+  format(
+    HmsDaytime const& parts,
+    char* const buf)
+  {
+    static_assert(
+      (Ops::NEEDS & ~fixed::NEEDS_DAYTIME) == 0,
+      "pattern needs more than a daytime");
+    return Ops::write(buf, {nullptr, &parts, nullptr});
+  }
+
+  template<class TRAITS>
+  static char*
+  format(
+    DaytimeTemplate<TRAITS> const daytime,
+    char* const buf)
+  {
+    return
+      daytime.is_valid() ? format(daytime.get_hms(), buf)
+      : write_special(buf, daytime.is_missing() ? "MISSING" : "INVALID");
+  }
+
+};
+
+
+template<char... PATTERN>
+size_t constexpr FixedFormat<PATTERN...>::WIDTH;
+
+
+/*
+ * Formats with a `FixedFormat`, e.g.
+ *
+ *   char buf[fixed::IsoUtcExtended::WIDTH];
+ *   char* end = format<fixed::IsoUtcExtended>(time, *UTC, buf);
+ */
+template<class FORMAT, class... ARGS>
+inline char*
+format(
+  ARGS&&... args)
+{
+  return FORMAT::format(std::forward<ARGS>(args)...);
+}
+
+
+//------------------------------------------------------------------------------
+// Fixed ISO formats
+//------------------------------------------------------------------------------
+
+namespace fixed {
+
+// Same as `TimeFormat::ISO_*`.
+using IsoLocalBasic = FixedFormat<
+  '%','Y','%','m','%','d','T','%','H','%','M','%','S'>;
+using IsoLocalExtended = FixedFormat<
+  '%','Y','-','%','m','-','%','d','T','%','H',':','%','M',':','%','S'>;
+using IsoUtcBasic = FixedFormat<
+  '%','Y','%','m','%','d','T','%','H','%','M','%','S','Z'>;
+using IsoUtcExtended = FixedFormat<
+  '%','Y','-','%','m','-','%','d','T','%','H',':','%','M',':','%','S','Z'>;
+using IsoZoneBasic = FixedFormat<
+  '%','Y','%','m','%','d','T','%','H','%','M','%','S',
+  '%','U','%','Q','%','q'>;
+using IsoZoneExtended = FixedFormat<
+  '%','Y','-','%','m','-','%','d','T','%','H',':','%','M',':','%','S',
+  '%','U','%','Q',':','%','q'>;
+
+// Same as `DateFormat::ISO_*`.
+using IsoCalendarBasic = FixedFormat<
+  '%','Y','%','m','%','d'>;
+using IsoCalendarExtended = FixedFormat<
+  '%','Y','-','%','m','-','%','d'>;
+using IsoOrdinalBasic = FixedFormat<
+  '%','Y','%','j'>;
+using IsoOrdinalExtended = FixedFormat<
+  '%','Y','-','%','j'>;
+using IsoWeekBasic = FixedFormat<
+  '%','G','W','%','V','%','^','w'>;
+using IsoWeekExtended = FixedFormat<
+  '%','G','-','W','%','V','-','%','^','w'>;
+
+// Same as `DaytimeFormat::ISO_*`.
+using IsoDaytimeBasic = FixedFormat<
+  '%','H','%','M','%','S'>;
+using IsoDaytimeExtended = FixedFormat<
+  '%','H',':','%','M',':','%','S'>;
+using IsoDaytimeBasicMsec = FixedFormat<
+  '%','H','%','M','%','.','3','S'>;
+using IsoDaytimeExtendedMsec = FixedFormat<
+  '%','H',':','%','M',':','%','.','3','S'>;
+using IsoDaytimeBasicUsec = FixedFormat<
+  '%','H','%','M','%','.','6','S'>;
+using IsoDaytimeExtendedUsec = FixedFormat<
+  '%','H',':','%','M',':','%','.','6','S'>;
+using IsoDaytimeBasicNsec = FixedFormat<
+  '%','H','%','M','%','.','9','S'>;
+using IsoDaytimeExtendedNsec = FixedFormat<
+  '%','H',':','%','M',':','%','.','9','S'>;
+
+}  // namespace fixed
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stack>
 #include <string>
+#include <vector>
 
 #include "aslib/exc.hh"
 #include "aslib/ptr.hh"
@@ -25,6 +27,43 @@ class Format
 {
 public:
 
+  /*
+   * A compiled pattern operation: a run of literal text, or an escape with
+   * its modifiers.
+   */
+  struct Op
+  {
+    enum Kind : uint8_t
+    {
+      // A run of literal text, `literals_[index]`.
+      LITERAL,
+      // An escape that needs date parts.
+      DATE,
+      // An escape that needs daytime parts.
+      DAYTIME,
+      // An escape that needs time zone parts.
+      TIME_ZONE,
+      // An escape that needs all three.
+      TIME,
+      // An escape character that isn't in any category.
+      UNKNOWN,
+      // An error in the pattern itself, `error_`.
+      ERROR,
+    };
+
+    Kind kind;
+    // The escape character.
+    char code;
+    char pad;
+    char str_case;
+    bool abbreviate;
+    int precision;
+    int width;
+    // Index into `literals_`, for literal text.
+    size_t index;
+
+  };
+
   Format(
     std::string const& pattern,
     std::string const& invalid="INVALID", 
@@ -33,16 +72,15 @@ public:
       invalid_(invalid), 
       missing_(missing) 
   {
+    compile();
   }
 
   Format(
     char const* pattern) 
     : pattern_(pattern)
   {
-    static DateParts const date_parts{0, 0, 0, 0, 0, 0, 0};
-    static HmsDaytime const daytime_parts{0, 0, 0};
-    static TimeZoneParts const time_zone_parts{0, "", false};
-    size_t const width = format(&date_parts, &daytime_parts, &time_zone_parts).length();
+    compile();
+    size_t const width = get_nominal_width();
     invalid_ = std::string(width, ' ');
     invalid_.replace(0, 7, "INVALID");
     missing_ = std::string(width, ' ');
@@ -53,6 +91,17 @@ public:
   std::string const& get_invalid() const { return invalid_; }
   std::string const& get_missing() const { return missing_; }
 
+  /*
+   * An upper bound on the length of any string this format produces,
+   * including the invalid and missing representations.
+   */
+  size_t
+  get_max_width()
+    const
+  {
+    return std::max({max_width_, invalid_.length(), missing_.length()});
+  }
+
 protected:
 
   std::string 
@@ -62,19 +111,103 @@ protected:
     TimeZoneParts const* time_zone_parts)
     const
   {
-    StringBuilder sb;
+    char buf[64];
+    StringBuilder sb(buf, sizeof(buf));
     format(sb, date_parts, daytime_parts, time_zone_parts);
     return sb.str();
   }
 
+  /*
+   * Formats into `buf`, which has room for `size` chars.  Returns the full
+   * length; if that exceeds `size`, only the first `size` chars are written.
+   * The result is not nul-terminated.
+   */
+  size_t
+  format(
+    char* const          buf,
+    size_t const         size,
+    DateParts const*     date_parts, 
+    HmsDaytime const*    daytime_parts, 
+    TimeZoneParts const* time_zone_parts)
+    const
+  {
+    StringBuilder sb(buf, size);
+    format(sb, date_parts, daytime_parts, time_zone_parts);
+    if (sb.data() != buf)
+      // Didn't fit; copy what does.
+      memcpy(buf, sb.data(), size);
+    return sb.length();
+  }
+
+  /*
+   * Copies `str` into `buf`, as above.
+   */
+  static size_t
+  copy_to(
+    char* const buf,
+    size_t const size,
+    std::string const& str)
+  {
+    memcpy(buf, str.data(), std::min(size, str.length()));
+    return str.length();
+  }
+
+  void
+  format(
+    StringBuilder& sb,
+    DateParts const* date_parts,
+    HmsDaytime const* daytime_parts,
+    TimeZoneParts const* time_zone_parts)
+    const
+  {
+    format(sb, date_parts, daytime_parts, time_zone_parts, 0, ops_.size());
+  }
+
+  /*
+   * Formats only ops `[begin, end)`.
+   */
+  void format(
+    StringBuilder&, DateParts const*, HmsDaytime const*, TimeZoneParts const*,
+    size_t begin, size_t end) const;
+
+  /*
+   * Returns the number of leading ops whose output depends on the time only
+   * to the minute.
+   */
+  size_t get_num_minute_ops() const;
+
+  size_t get_num_ops() const { return ops_.size(); }
+
 private:
 
-  void format(StringBuilder&, DateParts const*, HmsDaytime const*, TimeZoneParts const*) const;
+  friend class Parser;
+  friend class TimeFormatter;
+
+  /*
+   * Compiles `pattern_` into `ops_`.  Errors in the pattern are raised when
+   * formatting, not here.
+   */
+  void compile();
+
+  /*
+   * The length of the output for all-zero parts, which sets the width of the
+   * default invalid and missing representations.  Raises the error, if the
+   * pattern has one.
+   */
+  size_t get_nominal_width() const;
 
   std::string pattern_;
   std::string invalid_;
   std::string missing_;
 
+  std::vector<Op> ops_;
+  std::vector<std::string> literals_;
+  // The widest output of `ops_`.
+  size_t max_width_;
+  // The pattern error, and whether it is a `ValueError`.
+  std::string error_;
+  bool value_error_ = false;
+
 };
 
 
@@ -112,6 +245,21 @@ public:
     return format(&parts.date, &parts.daytime, &parts.time_zone); 
   }
 
+  /*
+   * Formats parts that refer to their time zone by ID.  If the time zone
+   * isn't in the registry, raises ValueError.
+   */
+  std::string
+  operator()(
+    TimeIdParts const& parts) 
+    const 
+  { 
+    // Recover the abbreviation from the time zone.
+    auto const& time_zone = 
+      get_time_zone(parts.time_zone.id).get_type_parts(parts.time_zone.type);
+    return format(&parts.date, &parts.daytime, &time_zone); 
+  }
+
   template<class TRAITS> 
   std::string
   operator()(
@@ -132,7 +280,17 @@ public:
     std::string const& tz_name) 
     const 
   { 
-    return operator()(time, get_time_zone(tz_name)); 
+    return operator()(time, *get_time_zone(tz_name)); 
+  }
+
+  template<class TRAITS> 
+  std::string
+  operator()(
+    TimeTemplate<TRAITS> time, 
+    TimeZoneId tz_id) 
+    const 
+  { 
+    return operator()(time, get_time_zone(tz_id)); 
   }
 
   template<class TRAITS> 
@@ -144,6 +302,69 @@ public:
     return operator()(time, *get_display_time_zone()); 
   }
 
+  /*
+   * Formats `time` into `buf`, which has room for `size` chars, without
+   * allocating.  Returns the full length; if that exceeds `size`, only the
+   * first `size` chars are written.  The result is not nul-terminated.
+   * A buffer of `get_max_width()` chars always suffices.
+   */
+  template<class TRAITS>
+  size_t
+  format_to(
+    char* const buf,
+    size_t const size,
+    TimeTemplate<TRAITS> const time,
+    TimeZone const& tz)
+    const
+  {
+    if (time.is_valid()) {
+      auto const parts = time.get_parts(tz);
+      return format(buf, size, &parts.date, &parts.daytime, &parts.time_zone);
+    }
+    else
+      return copy_to(buf, size, time.is_missing() ? get_missing() : get_invalid());
+  }
+
+  template<class TRAITS>
+  size_t
+  format_to(
+    char* const buf,
+    size_t const size,
+    TimeTemplate<TRAITS> const time)
+    const
+  {
+    return format_to(buf, size, time, *get_display_time_zone());
+  }
+
+  /*
+   * Appends `time` to `sb`.
+   */
+  template<class TRAITS>
+  void
+  format_to(
+    StringBuilder& sb,
+    TimeTemplate<TRAITS> const time,
+    TimeZone const& tz)
+    const
+  {
+    if (time.is_valid()) {
+      auto const parts = time.get_parts(tz);
+      format(sb, &parts.date, &parts.daytime, &parts.time_zone);
+    }
+    else
+      sb << (time.is_missing() ? get_missing() : get_invalid());
+  }
+
+  template<class TRAITS>
+  void
+  format_to(
+    StringBuilder& sb,
+    TimeTemplate<TRAITS> const time)
+    const
+  {
+    format_to(sb, time, *get_display_time_zone());
+  }
+
 };
 
 
@@ -167,6 +388,149 @@ operator<<(
 }
 
 
+//------------------------------------------------------------------------------
+
+/*
+ * Formats a sequence of times, each usually close to the previous one, as
+ * log timestamps are.
+ *
+ * Caches the output of the pattern up to its first seconds field, along
+ * with the date and time zone parts, for the current local minute; and the
+ * current time zone interval, with a cursor.  Within a minute, formats only
+ * the rest of the pattern.  The output is the same as the `TimeFormat`'s.
+ *
+ * A formatter is stateful, so may not be used from more than one thread at a
+ * time.
+ */
+class TimeFormatter
+{
+public:
+
+  TimeFormatter(
+    TimeFormat const& format, 
+    TimeZone_ptr tz=get_display_time_zone());
+  TimeFormatter(
+    TimeFormat const& format, 
+    std::string const& tz_name)
+    : TimeFormatter(format, cron::get_time_zone(tz_name)) 
+  {
+  }
+
+  TimeFormat const& get_format() const { return format_; }
+  TimeZone const& get_time_zone() const { return *tz_; }
+
+  /*
+   * Number of times formatted from the cached prefix, or not.
+   */
+  uint64_t get_hits()   const { return hits_; }
+  uint64_t get_misses() const { return misses_; }
+
+  template<class TRAITS>
+  std::string
+  operator()(
+    TimeTemplate<TRAITS> const time)
+  {
+    char buf[64];
+    StringBuilder sb(buf, sizeof(buf));
+    format_to(sb, time);
+    return sb.str();
+  }
+
+  /*
+   * As `TimeFormat::format_to()`.
+   */
+  template<class TRAITS>
+  size_t
+  format_to(
+    char* const buf,
+    size_t const size,
+    TimeTemplate<TRAITS> const time)
+  {
+    StringBuilder sb(buf, size);
+    format_to(sb, time);
+    if (sb.data() != buf)
+      // Didn't fit; copy what does.
+      memcpy(buf, sb.data(), size);
+    return sb.length();
+  }
+
+  template<class TRAITS>
+  void
+  format_to(
+    StringBuilder& sb,
+    TimeTemplate<TRAITS> const time)
+  {
+    using Time = TimeTemplate<TRAITS>;
+    using Offset = typename Time::Offset;
+
+    if (! time.is_valid()) {
+      sb << (time.is_missing() ? format_.get_missing() : format_.get_invalid());
+      return;
+    }
+
+    auto const time_zone = tz_->get_parts(time, cursor_);
+    // The local offset, and the minute and offset into the minute.
+    Offset const offset 
+      = (Offset) (time.get_offset() + time_zone.offset * Time::DENOMINATOR);
+    Offset const per_minute = SECS_PER_MIN * Time::DENOMINATOR;
+    int64_t const base_minute 
+      = (int64_t) (offset / per_minute) 
+        - (offset < 0 && offset % per_minute != 0 ? 1 : 0);
+    Offset const minute_offset = (Offset) (offset - base_minute * per_minute);
+    // Count the minute from datenum 0, as time types have different bases.
+    int64_t const minute 
+      = (int64_t) Time::BASE * MINS_PER_DAY + base_minute;
+
+    if (   minute == minute_
+        && time_zone.offset == time_zone_.offset
+        && time_zone.is_dst == time_zone_.is_dst
+        && strcmp(time_zone.abbreviation, time_zone_.abbreviation) == 0)
+      ++hits_;
+    else {
+      ++misses_;
+      set_prefix(minute, time_zone);
+    }
+
+    sb << prefix_;
+    if (num_minute_ops_ < format_.get_num_ops()) {
+      HmsDaytime const daytime{
+        daytime_.hour,
+        daytime_.minute,
+        (Second) minute_offset / Time::DENOMINATOR,
+        make_fraction<Offset>(
+          minute_offset % Time::DENOMINATOR, Time::DENOMINATOR)
+      };
+      format_.format(
+        sb, &date_, &daytime, &time_zone_, 
+        num_minute_ops_, format_.get_num_ops());
+    }
+  }
+
+private:
+
+  /*
+   * Caches the parts of a new local minute, and formats the prefix.
+   */
+  void set_prefix(int64_t minute, TimeZoneParts const& time_zone);
+
+  TimeFormat const format_;
+  TimeZone_ptr const tz_;
+  TimeZone::Cursor cursor_;
+  size_t const num_minute_ops_;
+
+  // The local minute of the cached parts, counted from datenum 0.
+  int64_t minute_;
+  DateParts date_;
+  HmsDaytime daytime_;
+  TimeZoneParts time_zone_;
+  std::string prefix_;
+
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+
+};
+
+
 //------------------------------------------------------------------------------
 
 class DateFormat
@@ -214,6 +578,40 @@ public:
       : get_invalid();
   }
 
+  /*
+   * Formats `date` into `buf` without allocating, as `TimeFormat::format_to()`.
+   */
+  template<class TRAITS>
+  size_t
+  format_to(
+    char* const buf,
+    size_t const size,
+    DateTemplate<TRAITS> const date)
+    const
+  {
+    if (date.is_valid()) {
+      auto const parts = date.get_parts();
+      return format(buf, size, &parts, nullptr, nullptr);
+    }
+    else
+      return copy_to(buf, size, date.is_missing() ? get_missing() : get_invalid());
+  }
+
+  template<class TRAITS>
+  void
+  format_to(
+    StringBuilder& sb,
+    DateTemplate<TRAITS> const date)
+    const
+  {
+    if (date.is_valid()) {
+      auto const parts = date.get_parts();
+      format(sb, &parts, nullptr, nullptr);
+    }
+    else
+      sb << (date.is_missing() ? get_missing() : get_invalid());
+  }
+
 };
 
 
@@ -286,6 +684,42 @@ public:
       : get_invalid();
   }
 
+  /*
+   * Formats `daytime` into `buf` without allocating, as
+   * `TimeFormat::format_to()`.
+   */
+  template<class TRAITS>
+  size_t
+  format_to(
+    char* const buf,
+    size_t const size,
+    DaytimeTemplate<TRAITS> const daytime)
+    const
+  {
+    if (daytime.is_valid()) {
+      auto const hms = daytime.get_hms();
+      return format(buf, size, nullptr, &hms, nullptr);
+    }
+    else
+      return copy_to(
+        buf, size, daytime.is_missing() ? get_missing() : get_invalid());
+  }
+
+  template<class TRAITS>
+  void
+  format_to(
+    StringBuilder& sb,
+    DaytimeTemplate<TRAITS> const daytime)
+    const
+  {
+    if (daytime.is_valid()) {
+      auto const hms = daytime.get_hms();
+      format(sb, nullptr, &hms, nullptr);
+    }
+    else
+      sb << (daytime.is_missing() ? get_missing() : get_invalid());
+  }
+
 };
 
 
@@ -0,0 +1,624 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "aslib/exc.hh"
+#include "cron/date.hh"
+#include "cron/daytime.hh"
+#include "cron/format.hh"
+#include "cron/time.hh"
+#include "cron/time_zone.hh"
+#include "cron/types.hh"
+
+namespace cron {
+
+using namespace aslib;
+
+//------------------------------------------------------------------------------
+
+/*
+ * The inverse of `Format`: scans strings that match a format pattern.
+ *
+ * The pattern is compiled once, on construction, into a sequence of
+ * operations; scanning then neither allocates nor reparses the pattern.
+ * Numeric fields must have exactly the width the pattern gives them, with
+ * optional leading pad characters, as `Format` produces them.  Month and
+ * weekday names and AM/PM are matched without regard to case.  A time zone
+ * abbreviation, "%~Z", is matched but otherwise ignored.
+ */
+class Parser
+{
+public:
+
+  /*
+   * A compiled pattern operation: a literal character, or an escape that
+   * scans one field.
+   */
+  struct Op
+  {
+    enum Kind : uint8_t
+    {
+      LITERAL,
+      YEAR,
+      YEAR2,
+      MONTH,
+      MONTH_NAME,
+      MONTH_ABBR,
+      DAY,
+      ORDINAL,
+      WEEK_YEAR,
+      WEEK_YEAR2,
+      WEEK,
+      WEEKDAY,
+      WEEKDAY_NAME,
+      WEEKDAY_ABBR,
+      HOUR,
+      HOUR12,
+      AM_PM,
+      MINUTE,
+      SECOND,
+      MSEC,
+      USEC,
+      NSEC,
+      PSEC,
+      TZ_SIGN,
+      TZ_HOUR,
+      TZ_MINUTE,
+      TZ_SECONDS,
+      TZ_ABBR,
+    };
+
+    Kind kind;
+    // Number of digits, for numeric fields; or minimum width, for names.
+    uint8_t width;
+    // Number of fractional digits for SECOND, or -1 for no decimal point.
+    int8_t precision;
+    // The literal character, or the pad character.
+    char chr;
+
+  };
+
+  std::string const& get_pattern() const { return pattern_; }
+
+protected:
+
+  // Categories of escapes a parser accepts.
+  enum Category : unsigned
+  {
+    DATE_ESCAPES      = 1 << 0,
+    DAYTIME_ESCAPES   = 1 << 1,
+    TIME_ZONE_ESCAPES = 1 << 2,
+  };
+
+  /*
+   * Values scanned from a string, as they appear there.
+   */
+  struct Fields
+  {
+    unsigned year;
+    unsigned month;
+    unsigned day;
+    unsigned ordinal;
+    unsigned week_year;
+    unsigned week;
+    unsigned weekday;
+    unsigned hour;
+    unsigned minute;
+    unsigned second;
+    // Fractional seconds, in picoseconds.
+    uint64_t psec;
+    bool pm;
+    int tz_sign;
+    unsigned tz_hour;
+    unsigned tz_minute;
+    unsigned tz_seconds;
+  };
+
+  /*
+   * Compiles `pattern`.  Raises `TimeFormatError` if it contains an escape
+   * not in `categories`.
+   */
+  Parser(std::string const& pattern, unsigned categories);
+
+  /*
+   * Scans all of [begin, end) into `fields`.  Returns false if the text
+   * doesn't match the pattern.
+   */
+  bool scan(char const* begin, char const* end, Fields& fields) const;
+
+  /*
+   * True if the pattern can produce a full date, daytime, or UTC offset.
+   */
+  bool has_date() const;
+  bool has_daytime() const;
+  bool has_offset() const;
+
+  /*
+   * Converts scanned fields.  Each returns the invalid value and sets `error`
+   * if the fields don't specify a valid value.
+   */
+  Datenum get_datenum(Fields const& fields, ErrorCode& error) const;
+  Daytick get_daytick(Fields const& fields, ErrorCode& error) const;
+  TimeZoneOffset get_offset(Fields const& fields) const;
+
+  /*
+   * Calls `fn(field_begin, field_end, i)` for each field in [begin, end),
+   * separated by `delimiter`, up to `max` fields.  A trailing delimiter
+   * doesn't start another field.  Returns the number of fields.
+   */
+  template<class FN>
+  static size_t
+  for_each_field(
+    char const* begin,
+    char const* const end,
+    char const delimiter,
+    size_t const max,
+    FN&& fn)
+  {
+    size_t i = 0;
+    while (i < max && begin < end) {
+      auto const next = (char const*) memchr(begin, delimiter, end - begin);
+      auto const field_end = next == nullptr ? end : next;
+      fn(begin, field_end, i++);
+      begin = next == nullptr ? end : next + 1;
+    }
+    return i;
+  }
+
+private:
+
+  std::string pattern_;
+  std::vector<Op> ops_;
+  // Bit set of the fields that appear in the pattern.
+  unsigned fields_;
+
+};
+
+
+//------------------------------------------------------------------------------
+
+class DateParser
+  : public Parser
+{
+public:
+
+  /*
+   * Raises `TimeFormatError` unless the pattern contains a year, month, and
+   * day; a year and ordinal; or a week year, week, and weekday.
+   */
+  DateParser(std::string const& pattern);
+  DateParser(char const* pattern) : DateParser(std::string(pattern)) {}
+  DateParser(DateFormat const& format) : DateParser(format.get_pattern()) {}
+
+  /*
+   * Parses all of [begin, end).  On failure, returns `INVALID` and sets
+   * `error`.
+   */
+  template<class DATE=Date>
+  DATE
+  parse(
+    char const* const begin,
+    char const* const end,
+    ErrorCode& error)
+    const
+  {
+    Fields fields;
+    if (! scan(begin, end, fields)) {
+      error = ErrorCode::PARSE;
+      return DATE::INVALID;
+    }
+    auto const datenum = get_datenum(fields, error);
+    return
+      error == ErrorCode::NONE ? DATE::from_datenum(datenum, error)
+      : DATE::INVALID;
+  }
+
+  /*
+   * Parses a string.  Raises an exception on failure.
+   */
+  template<class DATE=Date>
+  DATE
+  parse(
+    std::string const& str)
+    const
+  {
+    ErrorCode error;
+    auto const date = parse<DATE>(str.data(), str.data() + str.size(), error);
+    if (error == ErrorCode::PARSE)
+      throw TimeParseError(str);
+    else if (error != ErrorCode::NONE)
+      throw_error(error);
+    return date;
+  }
+
+  /*
+   * Parses up to `max` fields in [begin, end), separated by `delimiter`, into
+   * `dates`.  Fields that don't parse produce `INVALID`.  Returns the number
+   * of fields.
+   */
+  template<class DATE>
+  size_t
+  parse(
+    char const* const begin,
+    char const* const end,
+    char const delimiter,
+    DATE* const dates,
+    size_t const max)
+    const
+  {
+    return for_each_field(
+      begin, end, delimiter, max,
+      [this, dates] (char const* const b, char const* const e, size_t const i) {
+        ErrorCode error;
+        dates[i] = parse<DATE>(b, e, error);
+      });
+  }
+
+};
+
+
+//------------------------------------------------------------------------------
+
+class DaytimeParser
+  : public Parser
+{
+public:
+
+  /*
+   * Raises `TimeFormatError` unless the pattern contains an hour.
+   */
+  DaytimeParser(std::string const& pattern);
+  DaytimeParser(char const* pattern) : DaytimeParser(std::string(pattern)) {}
+  DaytimeParser(DaytimeFormat const& format)
+    : DaytimeParser(format.get_pattern()) {}
+
+  template<class DAYTIME=Daytime>
+  DAYTIME
+  parse(
+    char const* const begin,
+    char const* const end,
+    ErrorCode& error)
+    const
+  {
+    Fields fields;
+    if (! scan(begin, end, fields)) {
+      error = ErrorCode::PARSE;
+      return DAYTIME::INVALID;
+    }
+    auto const daytick = get_daytick(fields, error);
+    return
+      error == ErrorCode::NONE ? DAYTIME::from_daytick(daytick)
+      : DAYTIME::INVALID;
+  }
+
+  template<class DAYTIME=Daytime>
+  DAYTIME
+  parse(
+    std::string const& str)
+    const
+  {
+    ErrorCode error;
+    auto const daytime
+      = parse<DAYTIME>(str.data(), str.data() + str.size(), error);
+    if (error == ErrorCode::PARSE)
+      throw TimeParseError(str);
+    else if (error != ErrorCode::NONE)
+      throw_error(error);
+    return daytime;
+  }
+
+  template<class DAYTIME>
+  size_t
+  parse(
+    char const* const begin,
+    char const* const end,
+    char const delimiter,
+    DAYTIME* const daytimes,
+    size_t const max)
+    const
+  {
+    return for_each_field(
+      begin, end, delimiter, max,
+      [this, daytimes] (char const* const b, char const* const e, size_t const i) {
+        ErrorCode error;
+        daytimes[i] = parse<DAYTIME>(b, e, error);
+      });
+  }
+
+};
+
+
+//------------------------------------------------------------------------------
+
+class TimeParser
+  : public Parser
+{
+public:
+
+  /*
+   * Raises `TimeFormatError` unless the pattern contains a full date and an
+   * hour.
+   */
+  TimeParser(std::string const& pattern);
+  TimeParser(char const* pattern) : TimeParser(std::string(pattern)) {}
+  TimeParser(TimeFormat const& format) : TimeParser(format.get_pattern()) {}
+
+  /*
+   * Parses all of [begin, end).  If the pattern has a UTC offset, uses it;
+   * otherwise, the time is local to `tz`, and ambiguous times are resolved by
+   * `first`.  On failure, returns `INVALID` and sets `error`.
+   */
+  template<class TIME=Time>
+  TIME
+  parse(
+    char const* const begin,
+    char const* const end,
+    TimeZone const& tz,
+    bool const first,
+    ErrorCode& error)
+    const
+  {
+    Fields fields;
+    if (! scan(begin, end, fields)) {
+      error = ErrorCode::PARSE;
+      return TIME::INVALID;
+    }
+    auto const datenum = get_datenum(fields, error);
+    if (error != ErrorCode::NONE)
+      return TIME::INVALID;
+    auto const daytick = get_daytick(fields, error);
+    if (error != ErrorCode::NONE)
+      return TIME::INVALID;
+    return
+      has_offset()
+      ? TIME::from_local(datenum, daytick, get_offset(fields), error)
+      : TIME::from_local(datenum, daytick, tz, first, error);
+  }
+
+  template<class TIME=Time>
+  TIME
+  parse(
+    std::string const& str,
+    TimeZone const& tz,
+    bool const first=true)
+    const
+  {
+    ErrorCode error;
+    auto const time
+      = parse<TIME>(str.data(), str.data() + str.size(), tz, first, error);
+    if (error == ErrorCode::PARSE)
+      throw TimeParseError(str);
+    else if (error != ErrorCode::NONE)
+      throw_error(error);
+    return time;
+  }
+
+  template<class TIME=Time>
+  TIME
+  parse(
+    std::string const& str)
+    const
+  {
+    return parse<TIME>(str, *get_display_time_zone());
+  }
+
+  /*
+   * Parses up to `max` fields in [begin, end), separated by `delimiter`, into
+   * `times`.  Fields that don't parse or don't exist produce `INVALID`.
+   * Returns the number of fields.
+   */
+  template<class TIME>
+  size_t
+  parse(
+    char const* begin,
+    char const* const end,
+    char const delimiter,
+    TIME* const times,
+    size_t const max,
+    TimeZone const& tz,
+    bool const first=true)
+    const
+  {
+    if (has_offset())
+      return for_each_field(
+        begin, end, delimiter, max,
+        [&] (char const* const b, char const* const e, size_t const i) {
+          ErrorCode error;
+          times[i] = parse<TIME>(b, e, tz, first, error);
+        });
+
+    // Scan local times in chunks, then convert each chunk together.
+    size_t constexpr CHUNK = 256;
+    Datenum datenums[CHUNK];
+    Daytick dayticks[CHUNK];
+    LocalTimeStatus statuses[CHUNK];
+    size_t count = 0;
+    while (count < max && begin < end) {
+      size_t const num = for_each_field(
+        begin, end, delimiter, std::min(CHUNK, max - count),
+        [&] (char const* const b, char const* const e, size_t const i) {
+          Fields fields;
+          ErrorCode error = ErrorCode::NONE;
+          if (scan(b, e, fields)) {
+            datenums[i] = get_datenum(fields, error);
+            dayticks[i] = get_daytick(fields, error);
+          }
+          else
+            error = ErrorCode::PARSE;
+          // The batch conversion produces INVALID for these.
+          if (error != ErrorCode::NONE) {
+            datenums[i] = DATENUM_INVALID;
+            dayticks[i] = DAYTICK_INVALID;
+          }
+          begin = e == end ? end : e + 1;
+        });
+      TIME::from_local(
+        datenums, dayticks, num, tz, first, times + count, statuses);
+      count += num;
+    }
+    return count;
+  }
+
+};
+
+
+//------------------------------------------------------------------------------
+// ISO 8601 fast path
+//------------------------------------------------------------------------------
+
+/*
+ * A time scanned from the fixed ISO 8601 layout
+ * "YYYY-MM-DDTHH:MM:SS[.fffffffff](Z|+HH:MM)", which covers
+ * `TimeFormat::ISO_UTC_EXTENDED` and `TimeFormat::ISO_ZONE_EXTENDED`.  The
+ * fraction has one to nine digits.
+ */
+struct IsoTime
+{
+  Datenum datenum;
+  // Seconds since midnight, local time.
+  uint32_t ssm;
+  uint32_t nsec;
+  TimeZoneOffset offset;
+};
+
+
+/*
+ * Scans all of [begin, end) as an ISO 8601 time or date, with SIMD where
+ * available.  Returns `ErrorCode::PARSE` if the text doesn't have the layout,
+ * or another error if the fields are out of range.
+ */
+extern ErrorCode scan_iso_time(char const* begin, char const* end, IsoTime& time);
+extern ErrorCode scan_iso_date(char const* begin, char const* end, Datenum& datenum);
+
+/*
+ * Scans the 16 chars "YYYY-MM-DDTHH:MM" at `p`, without range checks, as
+ * `scan_iso_time()` does.  These are its implementations, for testing.
+ */
+extern bool scan_iso_head_scalar(
+  char const* p, unsigned& year, unsigned& month, unsigned& day,
+  unsigned& hour, unsigned& minute);
+#ifdef __SSE2__
+extern bool scan_iso_head_sse2(
+  char const* p, unsigned& year, unsigned& month, unsigned& day,
+  unsigned& hour, unsigned& minute);
+#endif
+
+
+/*
+ * Parses an ISO 8601 time with `scan_iso_time()`.  On failure, returns
+ * `INVALID` and sets `error`.
+ */
+template<class TIME=Time>
+inline TIME
+parse_iso_time(
+  char const* const begin,
+  char const* const end,
+  ErrorCode& error)
+{
+  IsoTime iso;
+  error = scan_iso_time(begin, end, iso);
+  if (error != ErrorCode::NONE)
+    return TIME::INVALID;
+
+  // Compute the offset directly, wide enough that it can't overflow.
+  int128_t const secs
+    = ((int128_t) iso.datenum - TIME::BASE) * SECS_PER_DAY
+      + iso.ssm - iso.offset;
+  int128_t const offset
+    = secs * TIME::DENOMINATOR
+      + round_div<int128_t>(
+          (int128_t) iso.nsec * TIME::DENOMINATOR, 1000000000);
+  if (in_range<int128_t>(TIME::MIN.get_offset(), offset, TIME::MAX.get_offset()))
+    return TIME::from_offset((typename TIME::Offset) offset);
+  else {
+    error = ErrorCode::INVALID_TIME;
+    return TIME::INVALID;
+  }
+}
+
+
+template<class TIME=Time>
+inline TIME
+parse_iso_time(
+  std::string const& str)
+{
+  ErrorCode error;
+  auto const time
+    = parse_iso_time<TIME>(str.data(), str.data() + str.size(), error);
+  if (error == ErrorCode::PARSE)
+    throw TimeParseError(str);
+  else if (error != ErrorCode::NONE)
+    throw_error(error);
+  return time;
+}
+
+
+/*
+ * Parses up to `max` newline-separated ISO 8601 times in [begin, end) into
+ * `times`.  A carriage return before a newline is ignored.  Lines that don't
+ * parse produce `INVALID`.  Returns the number of lines.
+ */
+template<class TIME>
+inline size_t
+parse_iso_times(
+  char const* begin,
+  char const* const end,
+  TIME* const times,
+  size_t const max)
+{
+  size_t i = 0;
+  while (i < max && begin < end) {
+    auto const next = (char const*) memchr(begin, '\n', end - begin);
+    auto line_end = next == nullptr ? end : next;
+    if (line_end > begin && line_end[-1] == '\r')
+      --line_end;
+    ErrorCode error;
+    times[i++] = parse_iso_time<TIME>(begin, line_end, error);
+    begin = next == nullptr ? end : next + 1;
+  }
+  return i;
+}
+
+
+/*
+ * Parses an ISO 8601 "YYYY-MM-DD" date with `scan_iso_date()`.  On failure,
+ * returns `INVALID` and sets `error`.
+ */
+template<class DATE=Date>
+inline DATE
+parse_iso_date(
+  char const* const begin,
+  char const* const end,
+  ErrorCode& error)
+{
+  Datenum datenum;
+  error = scan_iso_date(begin, end, datenum);
+  return
+    error == ErrorCode::NONE ? DATE::from_datenum(datenum, error)
+    : DATE::INVALID;
+}
+
+
+template<class DATE=Date>
+inline DATE
+parse_iso_date(
+  std::string const& str)
+{
+  ErrorCode error;
+  auto const date
+    = parse_iso_date<DATE>(str.data(), str.data() + str.size(), error);
+  if (error == ErrorCode::PARSE)
+    throw TimeParseError(str);
+  else if (error != ErrorCode::NONE)
+    throw_error(error);
+  return date;
+}
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <time.h>
@@ -237,6 +238,100 @@ public:
       : on_error<InvalidTimeError>());
   }
 
+  /*
+   * Converts `count` local times, given as dates and daytimes in `tz`.  Stores
+   * each time in `times`, or INVALID if it doesn't exist or is invalid, and 
+   * how it was converted in `statuses`.  Ambiguous times are resolved by 
+   * `first`.  Doesn't throw for invalid or nonexistent times.
+   */
+  static void
+  from_local(
+    Datenum const* const datenums,
+    Daytick const* const dayticks,
+    size_t const count,
+    TimeZone const& tz,
+    bool const first,
+    TimeTemplate* const times,
+    LocalTimeStatus* const statuses)
+  {
+    // Convert in chunks, looking up the time zone offsets for each together.
+    size_t constexpr CHUNK = 256;
+    TimeOffset locals[CHUNK];
+    TimeZoneOffset tz_offsets[CHUNK];
+
+    for (size_t start = 0; start < count; start += CHUNK) {
+      size_t const num = std::min(CHUNK, count - start);
+      Datenum const* const d = datenums + start;
+      Daytick const* const y = dayticks + start;
+
+      for (size_t i = 0; i < num; ++i)
+        locals[i] = 
+          datenum_is_valid(d[i]) && daytick_is_valid(y[i])
+          ?   ((TimeOffset) d[i] - DATENUM_UNIX_EPOCH) * SECS_PER_DAY 
+            + (TimeOffset) (y[i] / DAYTICK_PER_SEC)
+          // Repeat the previous time, so as not to interrupt a run of times
+          // in the same transition interval.
+          : i > 0 ? locals[i - 1] : 0;
+      tz.get_offsets_local(locals, num, first, tz_offsets, statuses + start);
+
+      for (size_t i = 0; i < num; ++i) {
+        auto& status = statuses[start + i];
+        Offset offset;
+        if (! datenum_is_valid(d[i]) || ! daytick_is_valid(y[i]))
+          status = LocalTimeStatus::INVALID;
+        else if (
+             status != LocalTimeStatus::NONEXISTENT
+          && (! local_to_offset(d[i], y[i], tz_offsets[i], offset)
+              || ! in_range(MIN.get_offset(), offset, MAX.get_offset())))
+          status = LocalTimeStatus::INVALID;
+        times[start + i] = 
+          status == LocalTimeStatus::UNIQUE 
+          || status == LocalTimeStatus::AMBIGUOUS
+          ? TimeTemplate(offset)
+          : INVALID;
+      }
+    }
+  }
+
+  /*
+   * Like the constructor from a local date and daytime, but instead of
+   * throwing, returns INVALID and sets `error`.  On success, sets `error` to
+   * `ErrorCode::NONE`.
+   */
+  static TimeTemplate
+  from_local(
+    Datenum const datenum,
+    Daytick const daytick,
+    TimeZone const& tz,
+    bool const first,
+    ErrorCode& error)
+  {
+    return TimeTemplate(
+      datenum_daytick_to_offset(datenum, daytick, tz, first, error));
+  }
+
+  /*
+   * Like `from_local()`, but for a local time at a fixed UTC offset, for
+   * instance one given explicitly in a string.
+   */
+  static TimeTemplate
+  from_local(
+    Datenum const datenum,
+    Daytick const daytick,
+    TimeZoneOffset const tz_offset,
+    ErrorCode& error)
+  {
+    Offset offset;
+    error = 
+        ! datenum_is_valid(datenum) ? ErrorCode::INVALID_DATE
+      : ! daytick_is_valid(daytick) ? ErrorCode::INVALID_DAYTIME
+      : ! local_to_offset(datenum, daytick, tz_offset, offset)
+        || ! in_range(MIN.get_offset(), offset, MAX.get_offset()) 
+        ? ErrorCode::INVALID_TIME
+      : ErrorCode::NONE;
+    return error == ErrorCode::NONE ? TimeTemplate(offset) : INVALID;
+  }
+
   static TimeTemplate
   from_timetick(
     Timetick const timetick)
@@ -300,26 +395,29 @@ public:
 
     // Look up the time zone.
     parts.time_zone = tz.get_parts(*this);
-    Offset const offset = offset_ + parts.time_zone.offset * TRAITS::denominator;
+    get_local_parts(parts.time_zone.offset, parts.date, parts.daytime);
+    return parts;
+  }
 
-    // Establish the date and daytime parts, using division rounded toward -inf
-    // and a positive remainder.
-    Datenum const datenum   
-      = (int64_t) (offset / TRAITS::denominator) / SECS_PER_DAY 
-        + (offset < 0 ? -1 : 0)
-        + BASE;
-    Offset const day_offset 
-      = (int64_t) offset % (TRAITS::denominator * SECS_PER_DAY) 
-        + (offset < 0 ? TRAITS::denominator * SECS_PER_DAY : 0);
+  /*
+   * Like `get_parts()`, but refers to the time zone by ID.
+   */
+  TimeIdParts 
+  get_id_parts(
+    TimeZone const& tz) 
+    const
+  {
+    if (! is_valid()) 
+      return TimeIdParts::get_invalid();
 
-    parts.date            = datenum_to_parts(datenum);
-    parts.daytime.second  = (Second) (day_offset % (SECS_PER_MIN * TRAITS::denominator)) / TRAITS::denominator;
-    Offset const minutes  = day_offset / (SECS_PER_MIN * TRAITS::denominator);
-    parts.daytime.minute  = minutes % MINS_PER_HOUR;
-    parts.daytime.hour    = minutes / MINS_PER_HOUR;
+    TimeIdParts parts;
+    parts.time_zone = tz.get_id_parts(*this);
+    get_local_parts(parts.time_zone.offset, parts.date, parts.daytime);
     return parts;
   }
 
+  TimeIdParts get_id_parts(TimeZoneId tz_id) const { return get_id_parts(get_time_zone(tz_id)); }
+
   TimeParts get_parts(std::string const& tz_name) const { return get_parts(*get_time_zone(tz_name)); }
   TimeParts get_parts() const { return get_parts(*get_display_time_zone()); }
 
@@ -343,6 +441,37 @@ public:
 
 private:
 
+  /*
+   * Computes local date and daytime parts, given the time zone offset.
+   */
+  void
+  get_local_parts(
+    TimeZoneOffset const tz_offset,
+    DateParts& date,
+    HmsDaytime& daytime)
+    const
+  {
+    Offset const offset = offset_ + tz_offset * TRAITS::denominator;
+
+    // Establish the date and daytime parts, using division rounded toward -inf
+    // and a positive remainder.
+    Datenum const datenum   
+      = (int64_t) (offset / TRAITS::denominator) / SECS_PER_DAY 
+        + (offset < 0 ? -1 : 0)
+        + BASE;
+    Offset const day_offset 
+      = (int64_t) offset % (TRAITS::denominator * SECS_PER_DAY) 
+        + (offset < 0 ? TRAITS::denominator * SECS_PER_DAY : 0);
+
+    date            = datenum_to_parts(datenum);
+    daytime.second  = (Second) (day_offset % (SECS_PER_MIN * TRAITS::denominator)) / TRAITS::denominator;
+    daytime.fraction = make_fraction<Offset>(
+      day_offset % TRAITS::denominator, TRAITS::denominator);
+    Offset const minutes  = day_offset / (SECS_PER_MIN * TRAITS::denominator);
+    daytime.minute  = minutes % MINS_PER_HOUR;
+    daytime.hour    = minutes / MINS_PER_HOUR;
+  }
+
   template<class EXC>
   static Offset
   on_error()
@@ -353,6 +482,20 @@ private:
       throw EXC();
   }
 
+  /*
+   * Returns INVALID, or throws the exception for `error` if this time type
+   * doesn't use INVALID.
+   */
+  static Offset
+  on_error(
+    ErrorCode const error)
+  {
+    if (TRAITS::use_invalid)
+      return INVALID.get_offset();
+    else
+      throw_error(error);
+  }
+
   static Offset 
   datenum_daytick_to_offset(
     Datenum datenum,
@@ -360,20 +503,62 @@ private:
     TimeZone const& tz,
     bool first)
   {
-    if (! datenum_is_valid(datenum)) 
-      return on_error<InvalidDateError>();
-    if (! daytick_is_valid(daytick))
-      return on_error<InvalidDaytimeError>();
+    ErrorCode error;
+    Offset const offset 
+      = datenum_daytick_to_offset(datenum, daytick, tz, first, error);
+    return error == ErrorCode::NONE ? offset : on_error(error);
+  }
 
-    Offset tz_offset;
-    try {
-      tz_offset = tz.get_parts_local(datenum, daytick, first).offset;
+  /*
+   * Returns the offset for a local time, or INVALID and sets `error`.
+   */
+  static Offset 
+  datenum_daytick_to_offset(
+    Datenum const datenum,
+    Daytick const daytick,
+    TimeZone const& tz,
+    bool const first,
+    ErrorCode& error)
+  {
+    error = 
+        ! datenum_is_valid(datenum) ? ErrorCode::INVALID_DATE
+      : ! daytick_is_valid(daytick) ? ErrorCode::INVALID_DAYTIME
+      : ErrorCode::NONE;
+    if (error != ErrorCode::NONE)
+      return INVALID.get_offset();
+
+    TimeZoneParts parts;
+    auto const status = tz.get_parts_local(
+      ((TimeOffset) datenum - DATENUM_UNIX_EPOCH) * SECS_PER_DAY 
+        + (TimeOffset) (daytick / DAYTICK_PER_SEC),
+      parts, first);
+    if (status == LocalTimeStatus::NONEXISTENT) {
+      error = ErrorCode::NONEXISTENT_LOCAL_TIME;
+      return INVALID.get_offset();
     }
-    catch (NonexistentLocalTime) {
-      // FIXME: Don't catch and rethrow...
-      return on_error<NonexistentLocalTime>();
+
+    Offset offset;
+    if (
+         local_to_offset(datenum, daytick, parts.offset, offset)
+      && in_range(MIN.get_offset(), offset, MAX.get_offset()))
+      return offset;
+    else {
+      error = ErrorCode::INVALID_TIME;
+      return INVALID.get_offset();
     }
+  }
 
+  /*
+   * Computes the offset for a valid local date and daytime, given the time
+   * zone offset.  Returns false if the offset overflows.
+   */
+  static bool
+  local_to_offset(
+    Datenum const datenum,
+    Daytick const daytick,
+    TimeZoneOffset const tz_offset,
+    Offset& offset)
+  {
     // Below, we compute this expression with overflow checking:
     //
     //     DENOMINATOR * SECS_PER_DAY * (datenum - BASE)
@@ -383,12 +568,9 @@ private:
     Offset const off = 
       (Offset) rescale_int<Daytick, DAYTICK_PER_SEC, DENOMINATOR>(daytick)
       - DENOMINATOR * tz_offset;
-    Offset r;
-    if (   mul_overflow(DENOMINATOR * SECS_PER_DAY, (Offset) datenum - BASE, r)
-        || add_overflow(r, off, r))
-      return on_error<InvalidTimeError>();
-    else
-      return r;
+    return ! (
+         mul_overflow(DENOMINATOR * SECS_PER_DAY, (Offset) datenum - BASE, offset)
+      || add_overflow(offset, off, offset));
   }
 
   static Offset 
@@ -627,6 +809,41 @@ from_local(
 }
 
 
+/*
+ * Like `from_local()`, but instead of throwing, returns INVALID and sets 
+ * `error`.
+ */
+template<typename TIME>
+inline TIME
+from_local(
+  Datenum const datenum,
+  Daytick const daytick,
+  TimeZone const& time_zone,
+  bool const first,
+  ErrorCode& error)
+{
+  return TIME::from_local(datenum, daytick, time_zone, first, error);
+}
+
+
+/*
+ * Converts `count` local times; see `TimeTemplate::from_local()`.
+ */
+template<typename TIME>
+inline void
+from_local(
+  Datenum const* const datenums,
+  Daytick const* const dayticks,
+  size_t const count,
+  TimeZone const& time_zone,
+  bool const first,
+  TIME* const times,
+  LocalTimeStatus* const statuses)
+{
+  TIME::from_local(datenums, dayticks, count, time_zone, first, times, statuses);
+}
+
+
 template<typename TIME>
 inline TIME
 now()
@@ -7,6 +7,7 @@
 #include "aslib/string.hh"
 #include "cron/types.hh"
 #include "cron/tzfile.hh"
+#include "cron/tzrule.hh"
 
 namespace cron {
 
@@ -14,20 +15,88 @@ using namespace aslib;
 
 //------------------------------------------------------------------------------
 
+class TzDatabase;
+
 class TimeZone
 {
 public:
 
-  TimeZone();
+  /*
+   * Caches the transition interval of the most recent lookup.
+   *
+   * Consecutive lookups usually fall in the same interval as the previous one,
+   * in which case the cursor answers without searching.  A cursor may be used
+   * with any time zone, but not from more than one thread at a time.
+   */
+  class Cursor
+  {
+  public:
+
+    uint64_t get_hits()   const { return hits_; }
+    uint64_t get_misses() const { return misses_; }
+
+  private:
+
+    friend class TimeZone;
+
+    struct Interval
+    {
+      bool contains(TimeOffset time) const { return start <= time && time < end; }
+
+      // Empty by default.
+      TimeOffset start = 0;
+      TimeOffset end = 0;
+      TimeZoneParts parts = {};
+      uint8_t type = 0;
+    };
+
+    // Serial number of the time zone for which the intervals are cached.
+    uint64_t serial_ = 0;
+    // UTC times in the cached interval.
+    Interval utc_;
+    // Local times in the cached interval that are not also local times in an
+    // adjacent interval.
+    Interval local_;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+  };
+
+  /*
+   * Returns the cursor that this thread uses for lookups without one.
+   */
+  static Cursor const& get_thread_cursor();
+
+  /*
+   * Constructs UTC, with registry ID `id`.
+   */
+  TimeZone() : TimeZone(TIME_ZONE_ID_INVALID) {}
+  explicit TimeZone(TimeZoneId id);
   TimeZone(TimeZone const&) = default;
   TimeZone(TimeZone&&) = default;
-  TimeZone(TzFile const& tz_file, std::string const& name);
+  TimeZone(
+    TzFile const& tz_file, std::string const& name, 
+    TimeZoneId id=TIME_ZONE_ID_INVALID);
   TimeZone& operator=(TimeZone const&) = default;
   TimeZone& operator=(TimeZone&&) = default;
 
   std::string get_name() const { return name_; }
 
+  /*
+   * Returns the ID of this time zone in the registry, or TIME_ZONE_ID_INVALID
+   * if it was not loaded via the registry.
+   */
+  TimeZoneId get_id() const { return id_; }
+
+  /*
+   * Returns the parts for one of this time zone's types, as referenced by
+   * `TimeZoneIdParts::type`.
+   */
+  TimeZoneParts const& get_type_parts(uint8_t type) const { return types_.at(type); }
+
   TimeZoneParts get_parts(TimeOffset time) const;
+  TimeZoneParts get_parts(TimeOffset time, Cursor& cursor) const;
 
   template<class TIME> 
   TimeZoneParts 
@@ -38,7 +107,56 @@ public:
     return get_parts(time.get_time_offset());
   }
 
+  template<class TIME> 
+  TimeZoneParts 
+  get_parts(
+    TIME time,
+    Cursor& cursor) 
+    const
+  {
+    return get_parts(time.get_time_offset(), cursor);
+  }
+
+  /*
+   * Like `get_parts()`, but refers to this time zone and its type by ID,
+   * rather than copying the abbreviation.  Only time zones from the registry,
+   * including `UTC`, have IDs; for others, the ID is TIME_ZONE_ID_INVALID and
+   * the parts can't be resolved back to the time zone.
+   */
+  TimeZoneIdParts get_id_parts(TimeOffset time) const;
+  TimeZoneIdParts get_id_parts(TimeOffset time, Cursor& cursor) const;
+
+  template<class TIME> 
+  TimeZoneIdParts 
+  get_id_parts(
+    TIME time) 
+    const
+  {
+    return get_id_parts(time.get_time_offset());
+  }
+
   TimeZoneParts get_parts_local(TimeOffset, bool first=true) const;
+  TimeZoneParts get_parts_local(TimeOffset, Cursor&, bool first=true) const;
+
+  /*
+   * Like `get_parts_local()`, but returns how the local time maps to UTC, 
+   * rather than throwing if it doesn't exist.  In that case, `parts` is not
+   * set.
+   */
+  LocalTimeStatus get_parts_local(
+    TimeOffset, TimeZoneParts& parts, bool first=true) const;
+
+  /*
+   * Looks up the offsets for `count` local times.  Stores in `offsets` each
+   * time's offset, or TIME_ZONE_OFFSET_INVALID if it doesn't exist, and in
+   * `statuses` how it maps to UTC.  Ambiguous times are resolved by `first`.
+   *
+   * Runs of local times in the same transition interval are resolved without
+   * searching, so sorted times take a single pass over the transitions.
+   */
+  void get_offsets_local(
+    TimeOffset const* times, size_t count, bool first,
+    TimeZoneOffset* offsets, LocalTimeStatus* statuses) const;
 
   // FIXME: Take a LocalDatenumDaytick instead?
   TimeZoneParts get_parts_local(
@@ -57,14 +175,164 @@ private:
 
   struct Entry
   {
-    Entry(TimeOffset transition, TzFile::Type const& type);
+    Entry() = default;
+    Entry(TimeOffset transition, TimeZoneParts const& parts, uint8_t type);
 
     TimeOffset transition;
     TimeZoneParts parts;
+    // Index into `types_`.
+    uint8_t type;
   };
 
+  using EntryIter = Entry const*;
+
+  /*
+   * Read-only view of an array in `storage_`.
+   */
+  template<class T>
+  class Array
+  {
+  public:
+
+    Array() : data_(nullptr), size_(0) {}
+    Array(T const* data, size_t size) : data_(data), size_(size) {}
+    Array(std::vector<T> const& vec) : data_(vec.data()), size_(vec.size()) {}
+
+    size_t size() const { return size_; }
+    T const* cbegin() const { return data_; }
+    T const* cend() const { return data_ + size_; }
+    T const& operator[](size_t i) const { return data_[i]; }
+
+    T const& 
+    at(
+      size_t i) 
+      const
+    {
+      if (i < size_)
+        return data_[i];
+      else
+        throw IndexError(i, size_);
+    }
+
+  private:
+
+    T const* data_;
+    size_t size_;
+
+  };
+
+  /*
+   * Arrays owned by a time zone built from a zoneinfo file.
+   */
+  struct Storage
+  {
+    std::vector<TimeZoneParts> types;
+    std::vector<Entry> entries;
+    std::vector<uint32_t> index;
+  };
+
+  friend class TzDatabase;
+
+  /*
+   * Constructs a time zone whose arrays are in `storage`, which it shares.
+   */
+  TimeZone(
+    std::string const& name, TimeZoneId id,
+    std::shared_ptr<void const> storage,
+    Array<TimeZoneParts> types, Array<Entry> entries, 
+    TimeOffset index_start, int index_shift, Array<uint32_t> index,
+    TzRule const& rule);
+
+  /*
+   * Takes ownership of `storage`, and builds its index.
+   */
+  void set_storage(std::shared_ptr<Storage> storage);
+
+  /*
+   * Applies a POSIX TZ rule after the last transition.  If the rule has DST,
+   * its types must be in `types_`.
+   */
+  void set_rule(TzRule const& rule);
+
+  /*
+   * Generates, from the rule, transitions that follow the last entry.
+   */
+  class Rule;
+
+  // Size of a window of entries generated from the rule.
+  static size_t constexpr WINDOW_SIZE = 11;
+
+  /*
+   * If `time` falls near or after the last transition and the rule has DST,
+   * fills `window` with the entries around `time`, in the same order as
+   * `entries_`, and returns its end.  Otherwise, returns null.
+   */
+  EntryIter get_window(TimeOffset time, Entry* window) const;
+
+  /*
+   * Returns the entry in effect at `time`, in the entries `[begin, end)`.
+   */
+  static EntryIter find_entry(EntryIter begin, EntryIter end, TimeOffset time);
+
+  /*
+   * Returns the entry in effect at `time`.
+   */
+  EntryIter find_entry(TimeOffset time) const;
+
+  /*
+   * Returns the cursor's UTC interval, updated to contain `time`.
+   */
+  Cursor::Interval const& lookup(TimeOffset time, Cursor& cursor) const;
+
+  /*
+   * Looks up local time parts without the cursor, and caches the interval
+   * if the local time is unambiguous.
+   */
+  TimeZoneParts find_parts_local(TimeOffset, Cursor&, bool first) const;
+
+  /*
+   * Like `find_parts_local()`, but returns the status rather than throwing if
+   * the local time doesn't exist, in which case `parts` is not set.
+   */
+  LocalTimeStatus resolve_local(
+    TimeOffset, Cursor&, bool first, TimeZoneParts& parts) const;
+  static LocalTimeStatus resolve_local(
+    EntryIter begin, EntryIter end, TimeOffset, Cursor&, bool first,
+    TimeZoneParts& parts);
+
+  /*
+   * Caches in the cursor the local times that map unambiguously to an entry,
+   * among the entries `[begin, end)`.
+   */
+  static void cache_local(EntryIter begin, EntryIter end, EntryIter, Cursor&);
+
+  // Unique serial number, to validate cursors.
+  uint64_t serial_;
+
+  TimeZoneId id_;
+
   std::string name_;
-  std::vector<Entry> entries_;
+
+  // Keeps the arrays below alive.  This is either a Storage or a mapped
+  // database image, and is immutable, so copies of the time zone share it.
+  std::shared_ptr<void const> storage_;
+
+  // Parts for each time type, as indexed in the zoneinfo file.
+  Array<TimeZoneParts> types_;
+
+  // Entries in descending order of transition time, ending with a sentry.
+  Array<Entry> entries_;
+
+  // Direct-mapped index of entries.  Bucket `i` covers times from 
+  // `index_start_ + (i << index_shift_)`, and holds the position in `entries_`
+  // of the entry in effect at the start of the bucket.  Times before 
+  // `index_start_` are found by binary search.
+  TimeOffset index_start_;
+  int index_shift_;
+  Array<uint32_t> index_;
+
+  // Transitions after the last entry, or null if there are none.
+  std::shared_ptr<Rule const> rule_;
 
 };
 
@@ -74,7 +342,7 @@ private:
 using TimeZone_ptr = std::shared_ptr<TimeZone const>;
 
 /**
- * UTC time zone singleton.
+ * UTC time zone singleton.  It is in the registry, with a fixed ID.
  */
 extern TimeZone_ptr const UTC;
 
@@ -101,10 +369,29 @@ find_time_zone_file(
 }
 
 /**
- * Returns a time zone named 'name' from the default zoneinfo directory.
+ * Returns the names of all time zones in the given zoneinfo directory, in
+ * directory order.  Files that aren't tz files, such as zone.tab, are skipped.
+ */
+extern std::vector<std::string> get_time_zone_names(fs::Filename const& zoneinfo_dir);
+
+/**
+ * Returns a time zone named 'name' from the default zoneinfo directory, or
+ * from the compiled database named by $ZONEINFO_DB if it contains it.
  */
 extern TimeZone_ptr     get_time_zone(std::string const& name);
 
+/**
+ * Returns the ID of the time zone named 'name' from the default zoneinfo
+ * directory, loading it if necessary.
+ */
+extern TimeZoneId       get_time_zone_id(std::string const& name);
+
+/**
+ * Returns the time zone with ID 'id'.  The time zone remains valid for the
+ * life of the program.  If the ID is not valid, raises ValueError.
+ */
+extern TimeZone const&  get_time_zone(TimeZoneId id);
+
 /**
  * Returns a time zone named 'name' from the given zoneinfo directory.
  */
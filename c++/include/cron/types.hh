@@ -22,6 +22,7 @@ uint32_t constexpr  HOURS_PER_DAY       = 24;
 
 uint32_t constexpr  SECS_PER_HOUR       = SECS_PER_MIN * MINS_PER_HOUR;
 uint32_t constexpr  SECS_PER_DAY        = SECS_PER_HOUR * HOURS_PER_DAY;
+uint32_t constexpr  MINS_PER_DAY        = MINS_PER_HOUR * HOURS_PER_DAY;
 
 // 17 bits are required to represent SECS_PER_DAY as an integer.  Any remaining
 // available bits can be used for fractional seconds.
@@ -38,6 +39,12 @@ Second constexpr    SECOND_MAX          = 0x1.dffffffffffffp+5;  // = std::nexta
 Second constexpr    SECOND_INVALID      = std::numeric_limits<Second>::quiet_NaN();
 inline constexpr bool second_is_valid(Second second) { return in_interval(SECOND_MIN, second, SECOND_BOUND); }
 
+/*
+ * The fractional part of a second, exactly, as a binary fraction of 2^64.
+ */
+using Fraction = uint64_t;
+Fraction constexpr  FRACTION_INVALID    = std::numeric_limits<Fraction>::max();
+
 using Minute = uint8_t;
 Minute constexpr    MINUTE_MIN          = 0;
 Minute constexpr    MINUTE_BOUND        = 60;
@@ -172,6 +179,12 @@ TimeZoneOffset constexpr TIME_ZONE_OFFSET_MAX       =  43200;
 TimeZoneOffset constexpr TIME_ZONE_OFFSET_INVALID   = std::numeric_limits<TimeZoneOffset>::max();
 inline constexpr bool time_zone_offset_is_valid(TimeZoneOffset offset) { return in_range(TIME_ZONE_OFFSET_MIN, offset, TIME_ZONE_OFFSET_MAX); }
 
+/**
+ * A small integer that identifies a time zone loaded by the registry.
+ */
+using TimeZoneId = uint16_t;
+TimeZoneId constexpr TIME_ZONE_ID_INVALID       = std::numeric_limits<TimeZoneId>::max();
+
 // FIXME: Rename this.
 /**
  * A time expressed in (positive or negative) seconds since the UNIX epoch,
@@ -181,6 +194,21 @@ using TimeOffset = int64_t;
 TimeOffset constexpr TIME_OFFSET_MIN        = -62135596800;
 TimeOffset constexpr TIME_OFFSET_INVALID    = std::numeric_limits<TimeOffset>::max();
 
+/**
+ * How a local time maps to UTC.
+ */
+enum class LocalTimeStatus : uint8_t
+{
+  // The local time occurs once.
+  UNIQUE = 0,
+  // The local time occurs twice, as the clock was set back.
+  AMBIGUOUS,
+  // The local time doesn't occur, as the clock was set forward.
+  NONEXISTENT,
+  // The local date or daytime is invalid, or the time is out of range.
+  INVALID,
+};
+
 /**
  * A time expressed in units of 1/(1 << 80) seconds since 0001-01-01T00:00:00Z.
  * Each timetick unit is slightly less than 1 yoctosecond.
@@ -261,6 +289,8 @@ struct HmsDaytime
   Hour      hour;
   Minute    minute;
   Second    second;
+  // The fractional part of `second`, exactly, if known.
+  Fraction  fraction = FRACTION_INVALID;
 
   static HmsDaytime get_invalid()
     { return {HOUR_INVALID, MINUTE_INVALID, SECOND_INVALID}; }
@@ -268,6 +298,40 @@ struct HmsDaytime
 };
 
 
+/*
+ * Returns `num / den`, for `num < den`, as a `Fraction`.  Exact if `den` is
+ * a power of two, as all time and daytime denominators are.
+ */
+template<class T>
+inline Fraction
+make_fraction(
+  T const num,
+  T const den)
+{
+  return
+      den == 1 ? 0
+    : (den & (den - 1)) == 0 ? (Fraction) num << (64 - __builtin_ctzll(den))
+    : (Fraction) (((uint128_t) num << 64) / den);
+}
+
+
+/*
+ * Returns the first `digits` decimal digits of `fraction`, as an integer.  If
+ * `round`, rounds half up, which may carry to `10^digits`; otherwise,
+ * truncates.
+ */
+inline uint64_t
+get_fraction_digits(
+  Fraction const fraction,
+  unsigned const digits,
+  bool const round=false)
+{
+  return (uint64_t) (
+    ((uint128_t) fraction * pow10(digits) + (round ? (uint128_t) 1 << 63 : 0))
+    >> 64);
+}
+
+
 struct TimeZoneParts
 {
   TimeZoneOffset offset;
@@ -280,6 +344,24 @@ struct TimeZoneParts
 };
 
 
+/*
+ * Time zone parts that refer to a registered time zone by ID, rather than
+ * carrying a copy of the abbreviation.
+ */
+struct TimeZoneIdParts
+{
+  TimeZoneOffset offset;
+  TimeZoneId id;
+  // The time zone's type; see TimeZone::get_type_parts().
+  uint8_t type;
+  bool is_dst;
+
+  static TimeZoneIdParts get_invalid()
+    { return TimeZoneIdParts{TIME_ZONE_OFFSET_INVALID, TIME_ZONE_ID_INVALID, 0, false}; }
+
+};
+
+
 struct TimeParts
 {
   DateParts date;
@@ -292,6 +374,21 @@ struct TimeParts
 };
 
 
+/*
+ * Like TimeParts, but with time zone parts by ID.
+ */
+struct TimeIdParts
+{
+  DateParts date;
+  HmsDaytime daytime;
+  TimeZoneIdParts time_zone;
+
+  static TimeIdParts get_invalid()
+    { return {DateParts::get_invalid(), HmsDaytime::get_invalid(), TimeZoneIdParts::get_invalid()}; }
+
+};
+
+
 //------------------------------------------------------------------------------
 // Exceptions
 //------------------------------------------------------------------------------
@@ -395,6 +492,52 @@ public:
 };
 
 
+class TimeParseError
+  : public FormatError
+{
+public:
+
+  TimeParseError(std::string const& text) : FormatError(std::string("can't parse: ") + text) {}
+  virtual ~TimeParseError() throw () {}
+
+};
+
+
+/*
+ * Error codes, reported by functions that don't throw.  Each corresponds to
+ * one of the exceptions above.
+ */
+enum class ErrorCode : uint8_t
+{
+  NONE = 0,
+  INVALID_DATE,
+  DATE_RANGE,
+  INVALID_DAYTIME,
+  INVALID_TIME,
+  NONEXISTENT_LOCAL_TIME,
+  PARSE,
+};
+
+
+/*
+ * Throws the exception corresponding to `error`, which must not be NONE.
+ */
+[[noreturn]] inline void
+throw_error(
+  ErrorCode const error)
+{
+  switch (error) {
+  case ErrorCode::INVALID_DATE:             throw InvalidDateError();
+  case ErrorCode::DATE_RANGE:               throw DateRangeError();
+  case ErrorCode::INVALID_DAYTIME:          throw InvalidDaytimeError();
+  case ErrorCode::NONEXISTENT_LOCAL_TIME:   throw NonexistentLocalTime();
+  case ErrorCode::PARSE:                    throw TimeParseError("");
+  case ErrorCode::INVALID_TIME:
+  default:                                  throw InvalidTimeError();
+  }
+}
+
+
 //------------------------------------------------------------------------------
 
 }  // namespace cron
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aslib/file.hh"
+#include "aslib/filename.hh"
+#include "cron/time_zone.hh"
+#include "cron/types.hh"
+
+namespace cron {
+
+using namespace aslib;
+
+//------------------------------------------------------------------------------
+
+/*
+ * A compiled database of time zones, in a single file.
+ *
+ * The image stores each time zone's types, transitions, and index exactly as
+ * `TimeZone` lays them out in memory, so a time zone loaded from a mapped
+ * database refers directly into the mapping, without parsing or copying.  An
+ * image is specific to the byte order and layout of the machine that compiled
+ * it; opening an incompatible one raises FormatError.
+ */
+class TzDatabase
+{
+public:
+
+  static uint32_t constexpr VERSION = 1;
+
+  /*
+   * Compiles the time zones named `names` from `zoneinfo_dir` into a database
+   * image.  If `errors` is given, a time zone that fails to load is left out,
+   * and a message naming it is appended; otherwise, the error is raised.
+   */
+  static std::string compile(
+    fs::Filename const& zoneinfo_dir, std::vector<std::string> const& names,
+    std::vector<std::string>* errors=nullptr);
+
+  /*
+   * Maps the database image in `filename`.
+   */
+  TzDatabase(fs::Filename const& filename);
+
+  std::vector<std::string> get_names() const;
+  bool contains(std::string const& name) const;
+
+  /*
+   * Returns the time zone named `name`, which shares the mapping.  If there is
+   * no such time zone, raises ValueError.
+   */
+  TimeZone get_time_zone(
+    std::string const& name, TimeZoneId id=TIME_ZONE_ID_INVALID) const;
+
+private:
+
+  struct Header;
+  struct ZoneRecord;
+
+  ZoneRecord const* find(std::string const& name) const;
+  char const* get_string(uint64_t offset) const;
+
+  std::shared_ptr<fs::MappedFile const> file_;
+  Header const* header_;
+  ZoneRecord const* zones_;
+
+};
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
+
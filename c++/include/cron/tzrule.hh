@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "cron/types.hh"
+
+namespace cron {
+
+//------------------------------------------------------------------------------
+
+/*
+ * A POSIX TZ rule, as in the footer of a version 2+ tz file.
+ *
+ * The rule gives the standard time type and optionally a DST type, with the
+ * dates and times on which DST starts and ends each year.  For example,
+ * "EST5EDT,M3.2.0,M11.1.0".
+ */
+class TzRule
+{
+public:
+
+  struct Type
+  {
+    // Offset east of UTC; note that the TZ string gives it west of UTC.
+    TimeZoneOffset offset;
+    std::string abbreviation;
+  };
+
+  /*
+   * A rule for the date and local time of a DST transition in each year.
+   */
+  struct Date
+  {
+    enum Kind : uint8_t {
+      // "Jn": day 1-365, not counting Feb 29.
+      JULIAN,
+      // "n": day 0-365, counting Feb 29.
+      ORDINAL,
+      // "Mm.w.d": weekday `weekday` of week `week` of `month`; week 5 is last.
+      MONTH_WEEK_DAY,
+    };
+
+    Kind kind;
+    uint16_t day;
+    Month month;
+    uint8_t week;
+    Weekday weekday;
+    // Local time of the transition, in seconds; may be negative or exceed a
+    // day.
+    int32_t time;
+
+    /*
+     * Returns the local time of the transition in `year`, as seconds since
+     * the UNIX epoch.
+     */
+    TimeOffset get_local(Year year) const;
+  };
+
+  /*
+   * Parses a TZ string.  An empty string produces an empty rule.  Raises
+   * FormatError if the string is invalid.
+   */
+  TzRule(std::string const& str="");
+
+  bool is_empty() const { return empty_; }
+  bool has_dst() const { return has_dst_; }
+
+  Type const& get_std() const { return std_; }
+  Type const& get_dst() const { return dst_; }
+
+  /*
+   * Returns the UTC times at which DST starts and ends in `year`.  The rule
+   * must have DST.
+   */
+  void get_transitions(Year year, TimeOffset& start, TimeOffset& end) const;
+
+private:
+
+  bool empty_;
+  bool has_dst_;
+  Type std_;
+  Type dst_;
+  Date start_;
+  Date end_;
+
+};
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
+
@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "aslib/filename.hh"
+#include "cron/time_zone.hh"
+#include "cron/tzdb.hh"
+
+using namespace cron;
+
+using aslib::fs::Filename;
+using std::string;
+
+//------------------------------------------------------------------------------
+
+int
+main(
+  int const argc,
+  char const* const* const argv)
+{
+  if (argc != 3) {
+    std::cerr << "Usage: " << argv[0] << " ZONEINFO-DIR OUTPUT\n";
+    return EXIT_FAILURE;
+  }
+
+  Filename const zoneinfo_dir{argv[1]};
+  std::vector<string> names;
+  std::vector<string> errors;
+  string image;
+  try {
+    // Skip, with a warning, any time zone that doesn't load.
+    names = get_time_zone_names(zoneinfo_dir);
+    image = TzDatabase::compile(zoneinfo_dir, names, &errors);
+  }
+  catch (std::exception const& exc) {
+    std::cerr << "can't compile " << argv[1] << ": " << exc.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  for (auto const& error : errors)
+    std::cerr << "skipping " << error << "\n";
+
+  std::ofstream file(argv[2], std::ios::binary);
+  file.write(image.data(), image.size());
+  if (! file.flush()) {
+    std::cerr << "can't write " << argv[2] << "\n";
+    return EXIT_FAILURE;
+  }
+
+  std::cerr << "compiled " << names.size() - errors.size() << " time zones, "
+            << image.size() << " bytes\n";
+  return EXIT_SUCCESS;
+}
@@ -1,10 +1,15 @@
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include "aslib/string.hh"
 #include "cron/calendar.hh"
+#include "cron/parse.hh"
 
 namespace cron {
 
@@ -14,8 +19,6 @@ using namespace aslib;
 // Helper functions.
 //------------------------------------------------------------------------------
 
-// FIXME: We need a unified parsing library.
-
 namespace {
 
 inline std::string
@@ -34,16 +37,252 @@ get_line(
 }
 
 
+std::array<std::array<uint8_t, 8>, 256>
+make_select_in_byte()
+{
+  std::array<std::array<uint8_t, 8>, 256> table{};
+  for (unsigned byte = 0; byte < 256; ++byte) {
+    unsigned rank = 0;
+    for (unsigned bit = 0; bit < 8; ++bit)
+      if ((byte >> bit) & 1)
+        table[byte][rank++] = bit;
+  }
+  return table;
+}
+
+
+}  // anonymous namespace
+
+//------------------------------------------------------------------------------
+// Class Calendar
+//------------------------------------------------------------------------------
+
+void
+Calendar::contains(
+  Date const* const dates,
+  size_t const size,
+  bool* const contained)
+  const
+{
+  for (size_t i = 0; i < size; ++i)
+    contained[i] = contains_(dates[i]);
+}
+
+
+void
+Calendar::shift(
+  Date const* const dates,
+  size_t const size,
+  ssize_t const shift,
+  Date* const shifted)
+  const
+{
+  for (size_t i = 0; i < size; ++i)
+    shifted[i] = this->shift(dates[i], shift);
+}
+
+
+void
+Calendar::nearest(
+  Date const* const dates,
+  size_t const size,
+  bool const forward,
+  Date* const nearest)
+  const
+{
+  for (size_t i = 0; i < size; ++i)
+    nearest[i] = this->nearest(dates[i], forward);
+}
+
+
+void
+Calendar::count(
+  Date const* const dates0,
+  Date const* const dates1,
+  size_t const size,
+  ssize_t* const counts)
+  const
+{
+  for (size_t i = 0; i < size; ++i)
+    counts[i] = count(dates0[i], dates1[i]);
+}
+
+
+//------------------------------------------------------------------------------
+// Class CalendarIndex
+//------------------------------------------------------------------------------
+
+std::array<std::array<uint8_t, 8>, 256> const
+CalendarIndex::SELECT_IN_BYTE
+  = make_select_in_byte();
+
+
+void
+CalendarIndex::set(
+  Date const date,
+  bool const contained)
+{
+  assert(covers(date));
+  size_t const i = date - min_;
+  size_t const w = i / BITS;
+  uint64_t const bit = (uint64_t) 1 << (i % BITS);
+  if (((words_[w] & bit) != 0) == contained)
+    return;
+
+  // Only the ranks of later words change.
+  if (contained) {
+    words_[w] |= bit;
+    for (size_t v = w + 1; v < ranks_.size(); ++v)
+      ++ranks_[v];
+  }
+  else {
+    words_[w] &= ~bit;
+    for (size_t v = w + 1; v < ranks_.size(); ++v)
+      --ranks_[v];
+  }
+
+  // So do the samples for ranks from this date's on.  Each moves from where
+  // it was to the word that now holds its rank.
+  size_t const rank = rank_(i);
+  samples_.resize(
+    (ranks_.back() + BITS - 1) / BITS, samples_.empty() ? 0 : samples_.back());
+  for (size_t s = (rank + BITS - 1) / BITS; s < samples_.size(); ++s) {
+    size_t const k = s * BITS;
+    auto& sample = samples_[s];
+    while (ranks_[sample] > k)
+      --sample;
+    while (ranks_[sample + 1] <= k)
+      ++sample;
+  }
+}
+
+
+void
+CalendarIndex::build()
+{
+  ranks_.resize(words_.size() + 1);
+  samples_.clear();
+  uint32_t rank = 0;
+  for (size_t w = 0; w < words_.size(); ++w) {
+    ranks_[w] = rank;
+    auto const n = popcount(words_[w]);
+    // Record this word for each multiple of 64 it contains.
+    while (samples_.size() * BITS < rank + n)
+      samples_.push_back(w);
+    rank += n;
+  }
+  ranks_.back() = rank;
+}
+
+
+//------------------------------------------------------------------------------
+// Class CompositeCalendar
+//------------------------------------------------------------------------------
+
+CalendarIndex const&
+CompositeCalendar::materialize()
+  const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Another thread may have materialized it meanwhile.
+  auto index = index_.load(std::memory_order_relaxed);
+  if (index == nullptr) {
+    index = new CalendarIndex(
+      min_, max_, [this](Date const date) { return apply(date); });
+    index_.store(index, std::memory_order_release);
+  }
+  return *index;
+}
+
+
+namespace {
+
+/*
+ * Returns the composite of two calendars, reusing the one made earlier for the
+ * same operation on the same calendars, if it is still in use.
+ */
+Calendar_ptr
+get_composite_calendar(
+  CompositeCalendar::Op const op,
+  Calendar_ptr cal0,
+  Calendar_ptr cal1)
+{
+  using Key = std::tuple<CompositeCalendar::Op, Calendar const*, Calendar const*>;
+  // The cache doesn't keep composites alive.  A live composite keeps its
+  // calendars alive, so a key isn't reused while its entry is live.
+  static std::map<Key, std::weak_ptr<Calendar const>> cache;
+  static std::mutex mutex;
+
+  if (cal0 == nullptr || cal1 == nullptr)
+    throw ValueError("null calendar");
+  // Union and intersection commute.
+  if (op != CompositeCalendar::DIFFERENCE && cal1.get() < cal0.get())
+    std::swap(cal0, cal1);
+
+  Key const key{op, cal0.get(), cal1.get()};
+  std::lock_guard<std::mutex> lock(mutex);
+  auto const i = cache.find(key);
+  if (i != cache.end())
+    if (auto cal = i->second.lock())
+      return cal;
+
+  // Drop entries for composites that have since been freed.
+  for (auto j = cache.begin(); j != cache.end(); )
+    if (j->second.expired())
+      j = cache.erase(j);
+    else
+      ++j;
+
+  auto cal = std::make_shared<CompositeCalendar const>(
+    op, std::move(cal0), std::move(cal1));
+  cache[key] = cal;
+  return cal;
+}
+
+
 }  // anonymous namespace
 
 //------------------------------------------------------------------------------
 // Functions
 //------------------------------------------------------------------------------
 
+Calendar_ptr
+get_union_calendar(
+  Calendar_ptr cal0,
+  Calendar_ptr cal1)
+{
+  return get_composite_calendar(
+    CompositeCalendar::UNION, std::move(cal0), std::move(cal1));
+}
+
+
+Calendar_ptr
+get_intersection_calendar(
+  Calendar_ptr cal0,
+  Calendar_ptr cal1)
+{
+  return get_composite_calendar(
+    CompositeCalendar::INTERSECTION, std::move(cal0), std::move(cal1));
+}
+
+
+Calendar_ptr
+get_difference_calendar(
+  Calendar_ptr cal0,
+  Calendar_ptr cal1)
+{
+  return get_composite_calendar(
+    CompositeCalendar::DIFFERENCE, std::move(cal0), std::move(cal1));
+}
+
+
+
 HolidayCalendar
 parse_holiday_calendar(
   std::istream& in)
 {
+  static DateParser const parser(DateFormat::ISO_CALENDAR_EXTENDED);
+
   std::vector<Date> dates;
   Date min = Date::MISSING;
   Date max = Date::MISSING;
@@ -58,11 +297,11 @@ parse_holiday_calendar(
     StringPair parts = split1(line);
     // FIXME: Handle exceptions.
     if (parts.first == "MIN") 
-      min = Date::from_ymd(iso_parse(parts.second));
+      min = parser.parse(parts.second);
     else if (parts.first == "MAX")
-      max = Date::from_ymd(iso_parse(parts.second));
+      max = parser.parse(parts.second);
     else {
-      Date const date = Date::from_ymd(iso_parse(parts.first));
+      Date const date = parser.parse(parts.first);
       dates.push_back(date);
       // Keep track of the min and max dates we've seen.
       if (!(date_min <= date))
@@ -80,11 +319,7 @@ parse_holiday_calendar(
     max = dates.size() > 0 ? date_max : Date::MIN;
   assert(!max.is_missing());
 
-  // Now construct the calendar.
-  HolidayCalendar cal(min, max);
-  for (auto const date : dates)
-    cal.add(date);
-  return cal;
+  return HolidayCalendar(min, max, dates);
 }
 
 
@@ -16,6 +16,81 @@ using namespace aslib;
 
 //------------------------------------------------------------------------------
 
+// Branch-free date decomposition using the "Euclidean affine functions" of
+// Neri and Schneider, "Euclidean Affine Functions and their Application to
+// Calendar Algorithms" (2022).
+//
+// The computations are performed in a "computational calendar" whose years
+// start on March 1, so that the leap day, if any, falls at the end of the year.
+// In this calendar, datenum 0 (0001-01-01) is day 306 of year 0.
+
+namespace {
+
+/*
+ * Date decomposed in the March-based computational calendar.
+ */
+struct ComputationalDate
+{
+  // The year, starting on March 1.
+  uint32_t year;
+  // The zero-based day of the year, counting from March 1.
+  uint32_t day_of_year;
+  // True if the date is in January or February, and hence in the following
+  // Gregorian year.
+  bool jan_feb;
+};
+
+
+/*
+ * Days from 0000-03-01, the start of the computational calendar, to 0001-01-01.
+ */
+uint32_t constexpr
+COMPUTATIONAL_SHIFT
+  = 306;
+
+
+inline ComputationalDate
+datenum_to_computational(
+  Datenum const datenum)
+{
+  // Centuries.
+  uint32_t const n = 4 * (datenum + COMPUTATIONAL_SHIFT) + 3;
+  uint32_t const century = n / 146097;
+  uint32_t const day_of_century = n % 146097 / 4;
+
+  // Years in the century, and days in the year.
+  uint32_t const n1 = 4 * day_of_century + 3;
+  uint64_t const p2 = (uint64_t) 2939745 * n1;
+  uint32_t const year_of_century = (uint32_t) (p2 >> 32);
+  uint32_t const day_of_year = (uint32_t) p2 / 2939745 / 4;
+
+  return {
+    100 * century + year_of_century, 
+    day_of_year, 
+    day_of_year >= COMPUTATIONAL_SHIFT};
+}
+
+
+/*
+ * Returns the month and day for a day of the computational year.
+ */
+inline YmdDate
+computational_to_ymd(
+  Year const year,
+  uint32_t const day_of_year,
+  bool const jan_feb)
+{
+  // Month, counting March as 3 and January as 13, and day.
+  uint32_t const n2 = 2141 * day_of_year + 197913;
+  uint32_t const month = n2 >> 16;
+  uint32_t const day = (uint16_t) n2 / 2141;
+  return {year, (Month) (month - (jan_feb ? 13 : 1)), (Day) day};
+}
+
+
+}  // anonymous namespace
+
+
 OrdinalDate
 datenum_to_ordinal_date(
   Datenum const datenum)
@@ -23,104 +98,44 @@ datenum_to_ordinal_date(
   if (! datenum_is_valid(datenum)) 
     return OrdinalDate::get_invalid();
 
-  // Compute the 400-year leap cycle and remainder; count from year 1.
-  Year year = 1 + 400 * (datenum / 146097);
-  uint32_t days = datenum % 146097;
-
-  // Adjust for the 100-year leap cycle and remainder.
-  if (days == 146096) {
-    year += 300;
-    days = 36524;
-  }
-  else {
-    year += 100 * (days / 36524);
-    days %= 36524;
-  }
+  auto const date = datenum_to_computational(datenum);
+  Year const year = date.year + date.jan_feb;
+  // Jan 1 is day 306 of the previous computational year; March 1 follows
+  // January, February, and the leap day, if any.
+  Ordinal const ordinal = 
+      date.jan_feb 
+    ? date.day_of_year - COMPUTATIONAL_SHIFT
+    : date.day_of_year + 59 + is_leap_year(year);
+  return OrdinalDate{year, ordinal};
+}
 
-  // Adjust for the 4-year leap cycle and remainder.
-  year += 4 * (days / 1461);
-  days %= 1461;
 
-  // Compute the one-year cycle and remainder.
-  // FIXME: Probably wrong.  Validate carefully.
-  if (days == 1460) {
-    year += 3;
-    days = 365;
-  }
-  else {
-    year += days / 365;
-    days %= 365;
-  }
+extern YmdDate
+datenum_to_ymd(
+  Datenum const datenum)
+{
+  if (! datenum_is_valid(datenum)) 
+    return YmdDate::get_invalid();
 
-  return OrdinalDate{year, (Ordinal) days};
+  auto const date = datenum_to_computational(datenum);
+  return computational_to_ymd(
+    date.year + date.jan_feb, date.day_of_year, date.jan_feb);
 }
 
 
 extern YmdDate
 datenum_to_ymd(
-  Datenum const datenum,
+  Datenum const /* datenum */,
   OrdinalDate const ordinal_date)
 {
-  auto const leap = is_leap_year(ordinal_date.year);
-
-  Ordinal days = ordinal_date.ordinal;
-  Month month;
-  Day day;
-
-  if (days < 31) {
-    month = 0;
-    day = days;
-  } 
-  else if (days < 59 || (leap && days == 59)) {
-    month = 1;
-    day = days - 31;
-  }
-  else {
-    if (leap)
-      --days;
-    if (days < 90) {
-      month = 2;
-      day = days - 59;
-    }
-    else if (days < 120) {
-      month = 3;
-      day = days - 90;
-    }
-    else if (days < 151) {
-      month = 4;
-      day = days - 120;
-    }
-    else if (days < 181) {
-      month = 5;
-      day = days - 151;
-    }
-    else if (days < 212) {
-      month = 6;
-      day = days - 181;
-    }
-    else if (days < 243) {
-      month = 7;
-      day = days - 212;
-    }
-    else if (days < 273) {
-      month = 8;
-      day = days - 243;
-    }
-    else if (days < 304) {
-      month = 9;
-      day = days - 273;
-    }
-    else if (days < 334) {
-      month = 10;
-      day = days - 304;
-    }
-    else {
-      month = 11;
-      day = days - 334;
-    }
-  }
-
-  return YmdDate{ordinal_date.year, month, day};
+  // Convert the ordinal to a day of the computational year.
+  Ordinal const jan_feb_days = 59 + is_leap_year(ordinal_date.year);
+  bool const jan_feb = ordinal_date.ordinal < jan_feb_days;
+  uint32_t const day_of_year = 
+      jan_feb 
+    ? ordinal_date.ordinal + COMPUTATIONAL_SHIFT 
+    : ordinal_date.ordinal - jan_feb_days;
+  return computational_to_ymd(ordinal_date.year, day_of_year, jan_feb);
 }
 
 
@@ -179,7 +194,7 @@ datenum_to_parts(
     return DateParts::get_invalid();
 
   auto const ord = datenum_to_ordinal_date(datenum);
-  auto const ymd = datenum_to_ymd(datenum, ord);
+  auto const ymd = datenum_to_ymd(datenum);
   auto const wdy = get_weekday(datenum);
   auto const wdt = datenum_to_week_date(datenum, ord, wdy);
 
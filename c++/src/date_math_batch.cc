@@ -0,0 +1,575 @@
+#include <cstddef>
+#include <cstdint>
+
+#include "cron/date_math.hh"
+#include "date_math_batch.hh"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# define CRON_DATE_MATH_SIMD 1
+# include <immintrin.h>
+#endif
+
+namespace cron {
+
+//------------------------------------------------------------------------------
+
+// Batch conversions between datenums and YMD date parts.
+//
+// The vector kernels use the same Euclidean affine functions as the scalar
+// datenum_to_ymd(), with the divisions replaced by multiplications by
+// reciprocals; each has been checked exhaustively over the range of datenums.
+// The YMD to datenum direction is Neri and Schneider's "rata die" algorithm.
+//
+// The kernels treat each YmdDate as a packed 32-bit word: the year in the low
+// 16 bits, then the month, then the day.  The SIMD kernels are compiled for
+// their instruction sets with target attributes and selected at runtime, so
+// the library itself may be built for a baseline x86-64 CPU.
+
+static_assert(sizeof(YmdDate) == 4, "YmdDate must pack into 32 bits");
+static_assert(
+  offsetof(YmdDate, month) == 2 && offsetof(YmdDate, day) == 3,
+  "unexpected YmdDate layout");
+
+namespace {
+
+/*
+ * The packed representation of `YmdDate::get_invalid()`.
+ */
+uint32_t constexpr
+YMD_INVALID_PACKED
+  =   (uint32_t) (uint16_t) YEAR_INVALID
+    | (uint32_t) MONTH_INVALID << 16
+    | (uint32_t) DAY_INVALID << 24;
+
+
+inline YmdDate
+checked_datenum_to_ymd(
+  Datenum const datenum)
+{
+  return
+      datenum_is_valid(datenum)
+    ? datenum_to_ymd(datenum)
+    : YmdDate::get_invalid();
+}
+
+
+inline Datenum
+checked_ymd_to_datenum(
+  YmdDate const ymd)
+{
+  return
+      ymd_is_valid(ymd.year, ymd.month, ymd.day)
+    ? ymd_to_datenum(ymd.year, ymd.month, ymd.day)
+    : DATENUM_INVALID;
+}
+
+
+void
+datenum_to_ymd_scalar(
+  Datenum const* const datenums,
+  size_t const count,
+  YmdDate* const ymds)
+{
+  for (size_t i = 0; i < count; ++i)
+    ymds[i] = checked_datenum_to_ymd(datenums[i]);
+}
+
+
+void
+ymd_to_datenum_scalar(
+  YmdDate const* const ymds,
+  size_t const count,
+  Datenum* const datenums)
+{
+  for (size_t i = 0; i < count; ++i)
+    datenums[i] = checked_ymd_to_datenum(ymds[i]);
+}
+
+
+#ifdef CRON_DATE_MATH_SIMD
+
+//------------------------------------------------------------------------------
+// AVX2
+//------------------------------------------------------------------------------
+
+#define CRON_AVX2 __attribute__((target("avx2")))
+#define CRON_AVX2_INLINE __attribute__((target("avx2"), always_inline)) inline
+
+/*
+ * Computes `(x * m) >> SHIFT` for each 32-bit lane, with a 64-bit product.
+ * Requires that the result fit in 32 bits.
+ */
+template<int SHIFT>
+CRON_AVX2_INLINE __m256i
+avx2_mul_shift(
+  __m256i const x,
+  uint32_t const m)
+{
+  __m256i const mv = _mm256_set1_epi32(m);
+  __m256i const even = _mm256_mul_epu32(x, mv);
+  __m256i const odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), mv);
+  return _mm256_or_si256(
+    _mm256_srli_epi64(even, SHIFT),
+    _mm256_slli_epi64(_mm256_srli_epi64(odd, SHIFT), 32));
+}
+
+
+CRON_AVX2_INLINE __m256i
+avx2_mullo(
+  __m256i const x,
+  uint32_t const m)
+{
+  return _mm256_mullo_epi32(x, _mm256_set1_epi32(m));
+}
+
+
+CRON_AVX2_INLINE __m256i
+avx2_datenum_to_ymd(
+  __m256i const datenum)
+{
+  __m256i const valid = _mm256_cmpeq_epi32(
+    _mm256_min_epu32(datenum, _mm256_set1_epi32(DATENUM_MAX)), datenum);
+
+  // Centuries; n / 146097.
+  __m256i const n = _mm256_add_epi32(
+    _mm256_slli_epi32(datenum, 2), _mm256_set1_epi32(4 * 306 + 3));
+  __m256i const century = avx2_mul_shift<41>(n, 15051803);
+  __m256i const day_of_century
+    = _mm256_srli_epi32(_mm256_sub_epi32(n, avx2_mullo(century, 146097)), 2);
+
+  // Years in the century, and days in the year; n1 / 1461.
+  __m256i const n1 = _mm256_or_si256(
+    _mm256_slli_epi32(day_of_century, 2), _mm256_set1_epi32(3));
+  __m256i const year_of_century = avx2_mul_shift<32>(n1, 2939745);
+  __m256i const day_of_year = _mm256_srli_epi32(
+    _mm256_sub_epi32(n1, avx2_mullo(year_of_century, 1461)), 2);
+
+  // Months, counting March as 3, and days; (n2 & 0xffff) / 2141.
+  __m256i const n2 = _mm256_add_epi32(
+    avx2_mullo(day_of_year, 2141), _mm256_set1_epi32(197913));
+  __m256i const month = _mm256_srli_epi32(n2, 16);
+  __m256i const day = _mm256_srli_epi32(
+    avx2_mullo(_mm256_and_si256(n2, _mm256_set1_epi32(0xffff)), 31345), 26);
+
+  // January and February belong to the next Gregorian year.  The comparison
+  // produces -1 for these.
+  __m256i const jan_feb
+    = _mm256_cmpgt_epi32(day_of_year, _mm256_set1_epi32(305));
+  __m256i const year = _mm256_sub_epi32(
+    _mm256_add_epi32(avx2_mullo(century, 100), year_of_century), jan_feb);
+  __m256i const month0 = _mm256_sub_epi32(
+    month,
+    _mm256_add_epi32(
+      _mm256_set1_epi32(1), _mm256_and_si256(jan_feb, _mm256_set1_epi32(12))));
+
+  __m256i const packed = _mm256_or_si256(
+    _mm256_and_si256(year, _mm256_set1_epi32(0xffff)),
+    _mm256_or_si256(
+      _mm256_slli_epi32(month0, 16), _mm256_slli_epi32(day, 24)));
+  return _mm256_blendv_epi8(
+    _mm256_set1_epi32(YMD_INVALID_PACKED), packed, valid);
+}
+
+
+CRON_AVX2_INLINE __m256i
+avx2_ymd_to_datenum(
+  __m256i const ymd)
+{
+  __m256i const year = _mm256_srai_epi32(_mm256_slli_epi32(ymd, 16), 16);
+  __m256i const month
+    = _mm256_and_si256(_mm256_srli_epi32(ymd, 16), _mm256_set1_epi32(0xff));
+  __m256i const day = _mm256_srli_epi32(ymd, 24);
+
+  // Leap years; if the year is a century, check the century instead.
+  __m256i const century = _mm256_srli_epi32(avx2_mullo(year, 5243), 19);
+  __m256i const is_century = _mm256_cmpeq_epi32(
+    _mm256_sub_epi32(year, avx2_mullo(century, 100)), _mm256_setzero_si256());
+  __m256i const leap = _mm256_cmpeq_epi32(
+    _mm256_and_si256(
+      _mm256_blendv_epi8(year, century, is_century), _mm256_set1_epi32(3)),
+    _mm256_setzero_si256());
+
+  // Days per month: 31 for even months through July and odd months after,
+  // except February.
+  __m256i const after_july = _mm256_cmpgt_epi32(month, _mm256_set1_epi32(6));
+  __m256i const days_per_month = _mm256_blendv_epi8(
+    _mm256_sub_epi32(
+      _mm256_set1_epi32(31),
+      _mm256_and_si256(
+        _mm256_sub_epi32(month, after_july), _mm256_set1_epi32(1))),
+    _mm256_sub_epi32(_mm256_set1_epi32(28), leap),
+    _mm256_cmpeq_epi32(month, _mm256_set1_epi32(1)));
+
+  __m256i const valid = _mm256_and_si256(
+    _mm256_and_si256(
+      _mm256_cmpgt_epi32(year, _mm256_setzero_si256()),
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(YEAR_BOUND), year)),
+    _mm256_and_si256(
+      _mm256_cmpgt_epi32(_mm256_set1_epi32(MONTH_BOUND), month),
+      _mm256_cmpgt_epi32(days_per_month, day)));
+
+  // Shift to the computational calendar, in which January and February are
+  // months 13 and 14 of the previous year.
+  __m256i const jan_feb = _mm256_cmpgt_epi32(_mm256_set1_epi32(2), month);
+  __m256i const cyear = _mm256_add_epi32(year, jan_feb);
+  __m256i const cmonth = _mm256_add_epi32(
+    _mm256_add_epi32(month, _mm256_set1_epi32(1)),
+    _mm256_and_si256(jan_feb, _mm256_set1_epi32(12)));
+
+  __m256i const ccentury = _mm256_srli_epi32(avx2_mullo(cyear, 5243), 19);
+  __m256i const year_days = _mm256_add_epi32(
+    _mm256_sub_epi32(
+      _mm256_srli_epi32(avx2_mullo(cyear, 1461), 2), ccentury),
+    _mm256_srli_epi32(ccentury, 2));
+  __m256i const month_days = _mm256_srli_epi32(
+    _mm256_sub_epi32(avx2_mullo(cmonth, 979), _mm256_set1_epi32(2919)), 5);
+  __m256i const datenum = _mm256_add_epi32(
+    _mm256_add_epi32(year_days, month_days),
+    _mm256_sub_epi32(day, _mm256_set1_epi32(306)));
+
+  return _mm256_blendv_epi8(
+    _mm256_set1_epi32(DATENUM_INVALID), datenum, valid);
+}
+
+
+CRON_AVX2 void
+datenum_to_ymd_avx2(
+  Datenum const* const datenums,
+  size_t const count,
+  YmdDate* const ymds)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+    _mm256_storeu_si256(
+      (__m256i*) (ymds + i),
+      avx2_datenum_to_ymd(
+        _mm256_loadu_si256((__m256i const*) (datenums + i))));
+  datenum_to_ymd_scalar(datenums + i, count - i, ymds + i);
+}
+
+
+CRON_AVX2 void
+ymd_to_datenum_avx2(
+  YmdDate const* const ymds,
+  size_t const count,
+  Datenum* const datenums)
+{
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8)
+    _mm256_storeu_si256(
+      (__m256i*) (datenums + i),
+      avx2_ymd_to_datenum(_mm256_loadu_si256((__m256i const*) (ymds + i))));
+  ymd_to_datenum_scalar(ymds + i, count - i, datenums + i);
+}
+
+
+#undef CRON_AVX2_INLINE
+#undef CRON_AVX2
+
+//------------------------------------------------------------------------------
+// AVX-512
+//------------------------------------------------------------------------------
+
+#define CRON_AVX512 __attribute__((target("avx512f")))
+#define CRON_AVX512_INLINE \
+  __attribute__((target("avx512f"), always_inline)) inline
+
+// GCC implements the unmasked AVX-512 shifts and multiplies as masked ones
+// with an undefined pass-through vector, which -Wmaybe-uninitialized flags
+// once they're inlined.  The zero-masked forms, with every lane selected,
+// compute the same thing without the undefined operand.
+
+__mmask16 constexpr ALL_EPI32 = 0xffff;
+__mmask8 constexpr ALL_EPI64 = 0xff;
+
+template<unsigned N>
+CRON_AVX512_INLINE __m512i
+avx512_slli_epi32(
+  __m512i const x)
+{
+  return _mm512_maskz_slli_epi32(ALL_EPI32, x, N);
+}
+
+
+template<unsigned N>
+CRON_AVX512_INLINE __m512i
+avx512_srli_epi32(
+  __m512i const x)
+{
+  return _mm512_maskz_srli_epi32(ALL_EPI32, x, N);
+}
+
+
+template<unsigned N>
+CRON_AVX512_INLINE __m512i
+avx512_srai_epi32(
+  __m512i const x)
+{
+  return _mm512_maskz_srai_epi32(ALL_EPI32, x, N);
+}
+
+
+template<unsigned N>
+CRON_AVX512_INLINE __m512i
+avx512_slli_epi64(
+  __m512i const x)
+{
+  return _mm512_maskz_slli_epi64(ALL_EPI64, x, N);
+}
+
+
+template<unsigned N>
+CRON_AVX512_INLINE __m512i
+avx512_srli_epi64(
+  __m512i const x)
+{
+  return _mm512_maskz_srli_epi64(ALL_EPI64, x, N);
+}
+
+
+CRON_AVX512_INLINE __m512i
+avx512_mul_epu32(
+  __m512i const x,
+  __m512i const y)
+{
+  return _mm512_maskz_mul_epu32(ALL_EPI64, x, y);
+}
+
+
+template<int SHIFT>
+CRON_AVX512_INLINE __m512i
+avx512_mul_shift(
+  __m512i const x,
+  uint32_t const m)
+{
+  __m512i const mv = _mm512_set1_epi32(m);
+  __m512i const even = avx512_mul_epu32(x, mv);
+  __m512i const odd = avx512_mul_epu32(avx512_srli_epi64<32>(x), mv);
+  return _mm512_or_si512(
+    avx512_srli_epi64<SHIFT>(even),
+    avx512_slli_epi64<32>(avx512_srli_epi64<SHIFT>(odd)));
+}
+
+
+CRON_AVX512_INLINE __m512i
+avx512_mullo(
+  __m512i const x,
+  uint32_t const m)
+{
+  return _mm512_mullo_epi32(x, _mm512_set1_epi32(m));
+}
+
+
+CRON_AVX512_INLINE __m512i
+avx512_datenum_to_ymd(
+  __m512i const datenum)
+{
+  __mmask16 const valid
+    = _mm512_cmple_epu32_mask(datenum, _mm512_set1_epi32(DATENUM_MAX));
+
+  __m512i const n = _mm512_add_epi32(
+    avx512_slli_epi32<2>(datenum), _mm512_set1_epi32(4 * 306 + 3));
+  __m512i const century = avx512_mul_shift<41>(n, 15051803);
+  __m512i const day_of_century
+    = avx512_srli_epi32<2>(_mm512_sub_epi32(n, avx512_mullo(century, 146097)));
+
+  __m512i const n1 = _mm512_or_si512(
+    avx512_slli_epi32<2>(day_of_century), _mm512_set1_epi32(3));
+  __m512i const year_of_century = avx512_mul_shift<32>(n1, 2939745);
+  __m512i const day_of_year = avx512_srli_epi32<2>(
+    _mm512_sub_epi32(n1, avx512_mullo(year_of_century, 1461)));
+
+  __m512i const n2 = _mm512_add_epi32(
+    avx512_mullo(day_of_year, 2141), _mm512_set1_epi32(197913));
+  __m512i const month = avx512_srli_epi32<16>(n2);
+  __m512i const day = avx512_srli_epi32<26>(
+    avx512_mullo(_mm512_and_si512(n2, _mm512_set1_epi32(0xffff)), 31345));
+
+  __mmask16 const jan_feb
+    = _mm512_cmpgt_epu32_mask(day_of_year, _mm512_set1_epi32(305));
+  __m512i const year0
+    = _mm512_add_epi32(avx512_mullo(century, 100), year_of_century);
+  __m512i const year
+    = _mm512_mask_add_epi32(year0, jan_feb, year0, _mm512_set1_epi32(1));
+  __m512i const month1 = _mm512_sub_epi32(month, _mm512_set1_epi32(1));
+  __m512i const month0
+    = _mm512_mask_sub_epi32(month1, jan_feb, month1, _mm512_set1_epi32(12));
+
+  __m512i const packed = _mm512_or_si512(
+    _mm512_and_si512(year, _mm512_set1_epi32(0xffff)),
+    _mm512_or_si512(
+      avx512_slli_epi32<16>(month0), avx512_slli_epi32<24>(day)));
+  return _mm512_mask_blend_epi32(
+    valid, _mm512_set1_epi32(YMD_INVALID_PACKED), packed);
+}
+
+
+CRON_AVX512_INLINE __m512i
+avx512_ymd_to_datenum(
+  __m512i const ymd)
+{
+  __m512i const year = avx512_srai_epi32<16>(avx512_slli_epi32<16>(ymd));
+  __m512i const month
+    = _mm512_and_si512(avx512_srli_epi32<16>(ymd), _mm512_set1_epi32(0xff));
+  __m512i const day = avx512_srli_epi32<24>(ymd);
+
+  __m512i const century = avx512_srli_epi32<19>(avx512_mullo(year, 5243));
+  __mmask16 const is_century = _mm512_cmpeq_epi32_mask(
+    year, avx512_mullo(century, 100));
+  __mmask16 const leap = _mm512_cmpeq_epi32_mask(
+    _mm512_and_si512(
+      _mm512_mask_blend_epi32(is_century, year, century),
+      _mm512_set1_epi32(3)),
+    _mm512_setzero_si512());
+
+  __mmask16 const after_july
+    = _mm512_cmpgt_epi32_mask(month, _mm512_set1_epi32(6));
+  __m512i const long_month = _mm512_mask_add_epi32(
+    month, after_july, month, _mm512_set1_epi32(1));
+  __m512i days_per_month = _mm512_sub_epi32(
+    _mm512_set1_epi32(31),
+    _mm512_and_si512(long_month, _mm512_set1_epi32(1)));
+  days_per_month = _mm512_mask_blend_epi32(
+    _mm512_cmpeq_epi32_mask(month, _mm512_set1_epi32(1)),
+    days_per_month,
+    _mm512_mask_blend_epi32(
+      leap, _mm512_set1_epi32(28), _mm512_set1_epi32(29)));
+
+  __mmask16 const valid =
+      _mm512_cmpgt_epi32_mask(year, _mm512_setzero_si512())
+    & _mm512_cmplt_epi32_mask(year, _mm512_set1_epi32(YEAR_BOUND))
+    & _mm512_cmplt_epi32_mask(month, _mm512_set1_epi32(MONTH_BOUND))
+    & _mm512_cmplt_epi32_mask(day, days_per_month);
+
+  __mmask16 const jan_feb
+    = _mm512_cmplt_epi32_mask(month, _mm512_set1_epi32(2));
+  __m512i const cyear
+    = _mm512_mask_sub_epi32(year, jan_feb, year, _mm512_set1_epi32(1));
+  __m512i const month1 = _mm512_add_epi32(month, _mm512_set1_epi32(1));
+  __m512i const cmonth
+    = _mm512_mask_add_epi32(month1, jan_feb, month1, _mm512_set1_epi32(12));
+
+  __m512i const ccentury = avx512_srli_epi32<19>(avx512_mullo(cyear, 5243));
+  __m512i const year_days = _mm512_add_epi32(
+    _mm512_sub_epi32(
+      avx512_srli_epi32<2>(avx512_mullo(cyear, 1461)), ccentury),
+    avx512_srli_epi32<2>(ccentury));
+  __m512i const month_days = avx512_srli_epi32<5>(
+    _mm512_sub_epi32(avx512_mullo(cmonth, 979), _mm512_set1_epi32(2919)));
+  __m512i const datenum = _mm512_add_epi32(
+    _mm512_add_epi32(year_days, month_days),
+    _mm512_sub_epi32(day, _mm512_set1_epi32(306)));
+
+  return _mm512_mask_blend_epi32(
+    valid, _mm512_set1_epi32(DATENUM_INVALID), datenum);
+}
+
+
+CRON_AVX512 void
+datenum_to_ymd_avx512(
+  Datenum const* const datenums,
+  size_t const count,
+  YmdDate* const ymds)
+{
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+    _mm512_storeu_si512(
+      ymds + i, avx512_datenum_to_ymd(_mm512_loadu_si512(datenums + i)));
+  datenum_to_ymd_scalar(datenums + i, count - i, ymds + i);
+}
+
+
+CRON_AVX512 void
+ymd_to_datenum_avx512(
+  YmdDate const* const ymds,
+  size_t const count,
+  Datenum* const datenums)
+{
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+    _mm512_storeu_si512(
+      datenums + i, avx512_ymd_to_datenum(_mm512_loadu_si512(ymds + i)));
+  ymd_to_datenum_scalar(ymds + i, count - i, datenums + i);
+}
+
+
+#undef CRON_AVX512_INLINE
+#undef CRON_AVX512
+
+#endif  // CRON_DATE_MATH_SIMD
+
+//------------------------------------------------------------------------------
+// Dispatch
+//------------------------------------------------------------------------------
+
+std::vector<DateMathKernel>
+make_kernels()
+{
+  std::vector<DateMathKernel> kernels{
+    {"scalar", true, datenum_to_ymd_scalar, ymd_to_datenum_scalar},
+  };
+#ifdef CRON_DATE_MATH_SIMD
+  __builtin_cpu_init();
+  kernels.push_back({
+    "avx2", (bool) __builtin_cpu_supports("avx2"),
+    datenum_to_ymd_avx2, ymd_to_datenum_avx2});
+  kernels.push_back({
+    "avx512", (bool) __builtin_cpu_supports("avx512f"),
+    datenum_to_ymd_avx512, ymd_to_datenum_avx512});
+#endif
+  return kernels;
+}
+
+
+/*
+ * Chooses the widest kernel the CPU supports.
+ */
+DateMathKernel const&
+select_kernel()
+{
+  auto const& kernels = get_date_math_kernels();
+  auto i = kernels.size() - 1;
+  while (! kernels[i].supported)
+    --i;
+  return kernels[i];
+}
+
+
+}  // anonymous namespace
+
+//------------------------------------------------------------------------------
+
+std::vector<DateMathKernel> const&
+get_date_math_kernels()
+{
+  static std::vector<DateMathKernel> const kernels = make_kernels();
+  return kernels;
+}
+
+
+extern void
+datenum_to_ymd(
+  Datenum const* const datenums,
+  size_t const count,
+  YmdDate* const ymds)
+{
+  static auto const kernel = select_kernel().datenum_to_ymd;
+  kernel(datenums, count, ymds);
+}
+
+
+extern void
+ymd_to_datenum(
+  YmdDate const* const ymds,
+  size_t const count,
+  Datenum* const datenums)
+{
+  static auto const kernel = select_kernel().ymd_to_datenum;
+  kernel(ymds, count, datenums);
+}
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
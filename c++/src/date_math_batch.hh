@@ -0,0 +1,39 @@
+/*
+ * Internals of the batch date conversions, exposed for testing.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "cron/types.hh"
+
+namespace cron {
+
+//------------------------------------------------------------------------------
+
+/*
+ * One instruction set's implementation of the batch conversions in
+ * date_math.hh.
+ */
+struct DateMathKernel
+{
+  char const* name;
+  // True if the CPU supports the instruction set.
+  bool supported;
+  void (*datenum_to_ymd)(Datenum const*, size_t, YmdDate*);
+  void (*ymd_to_datenum)(YmdDate const*, size_t, Datenum*);
+};
+
+/*
+ * Returns the implementations of the batch conversions, narrowest first,
+ * whether or not the CPU supports them.  The batch conversions use the last
+ * supported one.
+ */
+extern std::vector<DateMathKernel> const& get_date_math_kernels();
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
@@ -65,13 +65,22 @@ string
 load_text(
   Filename const& filename)
 {
-  size_t const size = (size_t) stat(filename).st_size;
-  char buffer[size];
+  // Read directly into the string.
   int const fd = xopen(filename, O_RDONLY);
-  size_t const num_read = xread(fd, buffer, size);
-  assert(num_read == size);
-  // FIXME: Do we need this copy?
-  return string(buffer, size);
+  struct stat info;
+  xfstat(fd, &info);
+  string text((size_t) info.st_size, '\0');
+  size_t num_read = 0;
+  while (num_read < text.size()) {
+    size_t const n = xread(fd, &text[num_read], text.size() - num_read);
+    if (n == 0)
+      // The file shrank.
+      break;
+    num_read += n;
+  }
+  xclose(fd);
+  text.resize(num_read);
+  return text;
 }
 
 
@@ -86,6 +95,48 @@ load_text_for_arg(
 }
 
 
+//------------------------------------------------------------------------------
+
+MappedFile::MappedFile(
+  Filename const& filename)
+  : data_(nullptr),
+    size_(0)
+{
+  int const fd = xopen(filename, O_RDONLY);
+  try {
+    struct stat info;
+    xfstat(fd, &info);
+    size_ = (size_t) info.st_size;
+    // Can't map an empty file.
+    if (size_ > 0)
+      data_ = (char const*) xmmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  catch (...) {
+    close(fd);
+    throw;
+  }
+  // The mapping remains valid after the file is closed.
+  xclose(fd);
+}
+
+
+MappedFile::MappedFile(
+  MappedFile&& file)
+  : data_(file.data_),
+    size_(file.size_)
+{
+  file.data_ = nullptr;
+  file.size_ = 0;
+}
+
+
+MappedFile::~MappedFile()
+{
+  if (data_ != nullptr)
+    munmap((void*) data_, size_);
+}
+
+
 //------------------------------------------------------------------------------
 
 }  // namespace fs
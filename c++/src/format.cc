@@ -20,44 +20,28 @@ using std::string;
 
 namespace {
 
-/**
- * Helper class to hold modifier state in an escape sequence.
- */
-struct Modifiers
-{
-  /**
-   * Returns the numeric width, or a default value if it's not set.
-   */
-  int get_width(int def) const { return width == -1 ? def : width; }
-  
-  /**
-   * Returns the pad character, or a default value if it's not set.
-   */
-  char get_pad(char def) const { return pad == 0 ? def : pad; }
-
-  int width = -1;
-  int precision = -1;
-  char pad = 0;
-  char str_case = 0;
-  bool abbreviate = false;
-  bool decimal = false;
-
-};
-
-
 bool
 parse_modifiers(
   string const& pattern,
   size_t& pos,
-  Modifiers& mods)
+  int& width,
+  int& precision,
+  char& pad,
+  char& str_case,
+  bool& abbreviate,
+  bool& decimal,
+  string& error,
+  bool& value_error)
 {
   switch (pattern[pos]) {
   case '.':
-    if (mods.decimal)
+    if (decimal) {
       // Already saw a decimal point in this escape.
-      throw ValueError("second decimal point in escape");
+      error = "second decimal point in escape";
+      value_error = true;
+    }
     else {
-      mods.decimal = true;
+      decimal = true;
       pos++;
     }
     break;
@@ -65,41 +49,43 @@ parse_modifiers(
   case '0': case '1': case '2': case '3': case '4':
   case '5': case '6': case '7': case '8': case '9':
     {
-      size_t const end = pattern.find_first_not_of("0123456789", pos);
-      int const value = atoi(pattern.substr(pos, end).c_str());
-      if (mods.decimal)
-        mods.precision = value;
+      int value = 0;
+      for (; pos < pattern.length() && isdigit(pattern[pos]); ++pos)
+        value = value * 10 + (pattern[pos] - '0');
+      if (decimal)
+        precision = value;
       else
-        mods.width = value;
-      pos = end;
+        width = value;
     }
     break;
 
   case '#':
-    mods.pad = pattern[++pos];
-    if (pos++ == pattern.length())
-      throw ValueError("unterminated escape in pattern");
+    pad = pattern[++pos];
+    if (pos++ == pattern.length()) {
+      error = "unterminated escape in pattern";
+      value_error = true;
+    }
     break;
 
   case '^':
   case '_':
-    mods.str_case = pattern[pos];
+    str_case = pattern[pos];
     pos++;
     break;
 
   case '~':
-    mods.abbreviate = true;
+    abbreviate = true;
     pos++;
     break;
 
   case 'E':
     // FIXME: IMPLEMENT: Locale's alternative representation.
-    throw TimeFormatError("not implemented: E");
+    error = "not implemented: E";
     break;
 
   case 'O':
     // FIXME: IMPLEMENT: Locale's alternative numerical representation
-    throw TimeFormatError("not implemented: O");
+    error = "not implemented: O";
     break;
 
   default:
@@ -113,19 +99,43 @@ parse_modifiers(
 }
 
 
+/**
+ * Returns the numeric width, or a default value if it's not set.
+ */
+inline int
+get_width(
+  Format::Op const& op,
+  int const def)
+{
+  return op.width == -1 ? def : op.width;
+}
+
+
+/**
+ * Returns the pad character, or a default value if it's not set.
+ */
+inline char
+get_pad(
+  Format::Op const& op,
+  char const def)
+{
+  return op.pad == 0 ? def : op.pad;
+}
+
+
 void
 format_string(
   StringBuilder& sb,
-  Modifiers const& mods,
+  Format::Op const& op,
   std::string const& str)
 {
-  int const pad_length = mods.width - str.length();
+  int const pad_length = op.width - str.length();
   if (pad_length > 0)
-    sb.pad(pad_length, mods.get_pad(' '));
+    sb.pad(pad_length, get_pad(op, ' '));
   
-  if (mods.str_case == '^' || mods.str_case == '_') {
+  if (op.str_case == '^' || op.str_case == '_') {
     std::string formatted = str;
-    std::transform(begin(formatted), end(formatted), begin(formatted), mods.str_case == '^' ? toupper : tolower);
+    std::transform(begin(formatted), end(formatted), begin(formatted), op.str_case == '^' ? toupper : tolower);
     sb << formatted;
   }
   else
@@ -133,21 +143,19 @@ format_string(
 }
 
 
-bool
+void
 format_date(
-  string const& pattern,
-  size_t& pos,
   StringBuilder& sb,
-  Modifiers const& mods,
+  Format::Op const& op,
   DateParts const& date)
 {
-  switch (pattern[pos]) {
+  switch (op.code) {
   case 'b':
-    format_string(sb, mods, mods.abbreviate ? get_month_abbr(date.month) : get_month_name(date.month));
+    format_string(sb, op, op.abbreviate ? get_month_abbr(date.month) : get_month_name(date.month));
     break;
 
   case 'd':
-    sb.format(date.day + 1, mods.get_width(2), mods.get_pad('0'));
+    sb.format(date.day + 1, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'D':
@@ -156,120 +164,141 @@ format_date(
     break;
 
   case 'g':
-    sb.format(date.week_year % 100, mods.get_width(2), mods.get_pad('0'));
+    sb.format(date.week_year % 100, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'G':
-    sb.format(date.week_year, mods.get_width(4), mods.get_pad('0'));
+    sb.format(date.week_year, get_width(op, 4), get_pad(op, '0'));
     break;
 
   case 'j':
-    sb.format(date.ordinal + 1, mods.get_width(3), mods.get_pad('0'));
+    sb.format(date.ordinal + 1, get_width(op, 3), get_pad(op, '0'));
     break;
 
   case 'm':
-    sb.format(date.month + 1, mods.get_width(2), mods.get_pad('0'));
+    sb.format(date.month + 1, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'V':
-    sb.format(date.week + 1, mods.get_width(2), mods.get_pad('0'));
+    sb.format(date.week + 1, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'w':
     // FIXME: Generalize?
-    sb.format((date.weekday + (7 - SUNDAY)) % 7, mods.get_width(1), mods.get_pad('0'));
+    sb.format((date.weekday + (7 - SUNDAY)) % 7, get_width(op, 1), get_pad(op, '0'));
     break;
 
   case 'W':
-    format_string(sb, mods, mods.abbreviate ? get_weekday_abbr(date.weekday) : get_weekday_name(date.weekday));
+    format_string(sb, op, op.abbreviate ? get_weekday_abbr(date.weekday) : get_weekday_name(date.weekday));
     break;
 
   case 'y':
-    sb.format(date.year % 100, mods.get_width(2), mods.get_pad('0'));
+    sb.format(date.year % 100, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'Y':
-    sb.format(date.year, mods.get_width(4), mods.get_pad('0'));
+    sb.format(date.year, get_width(op, 4), get_pad(op, '0'));
     break;
 
   default:
-    // Did not match anything.
-    return false;
+    assert(false);
 
   }
+}
 
-  // Matched an output character.
-  pos++;
-  return true;
+
+/*
+ * Returns the `group`th group of three subsecond digits: milliseconds for 1,
+ * microseconds for 2, and so on.  Exact, if the daytime's fraction is known.
+ */
+inline unsigned
+get_subsecond(
+  HmsDaytime const& daytime,
+  unsigned const group)
+{
+  if (daytime.fraction != FRACTION_INVALID)
+    return get_fraction_digits(daytime.fraction, 3 * group) % 1000;
+  else {
+    double const fraction = daytime.second - (unsigned) daytime.second;
+    return
+        group == 1 ? (unsigned) (fraction * 1e+3)
+      : group == 2 ? (unsigned) (fraction * 1e+6) % 1000
+      : group == 3 ? (unsigned) (fraction * 1e+9) % 1000
+      :              (unsigned) (fraction * 1e+12) % 1000;
+  }
 }
 
 
-bool
+/*
+ * Returns seconds times `10^prec`, rounded half up.  Exact, if the daytime's
+ * fraction is known.
+ */
+inline unsigned long long
+get_scaled_second(
+  HmsDaytime const& daytime,
+  unsigned const prec)
+{
+  if (daytime.fraction != FRACTION_INVALID)
+    return
+        (unsigned long long) daytime.second * pow10(prec)
+      + get_fraction_digits(daytime.fraction, prec, true);
+  else
+    return daytime.second * pow10(prec) + 0.5;
+}
+
+
+void
 format_daytime(
-  string const& pattern,
-  size_t& pos,
   StringBuilder& sb,
-  Modifiers const& mods,
+  Format::Op const& op,
   HmsDaytime const& daytime)
 {
-  switch (pattern[pos]) {
+  switch (op.code) {
   case 'h':
     {
       unsigned const hour = daytime.hour % 12;
-      sb.format(hour == 0 ? 12 : hour, mods.get_width(2), mods.get_pad('0'));
+      sb.format(hour == 0 ? 12 : hour, get_width(op, 2), get_pad(op, '0'));
     }
     break;
 
   case 'H':
-    sb.format(daytime.hour, mods.get_width(2), mods.get_pad('0'));
+    sb.format(daytime.hour, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'k':
-    {
-      unsigned const msec = (daytime.second - (unsigned) daytime.second) * 1e+3;
-      sb.format(msec, mods.get_width(3), mods.get_pad('0'));
-    }
+    sb.format(get_subsecond(daytime, 1), get_width(op, 3), get_pad(op, '0'));
     break;
 
   case 'K':
-    {
-      unsigned const usec = (unsigned) ((daytime.second - (unsigned) daytime.second) * 1e+6) % 1000;
-      sb.format(usec, mods.get_width(3), mods.get_pad('0'));
-    }
+    sb.format(get_subsecond(daytime, 2), get_width(op, 3), get_pad(op, '0'));
     break;
 
   case 'l':
-    {
-      unsigned const nsec = (unsigned) ((daytime.second - (unsigned) daytime.second) * 1e+9) % 1000;
-      sb.format(nsec, mods.get_width(3), mods.get_pad('0'));
-    }
+    sb.format(get_subsecond(daytime, 3), get_width(op, 3), get_pad(op, '0'));
     break;
 
   case 'L':
-    {
-      unsigned const psec = (unsigned) ((daytime.second - (unsigned) daytime.second) * 1e+12) % 1000;
-      sb.format(psec, mods.get_width(3), mods.get_pad('0'));
-    }
+    sb.format(get_subsecond(daytime, 4), get_width(op, 3), get_pad(op, '0'));
     break;
 
   case 'M':
-    sb.format(daytime.minute, mods.get_width(2), mods.get_pad('0'));
+    sb.format(daytime.minute, get_width(op, 2), get_pad(op, '0'));
     break;
 
   case 'p':
-    format_string(sb, mods, daytime.hour < 12 ? "AM" : "PM");
+    format_string(sb, op, daytime.hour < 12 ? "AM" : "PM");
     break;
 
   case 'S':
     {
-      unsigned const prec = std::max(0, mods.precision);
-      unsigned long long const digits = daytime.second * pow10(prec) + 0.5;
+      unsigned const prec = std::max(0, op.precision);
+      unsigned long long const digits = get_scaled_second(daytime, prec);
       // Integer part.
-      sb.format(digits / pow10(prec), mods.get_width(2), mods.get_pad('0'));
-      if (mods.precision >= 0) {
+      sb.format(digits / pow10(prec), get_width(op, 2), get_pad(op, '0'));
+      if (op.precision >= 0) {
         sb << '.';
         // Fractional part.
-        if (mods.precision > 0) 
+        if (op.precision > 0) 
           sb.format(digits % pow10(prec), prec, '0');
       }
     }
@@ -281,42 +310,35 @@ format_daytime(
     break;
 
   default:
-    // Did not match anything.
-    return false;
+    assert(false);
 
   }
-
-  // Matched an output character.
-  pos++;
-  return true;
 }
 
 
-bool
+void
 format_time_zone(
-  string const& pattern,
-  size_t& pos,
   StringBuilder& sb,
-  Modifiers const& mods,
+  Format::Op const& op,
   TimeZoneParts const& time_zone)
 {
-  switch (pattern[pos]) {
+  switch (op.code) {
   case 'o':
     sb << (time_zone.offset < 0 ? '-' : '+');
-    sb.format(std::abs(time_zone.offset), mods.get_width(5), mods.get_pad('0'));
+    sb.format(std::abs(time_zone.offset), get_width(op, 5), get_pad(op, '0'));
     break;
 
   case 'q':
     {
       unsigned const offset_min = std::abs(time_zone.offset) % SECS_PER_HOUR / SECS_PER_MIN;
-      sb.format(offset_min, mods.get_width(2), mods.get_pad('0'));
+      sb.format(offset_min, get_width(op, 2), get_pad(op, '0'));
     }
     break;
 
   case 'Q':
     {
       unsigned const offset_hour = std::abs(time_zone.offset) / SECS_PER_HOUR;
-      sb.format(offset_hour, mods.get_width(2),mods.get_pad('0'));
+      sb.format(offset_hour, get_width(op, 2), get_pad(op, '0'));
     }
     break;
 
@@ -326,49 +348,137 @@ format_time_zone(
 
   case 'Z':
     // FIXME: Time zone full name.
-    if (mods.abbreviate)
+    if (op.abbreviate)
       sb << time_zone.abbreviation;
     else
       throw TimeFormatError("not implemented: time zone full name");
     break;
 
   default:
-    // Did not match anything.
-    return false;
+    assert(false);
 
   }
-
-  // Matched an output character.
-  pos++;
-  return true;
 }
 
 
-bool
+void
 format_time(
-  string const& pattern,
-  size_t& pos,
   StringBuilder& /*sb*/,
-  Modifiers     const& /*mods*/,
+  Format::Op    const& op,
   DateParts     const& /*date_parts*/,
-  HmsDaytime  const& /*daytime_parts*/,
+  HmsDaytime    const& /*daytime_parts*/,
   TimeZoneParts const& /*time_zone_parts*/)
 {
-  switch (pattern[pos]) {
+  switch (op.code) {
   case 'c':
     // FIXME: Locale.
     throw TimeFormatError("not implemented: %c");
     break;
 
   default:
-    // Did not match anything.
-    return false;
+    assert(false);
 
   }
+}
 
-  // Matched an output character.
-  pos++;
-  return true;
+
+/*
+ * Returns the number of decimal digits in `value`.
+ */
+inline size_t
+num_digits(
+  uint64_t value)
+{
+  size_t digits = 1;
+  for (value /= 10; value > 0; value /= 10)
+    ++digits;
+  return digits;
+}
+
+
+/*
+ * Returns the width of a numeric escape formatting `value`.
+ */
+inline size_t
+numeric_width(
+  Format::Op const& op,
+  int const def,
+  uint64_t const value)
+{
+  return std::max<size_t>(get_width(op, def), num_digits(value));
+}
+
+
+/*
+ * Returns the width of a string escape formatting a string of `length`.
+ */
+inline size_t
+string_width(
+  Format::Op const& op,
+  size_t const length)
+{
+  return std::max<size_t>(std::max(op.width, 0), length);
+}
+
+
+/*
+ * Returns the width of an escape's output.  If `max`, returns the widest
+ * output for any valid parts, or 0 for escapes that can't be formatted.
+ * Otherwise, returns the width for all-zero parts, and raises the error for
+ * escapes that can't be formatted.
+ */
+size_t
+get_escape_width(
+  Format::Op const& op,
+  bool const max)
+{
+  switch (op.code) {
+  // Date escapes.
+  case 'b': return string_width(op, op.abbreviate ? 3 : max ? 9 : 7);
+  case 'd': return numeric_width(op, 2, max ? 31 : 1);
+  case 'g': return numeric_width(op, 2, max ? 99 : 0);
+  case 'G': return numeric_width(op, 4, max ? 9999 : 0);
+  case 'j': return numeric_width(op, 3, max ? 366 : 1);
+  case 'm': return numeric_width(op, 2, max ? 12 : 1);
+  case 'V': return numeric_width(op, 2, max ? 53 : 1);
+  case 'w': return numeric_width(op, 1, max ? 6 : 1);
+  case 'W': return string_width(op, op.abbreviate ? 3 : max ? 9 : 6);
+  case 'y': return numeric_width(op, 2, max ? 99 : 0);
+  case 'Y': return numeric_width(op, 4, max ? 9999 : 0);
+
+  // Daytime escapes.
+  case 'h': return numeric_width(op, 2, 12);
+  case 'H': return numeric_width(op, 2, max ? 23 : 0);
+  case 'k':
+  case 'K':
+  case 'l':
+  case 'L': return numeric_width(op, 3, max ? 999 : 0);
+  case 'M': return numeric_width(op, 2, max ? 59 : 0);
+  case 'p': return string_width(op, 2);
+  case 'S':
+    return
+        numeric_width(op, 2, max ? 60 : 0)
+      + (op.precision >= 0 ? 1 + op.precision : 0);
+
+  // Time zone escapes.
+  case 'o': return 1 + numeric_width(op, 5, max ? SECS_PER_DAY : 0);
+  case 'q': return numeric_width(op, 2, max ? 59 : 0);
+  case 'Q': return numeric_width(op, 2, max ? 24 : 0);
+  case 'U': return 1;
+  case 'Z':
+    if (op.abbreviate)
+      return max ? sizeof(TimeZoneParts::abbreviation) - 1 : 0;
+    else if (max)
+      return 0;
+    else
+      throw TimeFormatError("not implemented: time zone full name");
+
+  default:
+    if (max)
+      return 0;
+    else
+      throw TimeFormatError(std::string("not implemented: %") + op.code);
+  }
 }
 
 
@@ -377,68 +487,229 @@ format_time(
 
 //------------------------------------------------------------------------------
 
-void 
-Format::format(
-  StringBuilder& sb,
-  DateParts const* date_parts,
-  HmsDaytime const* daytime_parts,
-  TimeZoneParts const* time_zone_parts)
-  const
+void
+Format::compile()
 {
+  // Accumulates literal text, until the next escape.
+  std::string literal;
+  auto const flush = [this, &literal] () {
+    if (! literal.empty()) {
+      Op op{};
+      op.kind = Op::LITERAL;
+      op.index = literals_.size();
+      ops_.push_back(op);
+      literals_.push_back(std::move(literal));
+      literal.clear();
+    }
+  };
+
   size_t pos = 0;
-  while (true) {
+  while (error_.empty()) {
     // Find the next escape character.
     size_t const next = pattern_.find('%', pos);
     if (next == std::string::npos) {
       // No next escape.  Copy the rest of the pattern, and we're done.
-      sb << pattern_.substr(pos);
+      literal.append(pattern_, pos, std::string::npos);
       break;
     }
-    else if (next > pos)
+    else
       // Copy from the pattern until the next escape.
-      sb << pattern_.substr(pos, next - pos);
+      literal.append(pattern_, pos, next - pos);
     // Skip over the escape character.
     pos = next + 1;
 
     // Set up state for the escape sequence.
-    Modifiers mods;
+    Op op{};
+    op.width = -1;
+    op.precision = -1;
+    bool decimal = false;
 
     // Scan characters in the escape sequence.
-    for (bool done = false; ! done; ) {
-      if (pos == pattern_.length())
-        throw ValueError("unterminated escape in pattern");
-
+    while (true) {
+      if (pos == pattern_.length()) {
+        error_ = "unterminated escape in pattern";
+        value_error_ = true;
+      }
       // Literal '%' escape.
-      if (pattern_[pos] == '%') {
-        sb << '%';
+      else if (pattern_[pos] == '%') {
+        literal += '%';
         pos++;
         break;
       }
-
       // Handle modifiers.
-      if (parse_modifiers(pattern_, pos, mods))
+      else if (parse_modifiers(
+                 pattern_, pos, op.width, op.precision, op.pad, op.str_case,
+                 op.abbreviate, decimal, error_, value_error_)) {
+        if (error_.empty())
+          continue;
+      }
+      else {
+        // The escape code.
+        op.code = pattern_[pos++];
+        switch (op.code) {
+        case 'b': case 'd': case 'D': case 'g': case 'G': case 'j': case 'm':
+        case 'V': case 'w': case 'W': case 'y': case 'Y':
+          op.kind = Op::DATE;
+          break;
+        case 'h': case 'H': case 'k': case 'K': case 'l': case 'L': case 'M':
+        case 'p': case 'S': case 'T':
+          op.kind = Op::DAYTIME;
+          break;
+        case 'o': case 'q': case 'Q': case 'U': case 'Z':
+          op.kind = Op::TIME_ZONE;
+          break;
+        case 'c':
+          op.kind = Op::TIME;
+          break;
+        default:
+          op.kind = Op::UNKNOWN;
+          break;
+        }
+        flush();
+        ops_.push_back(op);
+        break;
+      }
+
+      // The rest of the pattern can't be compiled.
+      flush();
+      op.kind = Op::ERROR;
+      ops_.push_back(op);
+      break;
+    }
+  }
+
+  flush();
+
+  // Compute the widest output, for sizing buffers.
+  max_width_ = 0;
+  for (auto const& op : ops_)
+    switch (op.kind) {
+    case Op::LITERAL:
+      max_width_ += literals_[op.index].length();
+      break;
+
+    case Op::UNKNOWN:
+    case Op::ERROR:
+      break;
+
+    default:
+      max_width_ += get_escape_width(op, true);
+      break;
+    }
+}
+
+
+size_t
+Format::get_nominal_width()
+  const
+{
+  size_t width = 0;
+  for (auto const& op : ops_)
+    switch (op.kind) {
+    case Op::LITERAL:
+      width += literals_[op.index].length();
+      break;
+
+    case Op::UNKNOWN:
+      throw TimeFormatError(std::string("unknown escape '") + op.code + "'");
+
+    case Op::ERROR:
+      if (value_error_)
+        throw ValueError(error_);
+      else
+        throw TimeFormatError(error_);
+
+    default:
+      width += get_escape_width(op, false);
+      break;
+    }
+  return width;
+}
+
+
+size_t
+Format::get_num_minute_ops()
+  const
+{
+  size_t i = 0;
+  for (; i < ops_.size(); ++i) {
+    auto const& op = ops_[i];
+    if (! (   op.kind == Op::LITERAL
+           || op.kind == Op::DATE
+           || op.kind == Op::TIME_ZONE
+           || (op.kind == Op::DAYTIME
+               && (   op.code == 'h' || op.code == 'H'
+                   || op.code == 'M' || op.code == 'p'))))
+      break;
+  }
+  return i;
+}
+
+
+void 
+Format::format(
+  StringBuilder& sb,
+  DateParts const* date_parts,
+  HmsDaytime const* daytime_parts,
+  TimeZoneParts const* time_zone_parts,
+  size_t const begin,
+  size_t const end)
+  const
+{
+  // Make room for everything up front, unless we're in the caller's buffer,
+  // which the string may well fit even if the widest one wouldn't.
+  if (sb.on_heap())
+    sb.reserve(max_width_);
+
+  for (size_t i = begin; i < end; ++i) {
+    auto const& op = ops_[i];
+    switch (op.kind) {
+    case Op::LITERAL:
+      sb << literals_[op.index];
+      continue;
+
+    case Op::DATE:
+      if (date_parts != nullptr) {
+        format_date(sb, op, *date_parts);
         continue;
+      }
+      break;
 
-      // Handle escape codes for date components.
-      if (date_parts != nullptr
-          && format_date(pattern_, pos, sb, mods, *date_parts))
-        break;
-      if (daytime_parts != nullptr
-          && format_daytime(pattern_, pos, sb, mods, *daytime_parts))
-        break;
-      if (time_zone_parts != nullptr
-          && format_time_zone(pattern_, pos, sb, mods, *time_zone_parts))
-        break;
+    case Op::DAYTIME:
+      if (daytime_parts != nullptr) {
+        format_daytime(sb, op, *daytime_parts);
+        continue;
+      }
+      break;
+
+    case Op::TIME_ZONE:
+      if (time_zone_parts != nullptr) {
+        format_time_zone(sb, op, *time_zone_parts);
+        continue;
+      }
+      break;
+
+    case Op::TIME:
       if (   date_parts      != nullptr
           && daytime_parts   != nullptr
-          && time_zone_parts != nullptr
-          && format_time(pattern_, pos, sb, mods, *date_parts, *daytime_parts, *time_zone_parts))
-        break;
+          && time_zone_parts != nullptr) {
+        format_time(sb, op, *date_parts, *daytime_parts, *time_zone_parts);
+        continue;
+      }
+      break;
 
-      // If we made it this far, it's not a valid character.
-      throw TimeFormatError(
-        std::string("unknown escape '") + pattern_[pos] + "'");
+    case Op::UNKNOWN:
+      break;
+
+    case Op::ERROR:
+      if (value_error_)
+        throw ValueError(error_);
+      else
+        throw TimeFormatError(error_);
     }
+
+    // If we made it this far, it's not a valid escape for these parts.
+    throw TimeFormatError(std::string("unknown escape '") + op.code + "'");
   }
 }
 
@@ -455,6 +726,47 @@ TimeFormat const TimeFormat::ISO_UTC_EXTENDED   = "%Y-%m-%dT%H:%M:%SZ";
 TimeFormat const TimeFormat::ISO_ZONE_BASIC     = "%Y%m%dT%H%M%S%U%Q%q";
 TimeFormat const TimeFormat::ISO_ZONE_EXTENDED  = "%Y-%m-%dT%H:%M:%S%U%Q:%q";
 
+//------------------------------------------------------------------------------
+// Class TimeFormatter
+//------------------------------------------------------------------------------
+
+TimeFormatter::TimeFormatter(
+  TimeFormat const& format,
+  TimeZone_ptr const tz)
+  : format_(format),
+    tz_(std::move(tz)),
+    num_minute_ops_(format_.get_num_minute_ops()),
+    minute_(std::numeric_limits<int64_t>::min()),
+    time_zone_(TimeZoneParts::get_invalid())
+{
+}
+
+
+void
+TimeFormatter::set_prefix(
+  int64_t const minute,
+  TimeZoneParts const& time_zone)
+{
+  // Divide rounding toward -inf, for a positive minute of the day.
+  int64_t const day 
+    = minute / MINS_PER_DAY - (minute < 0 && minute % MINS_PER_DAY != 0 ? 1 : 0);
+  int64_t const day_minute = minute - day * MINS_PER_DAY;
+
+  minute_ = minute;
+  date_ = datenum_to_parts((Datenum) day);
+  // The prefix precedes any seconds in the pattern.
+  daytime_ = HmsDaytime{
+    (Hour) (day_minute / MINS_PER_HOUR), 
+    (Minute) (day_minute % MINS_PER_HOUR), 
+    0};
+  time_zone_ = time_zone;
+
+  StringBuilder sb;
+  format_.format(sb, &date_, &daytime_, &time_zone_, 0, num_minute_ops_);
+  prefix_ = sb.str();
+}
+
+
 //------------------------------------------------------------------------------
 // Class DateFormat
 //------------------------------------------------------------------------------
@@ -521,7 +833,7 @@ weekday_abbrs[] = { "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun" };
 }  // anonymous
 
 
-inline string const& 
+string const& 
 get_month_name(
   Month month)
 {
@@ -531,7 +843,7 @@ get_month_name(
 }
 
 
-inline Month 
+Month 
 parse_month_name(
   string const& str)
 {
@@ -542,7 +854,7 @@ parse_month_name(
 }
 
 
-inline string const& 
+string const& 
 get_month_abbr(
   Month month)
 {
@@ -552,7 +864,7 @@ get_month_abbr(
 }
 
 
-inline Month 
+Month 
 parse_month_abbr(
   string const& str)
 {
@@ -563,7 +875,7 @@ parse_month_abbr(
 }
 
 
-inline string const& 
+string const& 
 get_weekday_name(
   Weekday weekday)
 {
@@ -573,7 +885,7 @@ get_weekday_name(
 }
 
 
-inline Weekday 
+Weekday 
 parse_weekday_name(
   string const& str)
 {
@@ -584,7 +896,7 @@ parse_weekday_name(
 }
 
 
-inline string const& 
+string const& 
 get_weekday_abbr(
   Weekday weekday)
 {
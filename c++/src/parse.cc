@@ -0,0 +1,1040 @@
+#include <cctype>
+#include <string>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "aslib/exc.hh"
+#include "cron/date_math.hh"
+#include "cron/format.hh"
+#include "cron/parse.hh"
+
+namespace cron {
+
+using namespace aslib;
+
+using std::string;
+
+//------------------------------------------------------------------------------
+// Implementation helpers
+//------------------------------------------------------------------------------
+
+namespace {
+
+/*
+ * Bits for the fields that appear in a pattern.
+ */
+enum : unsigned
+{
+  YEAR_BIT          = 1 << 0,
+  MONTH_BIT         = 1 << 1,
+  DAY_BIT           = 1 << 2,
+  ORDINAL_BIT       = 1 << 3,
+  WEEK_YEAR_BIT     = 1 << 4,
+  WEEK_BIT          = 1 << 5,
+  WEEKDAY_BIT       = 1 << 6,
+  HOUR_BIT          = 1 << 7,
+  AM_PM_BIT         = 1 << 8,
+  OFFSET_BIT        = 1 << 9,
+};
+
+/*
+ * Widest numeric field we scan, so that values fit in an unsigned.
+ */
+unsigned constexpr
+MAX_WIDTH
+  = 9;
+
+uint64_t constexpr
+PSEC_PER_SEC
+  = 1000000000000ull;
+
+/*
+ * Powers of ten, for scaling fractional seconds to picoseconds.
+ */
+uint64_t constexpr
+POW10[]
+  = {1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+     10000000ull, 100000000ull, 1000000000ull, 10000000000ull,
+     100000000000ull, 1000000000000ull};
+
+
+/*
+ * Returns the escape's width, or a default value if it's not set.
+ */
+inline int
+get_width(
+  Format::Op const& spec,
+  int const def)
+{
+  return spec.width == -1 ? def : spec.width;
+}
+
+
+/*
+ * Returns the escape's pad character, or a default value if it's not set.
+ */
+inline char
+get_pad(
+  Format::Op const& spec,
+  char const def)
+{
+  return spec.pad == 0 ? def : spec.pad;
+}
+
+
+/*
+ * Returns the op for a numeric field.
+ */
+Parser::Op
+numeric(
+  Parser::Op::Kind const kind,
+  Format::Op const& spec,
+  int const width)
+{
+  int const w = get_width(spec, width);
+  if (w < 1 || (unsigned) w > MAX_WIDTH)
+    throw TimeFormatError("field width out of range");
+  return {kind, (uint8_t) w, -1, get_pad(spec, '0')};
+}
+
+
+/*
+ * Returns the op for a name or other non-numeric field.
+ */
+Parser::Op
+name(
+  Parser::Op::Kind const kind,
+  Format::Op const& spec)
+{
+  int const w = std::min(std::max(0, get_width(spec, 0)), 255);
+  return {kind, (uint8_t) w, -1, get_pad(spec, ' ')};
+}
+
+
+/*
+ * Compiles a date escape.  Returns false if `spec` isn't one.
+ */
+bool
+compile_date(
+  Format::Op const& spec,
+  Parser::Op& op,
+  unsigned& fields)
+{
+  using Op = Parser::Op;
+
+  switch (spec.code) {
+  case 'b':
+    op = name(spec.abbreviate ? Op::MONTH_ABBR : Op::MONTH_NAME, spec);
+    fields |= MONTH_BIT;
+    break;
+
+  case 'd':
+    op = numeric(Op::DAY, spec, 2);
+    fields |= DAY_BIT;
+    break;
+
+  case 'D':
+    throw TimeFormatError("not implemented: %D");
+
+  case 'g':
+    op = numeric(Op::WEEK_YEAR2, spec, 2);
+    fields |= WEEK_YEAR_BIT;
+    break;
+
+  case 'G':
+    op = numeric(Op::WEEK_YEAR, spec, 4);
+    fields |= WEEK_YEAR_BIT;
+    break;
+
+  case 'j':
+    op = numeric(Op::ORDINAL, spec, 3);
+    fields |= ORDINAL_BIT;
+    break;
+
+  case 'm':
+    op = numeric(Op::MONTH, spec, 2);
+    fields |= MONTH_BIT;
+    break;
+
+  case 'V':
+    op = numeric(Op::WEEK, spec, 2);
+    fields |= WEEK_BIT;
+    break;
+
+  case 'w':
+    op = numeric(Op::WEEKDAY, spec, 1);
+    fields |= WEEKDAY_BIT;
+    break;
+
+  case 'W':
+    op = name(spec.abbreviate ? Op::WEEKDAY_ABBR : Op::WEEKDAY_NAME, spec);
+    fields |= WEEKDAY_BIT;
+    break;
+
+  case 'y':
+    op = numeric(Op::YEAR2, spec, 2);
+    fields |= YEAR_BIT;
+    break;
+
+  case 'Y':
+    op = numeric(Op::YEAR, spec, 4);
+    fields |= YEAR_BIT;
+    break;
+
+  default:
+    return false;
+
+  }
+
+  return true;
+}
+
+
+/*
+ * Compiles a daytime escape.  Returns false if `spec` isn't one.
+ */
+bool
+compile_daytime(
+  Format::Op const& spec,
+  Parser::Op& op,
+  unsigned& fields)
+{
+  using Op = Parser::Op;
+
+  switch (spec.code) {
+  case 'h':
+    op = numeric(Op::HOUR12, spec, 2);
+    fields |= HOUR_BIT;
+    break;
+
+  case 'H':
+    op = numeric(Op::HOUR, spec, 2);
+    fields |= HOUR_BIT;
+    break;
+
+  case 'k': op = numeric(Op::MSEC, spec, 3); break;
+  case 'K': op = numeric(Op::USEC, spec, 3); break;
+  case 'l': op = numeric(Op::NSEC, spec, 3); break;
+  case 'L': op = numeric(Op::PSEC, spec, 3); break;
+
+  case 'M':
+    op = numeric(Op::MINUTE, spec, 2);
+    break;
+
+  case 'p':
+    op = name(Op::AM_PM, spec);
+    fields |= AM_PM_BIT;
+    break;
+
+  case 'S':
+    op = numeric(Op::SECOND, spec, 2);
+    op.precision = spec.precision < 0 ? -1 : std::min(spec.precision, 127);
+    break;
+
+  case 'T':
+    throw TimeFormatError("not implemented: %T");
+
+  default:
+    return false;
+
+  }
+
+  return true;
+}
+
+
+/*
+ * Compiles a time zone escape.  Returns false if `spec` isn't one.
+ */
+bool
+compile_time_zone(
+  Format::Op const& spec,
+  Parser::Op& op,
+  unsigned& fields)
+{
+  using Op = Parser::Op;
+
+  switch (spec.code) {
+  case 'o':
+    // The sign, then the offset in seconds.
+    op = numeric(Op::TZ_SECONDS, spec, 5);
+    fields |= OFFSET_BIT;
+    break;
+
+  case 'q':
+    op = numeric(Op::TZ_MINUTE, spec, 2);
+    fields |= OFFSET_BIT;
+    break;
+
+  case 'Q':
+    op = numeric(Op::TZ_HOUR, spec, 2);
+    fields |= OFFSET_BIT;
+    break;
+
+  case 'U':
+    op = name(Op::TZ_SIGN, spec);
+    fields |= OFFSET_BIT;
+    break;
+
+  case 'Z':
+    if (spec.abbreviate)
+      op = name(Op::TZ_ABBR, spec);
+    else
+      throw TimeFormatError("not implemented: time zone full name");
+    break;
+
+  default:
+    return false;
+
+  }
+
+  return true;
+}
+
+
+/*
+ * Scans exactly `width` digits, after any leading pad characters.
+ */
+inline bool
+scan_number(
+  char const*& p,
+  char const* const end,
+  Parser::Op const& op,
+  unsigned& value)
+{
+  if (end - p < op.width)
+    return false;
+  char const* const stop = p + op.width;
+  if (op.chr != '0')
+    while (p < stop - 1 && *p == op.chr)
+      ++p;
+  unsigned v = 0;
+  for (; p < stop; ++p) {
+    unsigned const digit = (unsigned char) *p - '0';
+    if (digit > 9)
+      return false;
+    v = v * 10 + digit;
+  }
+  value = v;
+  return true;
+}
+
+
+/*
+ * Skips pad characters before a name, if the op has a width.
+ */
+inline void
+skip_pad(
+  char const*& p,
+  char const* const end,
+  Parser::Op const& op)
+{
+  if (op.width > 0)
+    while (p < end && *p == op.chr)
+      ++p;
+}
+
+
+/*
+ * Matches `str` at `p` without regard to case.
+ */
+inline bool
+match(
+  char const*& p,
+  char const* const end,
+  string const& str)
+{
+  size_t const length = str.length();
+  if ((size_t) (end - p) < length)
+    return false;
+  for (size_t i = 0; i < length; ++i)
+    if (tolower((unsigned char) p[i]) != tolower((unsigned char) str[i]))
+      return false;
+  p += length;
+  return true;
+}
+
+
+/*
+ * Matches one of `count` names; stores its index in `value`.
+ */
+template<class GET_NAME>
+inline bool
+match_name(
+  char const*& p,
+  char const* const end,
+  unsigned const count,
+  GET_NAME get_name,
+  unsigned& value)
+{
+  for (unsigned i = 0; i < count; ++i)
+    if (match(p, end, get_name(i))) {
+      value = i;
+      return true;
+    }
+  return false;
+}
+
+
+/*
+ * Resolves a two-digit year, as POSIX does: 69-99 are in the 1900s.
+ */
+inline unsigned
+full_year(
+  unsigned const year)
+{
+  return year + (year < 69 ? 2000 : 1900);
+}
+
+
+/*
+ * Returns the value of the two digits at `p`, or a value greater than 99 if
+ * they aren't digits.
+ */
+inline unsigned
+digits2(
+  char const* const p)
+{
+  unsigned const d0 = (unsigned char) p[0] - '0';
+  unsigned const d1 = (unsigned char) p[1] - '0';
+  return d0 > 9 || d1 > 9 ? 100 : d0 * 10 + d1;
+}
+
+
+/*
+ * Scans the 16 bytes "YYYY-MM-DDTHH:MM" at `p`, one field at a time.
+ */
+inline bool
+iso_head_scalar(
+  char const* const p,
+  unsigned& year,
+  unsigned& month,
+  unsigned& day,
+  unsigned& hour,
+  unsigned& minute)
+{
+  unsigned const century = digits2(p);
+  unsigned const yy = digits2(p + 2);
+  month   = digits2(p + 5);
+  day     = digits2(p + 8);
+  hour    = digits2(p + 11);
+  minute  = digits2(p + 14);
+  year    = century * 100 + yy;
+  return
+       p[4] == '-' && p[7] == '-' && p[10] == 'T' && p[13] == ':'
+    && century < 100 && yy < 100 && month < 100 && day < 100 && hour < 100
+    && minute < 100;
+}
+
+
+#ifdef __SSE2__
+
+/*
+ * Scans the 16 bytes "YYYY-MM-DDTHH:MM" at `p`, all at once.
+ */
+inline bool
+iso_head_sse2(
+  char const* const p,
+  unsigned& year,
+  unsigned& month,
+  unsigned& day,
+  unsigned& hour,
+  unsigned& minute)
+{
+  __m128i const text = _mm_loadu_si128((__m128i const*) p);
+  // The separators, with zero in the positions of digits.
+  __m128i const seps = _mm_setr_epi8(
+    0, 0, 0, 0, '-', 0, 0, '-', 0, 0, 'T', 0, 0, ':', 0, 0);
+  __m128i const is_digit_pos = _mm_cmpeq_epi8(seps, _mm_setzero_si128());
+
+  // Digits must be 0-9, and separators must match.
+  __m128i const digits = _mm_sub_epi8(text, _mm_set1_epi8('0'));
+  __m128i const is_digit = _mm_cmpeq_epi8(
+    _mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+  __m128i const is_sep = _mm_cmpeq_epi8(text, seps);
+  __m128i const ok = _mm_or_si128(
+    _mm_and_si128(is_digit_pos, is_digit),
+    _mm_andnot_si128(is_digit_pos, is_sep));
+  if (_mm_movemask_epi8(ok) != 0xffff)
+    return false;
+
+  // Clear the separators, widen to 16 bits, and combine pairs of digits.
+  __m128i const values = _mm_and_si128(digits, is_digit_pos);
+  __m128i const zero = _mm_setzero_si128();
+  // "YYYY-MM-" -> YY, YY, M0, M
+  __m128i const lo = _mm_madd_epi16(
+    _mm_unpacklo_epi8(values, zero),
+    _mm_setr_epi16(10, 1, 10, 1, 0, 10, 1, 0));
+  // "DDTHH:MM" -> DD, H0, H, MM
+  __m128i const hi = _mm_madd_epi16(
+    _mm_unpackhi_epi8(values, zero),
+    _mm_setr_epi16(10, 1, 0, 10, 1, 0, 10, 1));
+
+  alignas(16) int32_t l[4];
+  alignas(16) int32_t h[4];
+  _mm_store_si128((__m128i*) l, lo);
+  _mm_store_si128((__m128i*) h, hi);
+  year    = l[0] * 100 + l[1];
+  month   = l[2] + l[3];
+  day     = h[0];
+  hour    = h[1] + h[2];
+  minute  = h[3];
+  return true;
+}
+
+#endif
+
+
+inline bool
+scan_iso_head(
+  char const* const p,
+  unsigned& year,
+  unsigned& month,
+  unsigned& day,
+  unsigned& hour,
+  unsigned& minute)
+{
+#ifdef __SSE2__
+  return iso_head_sse2(p, year, month, day, hour, minute);
+#else
+  return iso_head_scalar(p, year, month, day, hour, minute);
+#endif
+}
+
+
+}  // anonymous namespace
+
+
+//------------------------------------------------------------------------------
+// Class Parser
+//------------------------------------------------------------------------------
+
+Parser::Parser(
+  string const& pattern,
+  unsigned const categories)
+  : pattern_(pattern),
+    fields_(0)
+{
+  // Scan escapes and modifiers as formatting does.
+  Format const format(pattern_);
+
+  for (auto const& spec : format.ops_) {
+    if (spec.kind == Format::Op::LITERAL) {
+      for (char const c : format.literals_[spec.index])
+        ops_.push_back({Op::LITERAL, 0, -1, c});
+      continue;
+    }
+    else if (spec.kind == Format::Op::ERROR) {
+      if (format.value_error_)
+        throw ValueError(format.error_);
+      else
+        throw TimeFormatError(format.error_);
+    }
+
+    Op op;
+    if (   ! (   (categories & DATE_ESCAPES)
+              && compile_date(spec, op, fields_))
+        && ! (   (categories & DAYTIME_ESCAPES)
+              && compile_daytime(spec, op, fields_))
+        && ! (   (categories & TIME_ZONE_ESCAPES)
+              && compile_time_zone(spec, op, fields_))) {
+      if (spec.code == 'c' && categories == (
+            DATE_ESCAPES | DAYTIME_ESCAPES | TIME_ZONE_ESCAPES))
+        throw TimeFormatError("not implemented: %c");
+      else
+        throw TimeFormatError(string("unknown escape '") + spec.code + "'");
+    }
+    ops_.push_back(op);
+  }
+}
+
+
+bool
+Parser::scan(
+  char const* p,
+  char const* const end,
+  Fields& fields)
+  const
+{
+  fields.year       = 0;
+  fields.month      = 1;
+  fields.day        = 1;
+  fields.ordinal    = 1;
+  fields.week_year  = 0;
+  fields.week       = 1;
+  fields.weekday    = 0;
+  fields.hour       = 0;
+  fields.minute     = 0;
+  fields.second     = 0;
+  fields.psec       = 0;
+  fields.pm         = false;
+  fields.tz_sign    = 1;
+  fields.tz_hour    = 0;
+  fields.tz_minute  = 0;
+  fields.tz_seconds = 0;
+
+  unsigned value;
+  for (auto const& op : ops_) {
+    switch (op.kind) {
+    case Op::LITERAL:
+      if (p == end || *p != op.chr)
+        return false;
+      ++p;
+      break;
+
+    case Op::YEAR:
+      if (! scan_number(p, end, op, fields.year))
+        return false;
+      break;
+
+    case Op::YEAR2:
+      if (! scan_number(p, end, op, value))
+        return false;
+      fields.year = full_year(value);
+      break;
+
+    case Op::MONTH:
+      if (! scan_number(p, end, op, fields.month))
+        return false;
+      break;
+
+    case Op::MONTH_NAME:
+    case Op::MONTH_ABBR:
+      skip_pad(p, end, op);
+      if (! match_name(
+            p, end, 12,
+            op.kind == Op::MONTH_NAME ? get_month_name : get_month_abbr,
+            value))
+        return false;
+      fields.month = value + 1;
+      break;
+
+    case Op::DAY:
+      if (! scan_number(p, end, op, fields.day))
+        return false;
+      break;
+
+    case Op::ORDINAL:
+      if (! scan_number(p, end, op, fields.ordinal))
+        return false;
+      break;
+
+    case Op::WEEK_YEAR:
+      if (! scan_number(p, end, op, fields.week_year))
+        return false;
+      break;
+
+    case Op::WEEK_YEAR2:
+      if (! scan_number(p, end, op, value))
+        return false;
+      fields.week_year = full_year(value);
+      break;
+
+    case Op::WEEK:
+      if (! scan_number(p, end, op, fields.week))
+        return false;
+      break;
+
+    case Op::WEEKDAY:
+      // Numbered from Sunday.
+      if (! scan_number(p, end, op, value) || value > 6)
+        return false;
+      fields.weekday = (value + SUNDAY) % 7;
+      break;
+
+    case Op::WEEKDAY_NAME:
+    case Op::WEEKDAY_ABBR:
+      skip_pad(p, end, op);
+      if (! match_name(
+            p, end, 7,
+            op.kind == Op::WEEKDAY_NAME ? get_weekday_name : get_weekday_abbr,
+            fields.weekday))
+        return false;
+      break;
+
+    case Op::HOUR:
+    case Op::HOUR12:
+      if (! scan_number(p, end, op, fields.hour))
+        return false;
+      break;
+
+    case Op::AM_PM:
+      skip_pad(p, end, op);
+      if (match(p, end, "PM"))
+        fields.pm = true;
+      else if (! match(p, end, "AM"))
+        return false;
+      break;
+
+    case Op::MINUTE:
+      if (! scan_number(p, end, op, fields.minute))
+        return false;
+      break;
+
+    case Op::SECOND:
+      if (! scan_number(p, end, op, fields.second))
+        return false;
+      if (op.precision >= 0) {
+        if (p == end || *p != '.')
+          return false;
+        ++p;
+        if (end - p < op.precision)
+          return false;
+        // Keep digits to picoseconds; ignore the rest.
+        uint64_t psec = 0;
+        for (int i = 0; i < op.precision; ++i, ++p) {
+          unsigned const digit = (unsigned char) *p - '0';
+          if (digit > 9)
+            return false;
+          if (i < 12)
+            psec = psec * 10 + digit;
+        }
+        fields.psec += psec * POW10[12 - std::min<int>(op.precision, 12)];
+      }
+      break;
+
+    case Op::MSEC:
+    case Op::USEC:
+    case Op::NSEC:
+    case Op::PSEC:
+      if (! scan_number(p, end, op, value) || value > 999)
+        return false;
+      fields.psec += value * POW10[3 * (Op::PSEC - op.kind)];
+      break;
+
+    case Op::TZ_SIGN:
+      skip_pad(p, end, op);
+      if (p == end || (*p != '+' && *p != '-'))
+        return false;
+      fields.tz_sign = *p++ == '-' ? -1 : 1;
+      break;
+
+    case Op::TZ_HOUR:
+      if (! scan_number(p, end, op, fields.tz_hour))
+        return false;
+      break;
+
+    case Op::TZ_MINUTE:
+      if (! scan_number(p, end, op, fields.tz_minute))
+        return false;
+      break;
+
+    case Op::TZ_SECONDS:
+      // The formatter writes the sign along with the offset.
+      if (p == end || (*p != '+' && *p != '-'))
+        return false;
+      fields.tz_sign = *p++ == '-' ? -1 : 1;
+      if (! scan_number(p, end, op, fields.tz_seconds))
+        return false;
+      break;
+
+    case Op::TZ_ABBR:
+      {
+        skip_pad(p, end, op);
+        char const* const start = p;
+        while (p < end && (isalnum((unsigned char) *p) || *p == '+' || *p == '-'))
+          ++p;
+        if (p == start)
+          return false;
+      }
+      break;
+    }
+  }
+
+  // The whole text must match.
+  return p == end;
+}
+
+
+bool
+Parser::has_date()
+  const
+{
+  unsigned constexpr YMD = YEAR_BIT | MONTH_BIT | DAY_BIT;
+  unsigned constexpr ORDINAL_DATE = YEAR_BIT | ORDINAL_BIT;
+  unsigned constexpr WEEK_DATE = WEEK_YEAR_BIT | WEEK_BIT | WEEKDAY_BIT;
+  return
+       (fields_ & YMD) == YMD
+    || (fields_ & ORDINAL_DATE) == ORDINAL_DATE
+    || (fields_ & WEEK_DATE) == WEEK_DATE;
+}
+
+
+bool
+Parser::has_daytime()
+  const
+{
+  return fields_ & HOUR_BIT;
+}
+
+
+bool
+Parser::has_offset()
+  const
+{
+  return fields_ & OFFSET_BIT;
+}
+
+
+Datenum
+Parser::get_datenum(
+  Fields const& fields,
+  ErrorCode& error)
+  const
+{
+  unsigned constexpr YMD = YEAR_BIT | MONTH_BIT | DAY_BIT;
+  unsigned constexpr ORDINAL_DATE = YEAR_BIT | ORDINAL_BIT;
+
+  // Check ranges before narrowing to the date types.  Months, days, ordinals,
+  // and weeks are scanned one-based.
+  Datenum datenum = DATENUM_INVALID;
+  if ((fields_ & YMD) == YMD) {
+    if (   fields.year <= YEAR_MAX
+        && in_range(1u, fields.month, 12u)
+        && in_range(1u, fields.day, 31u)
+        && ymd_is_valid(fields.year, fields.month - 1, fields.day - 1))
+      datenum = ymd_to_datenum(fields.year, fields.month - 1, fields.day - 1);
+  }
+  else if ((fields_ & ORDINAL_DATE) == ORDINAL_DATE) {
+    if (   fields.year <= YEAR_MAX
+        && in_range(1u, fields.ordinal, (unsigned) ORDINAL_BOUND)
+        && ordinal_date_is_valid(fields.year, fields.ordinal - 1))
+      datenum = ordinal_date_to_datenum(fields.year, fields.ordinal - 1);
+  }
+  else if (
+       fields.week_year <= YEAR_MAX
+    && in_range(1u, fields.week, (unsigned) WEEK_BOUND)
+    && week_date_is_valid(fields.week_year, fields.week - 1, fields.weekday))
+    datenum = week_date_to_datenum(
+      fields.week_year, fields.week - 1, fields.weekday);
+
+  // A weekday, if given with another form, must agree.
+  if (   datenum != DATENUM_INVALID
+      && (fields_ & WEEKDAY_BIT)
+      && get_weekday(datenum) != fields.weekday)
+    datenum = DATENUM_INVALID;
+
+  error = datenum == DATENUM_INVALID ? ErrorCode::INVALID_DATE : ErrorCode::NONE;
+  return datenum;
+}
+
+
+Daytick
+Parser::get_daytick(
+  Fields const& fields,
+  ErrorCode& error)
+  const
+{
+  unsigned hour = fields.hour;
+  if (fields_ & AM_PM_BIT) {
+    // A 12-hour clock.
+    if (hour < 1 || hour > 12) {
+      error = ErrorCode::INVALID_DAYTIME;
+      return DAYTICK_INVALID;
+    }
+    hour = hour % 12 + (fields.pm ? 12 : 0);
+  }
+
+  if (   hour >= HOUR_BOUND
+      || fields.minute >= MINUTE_BOUND
+      || fields.second >= SECOND_BOUND) {
+    error = ErrorCode::INVALID_DAYTIME;
+    return DAYTICK_INVALID;
+  }
+
+  error = ErrorCode::NONE;
+  // Round the fractional part to the nearest daytick.
+  return
+      (Daytick) ((hour * MINS_PER_HOUR + fields.minute) * SECS_PER_MIN
+                 + fields.second)
+      * DAYTICK_PER_SEC
+    + (Daytick) (
+        ((unsigned __int128) fields.psec * DAYTICK_PER_SEC + PSEC_PER_SEC / 2)
+        / PSEC_PER_SEC);
+}
+
+
+TimeZoneOffset
+Parser::get_offset(
+  Fields const& fields)
+  const
+{
+  return
+      fields.tz_sign
+    * (TimeZoneOffset) (
+          fields.tz_seconds
+        + fields.tz_hour * SECS_PER_HOUR
+        + fields.tz_minute * SECS_PER_MIN);
+}
+
+
+//------------------------------------------------------------------------------
+// Class DateParser
+//------------------------------------------------------------------------------
+
+DateParser::DateParser(
+  string const& pattern)
+  : Parser(pattern, DATE_ESCAPES)
+{
+  if (! has_date())
+    throw TimeFormatError("pattern doesn't specify a date");
+}
+
+
+//------------------------------------------------------------------------------
+// Class DaytimeParser
+//------------------------------------------------------------------------------
+
+DaytimeParser::DaytimeParser(
+  string const& pattern)
+  : Parser(pattern, DAYTIME_ESCAPES)
+{
+  if (! has_daytime())
+    throw TimeFormatError("pattern doesn't specify a daytime");
+}
+
+
+//------------------------------------------------------------------------------
+// Class TimeParser
+//------------------------------------------------------------------------------
+
+TimeParser::TimeParser(
+  string const& pattern)
+  : Parser(pattern, DATE_ESCAPES | DAYTIME_ESCAPES | TIME_ZONE_ESCAPES)
+{
+  if (! has_date())
+    throw TimeFormatError("pattern doesn't specify a date");
+  if (! has_daytime())
+    throw TimeFormatError("pattern doesn't specify a daytime");
+}
+
+
+//------------------------------------------------------------------------------
+// ISO 8601 fast path
+//------------------------------------------------------------------------------
+
+bool
+scan_iso_head_scalar(
+  char const* const p,
+  unsigned& year,
+  unsigned& month,
+  unsigned& day,
+  unsigned& hour,
+  unsigned& minute)
+{
+  return iso_head_scalar(p, year, month, day, hour, minute);
+}
+
+
+#ifdef __SSE2__
+
+bool
+scan_iso_head_sse2(
+  char const* const p,
+  unsigned& year,
+  unsigned& month,
+  unsigned& day,
+  unsigned& hour,
+  unsigned& minute)
+{
+  return iso_head_sse2(p, year, month, day, hour, minute);
+}
+
+#endif
+
+
+ErrorCode
+scan_iso_time(
+  char const* const begin,
+  char const* const end,
+  IsoTime& time)
+{
+  // The shortest is "YYYY-MM-DDTHH:MM:SSZ".
+  if (end - begin < 20)
+    return ErrorCode::PARSE;
+
+  unsigned year, month, day, hour, minute;
+  if (! scan_iso_head(begin, year, month, day, hour, minute))
+    return ErrorCode::PARSE;
+  unsigned const second = digits2(begin + 17);
+  if (begin[16] != ':' || second > 99)
+    return ErrorCode::PARSE;
+
+  char const* p = begin + 19;
+  uint32_t nsec = 0;
+  if (*p == '.') {
+    ++p;
+    char const* const start = p;
+    char const* const stop = std::min(end, p + 9);
+    for (unsigned digit; p < stop && (digit = (unsigned char) *p - '0') <= 9; ++p)
+      nsec = nsec * 10 + digit;
+    if (p == start)
+      return ErrorCode::PARSE;
+    nsec *= POW10[9 - (p - start)];
+  }
+
+  if (p < end && *p == 'Z') {
+    ++p;
+    time.offset = 0;
+  }
+  else if (end - p >= 6 && (*p == '+' || *p == '-') && p[3] == ':') {
+    unsigned const tz_hour = digits2(p + 1);
+    unsigned const tz_minute = digits2(p + 4);
+    if (tz_hour > 99 || tz_minute > 59)
+      return ErrorCode::PARSE;
+    time.offset 
+      = (*p == '-' ? -1 : 1) 
+        * (TimeZoneOffset) (tz_hour * SECS_PER_HOUR + tz_minute * SECS_PER_MIN);
+    p += 6;
+  }
+  else
+    return ErrorCode::PARSE;
+  if (p != end)
+    return ErrorCode::PARSE;
+
+  if (! (   year <= YEAR_MAX
+         && in_range(1u, month, 12u)
+         && in_range(1u, day, 31u)
+         && ymd_is_valid(year, month - 1, day - 1)))
+    return ErrorCode::INVALID_DATE;
+  if (hour >= HOUR_BOUND || minute >= MINUTE_BOUND || second >= SECOND_BOUND)
+    return ErrorCode::INVALID_DAYTIME;
+
+  time.datenum = ymd_to_datenum(year, month - 1, day - 1);
+  time.ssm = (hour * MINS_PER_HOUR + minute) * SECS_PER_MIN + second;
+  time.nsec = nsec;
+  return ErrorCode::NONE;
+}
+
+
+ErrorCode
+scan_iso_date(
+  char const* const begin,
+  char const* const end,
+  Datenum& datenum)
+{
+  if (end - begin != 10 || begin[4] != '-' || begin[7] != '-')
+    return ErrorCode::PARSE;
+  unsigned const century = digits2(begin);
+  unsigned const yy = digits2(begin + 2);
+  unsigned const month = digits2(begin + 5);
+  unsigned const day = digits2(begin + 8);
+  if (century > 99 || yy > 99 || month > 99 || day > 99)
+    return ErrorCode::PARSE;
+
+  unsigned const year = century * 100 + yy;
+  if (! (   in_range(1u, month, 12u)
+         && in_range(1u, day, 31u)
+         && ymd_is_valid(year, month - 1, day - 1)))
+    return ErrorCode::INVALID_DATE;
+  datenum = ymd_to_datenum(year, month - 1, day - 1);
+  return ErrorCode::NONE;
+}
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
@@ -1,13 +1,19 @@
+#include <dirent.h>
+
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <fstream>
-#include <map>
+#include <limits>
 #include <memory>
+#include <mutex>
 
 #include "aslib/file.hh"
 #include "aslib/filename.hh"
+#include "cron/date_math.hh"
 #include "cron/time_zone.hh"
+#include "cron/tzdb.hh"
 #include "cron/tzfile.hh"
 
 namespace cron {
@@ -38,62 +44,482 @@ display_time_zone_initialized
 TimeZone_ptr
 display_time_zone;
 
+/*
+ * Exclusive end of the interval after the last transition.
+ */
+TimeOffset constexpr
+TIME_OFFSET_END
+  = std::numeric_limits<TimeOffset>::max();
+
+/*
+ * Source of serial numbers for time zone objects.
+ */
+std::atomic<uint64_t>
+next_serial
+  {1};
+
+/*
+ * Cursor used by lookups that don't provide their own.
+ */
+thread_local TimeZone::Cursor
+thread_cursor;
+
+/*
+ * Transitions before this time, 1800-01-01T00:00:00Z, are not indexed.
+ */
+TimeOffset constexpr
+INDEX_TIME_MIN
+  = -5364662400;
+
+/*
+ * Target number of index buckets per indexed transition.
+ */
+uint64_t constexpr
+INDEX_BUCKETS_PER_TRANSITION
+  = 4;
+
+/*
+ * Number of years, starting with the year of the last transition, for which
+ * to cache transitions generated from the rule.
+ */
+size_t constexpr
+RULE_CACHE_YEARS
+  = 512;
+
+/*
+ * Marks a year whose transitions aren't cached yet.
+ */
+uint64_t constexpr
+RULE_CACHE_EMPTY
+  = std::numeric_limits<uint64_t>::max();
+
 
 }  // anonymous namespace
 
 
 //------------------------------------------------------------------------------
 
-TimeZone::Entry::Entry(
-  TimeOffset transition_time,
+namespace {
+
+TimeZoneParts
+make_parts(
   TzFile::Type const& type)
-  : transition(transition_time)
 {
+  TimeZoneParts parts;
   parts.offset = type.gmt_offset_;
   parts.is_dst = type.is_dst_;
-  // FIXME: This is not future-proof.  Truncate with a warning?
-  assert(type.abbreviation_.length() < sizeof(TimeZoneParts::abbreviation));
+  // Truncate longer abbreviations, such as the message in the "Factory" zone.
   strncpy(parts.abbreviation, type.abbreviation_.c_str(), sizeof(TimeZoneParts::abbreviation));
   parts.abbreviation[sizeof(TimeZoneParts::abbreviation) - 1] = '\0';
+  return parts;
+}
+
+
+TimeZoneParts
+make_parts(
+  TzRule::Type const& type,
+  bool const is_dst)
+{
+  return make_parts(
+    TzFile::Type{type.offset, is_dst, type.abbreviation, false, false});
+}
+
+
+bool
+same_parts(
+  TimeZoneParts const& parts0,
+  TimeZoneParts const& parts1)
+{
+  return 
+       parts0.offset == parts1.offset
+    && parts0.is_dst == parts1.is_dst
+    && strncmp(
+         parts0.abbreviation, parts1.abbreviation, 
+         sizeof(TimeZoneParts::abbreviation)) == 0;
+}
+
+
+/*
+ * Returns the year containing `time`.
+ */
+inline Year
+get_year(
+  TimeOffset const time)
+{
+  // Round toward negative infinity.
+  TimeOffset const days 
+    = (time >= 0 ? time : time - (SECS_PER_DAY - 1)) / SECS_PER_DAY;
+  return datenum_to_ymd(DATENUM_UNIX_EPOCH + days).year;
+}
+
+
+/*
+ * End of the years in which the rule is evaluated; from here on, the last
+ * transition remains in effect.
+ */
+TimeOffset const
+RULE_WINDOW_END
+  = (TimeOffset) (DATENUM_BOUND - DATENUM_UNIX_EPOCH) * SECS_PER_DAY;
+
+
+}  // anonymous namespace
+
+
+/*
+ * Transitions generated from a POSIX TZ rule with DST.
+ *
+ * Transitions are generated a year at a time, as needed.  Years near the last
+ * transition are cached, so repeated lookups don't reevaluate the rule.  The
+ * cache is shared by threads without locking; a slot may be computed more
+ * than once, but always to the same value.
+ */
+class TimeZone::Rule
+{
+public:
+
+  Rule(
+    TzRule const& rule,
+    Entry const& std,
+    Entry const& dst,
+    TimeOffset const start)
+    : rule_(rule),
+      std_(std),
+      dst_(dst),
+      start_(start),
+      first_year_(get_year(start))
+  {
+    for (auto& slot : cache_)
+      slot.store(RULE_CACHE_EMPTY, std::memory_order_relaxed);
+  }
+
+  /*
+   * Time of the last explicit transition, after which the rule applies.
+   */
+  TimeOffset get_start() const { return start_; }
+
+  /*
+   * Fills `entries` with the transitions in years `year - 1` through 
+   * `year + 2`, but not past YEAR_MAX, that follow the last explicit
+   * transition, in descending order.  Returns the end of the filled entries.
+   */
+  Entry*
+  get_entries(
+    Year const year,
+    Entry* entries)
+    const
+  {
+    Entry* end = entries;
+    for (Year y = std::min<Year>(year + 2, YEAR_MAX); y >= year - 1; --y) {
+      TimeOffset start, stop;
+      get_transitions(y, start, stop);
+      // In the southern hemisphere, DST starts after it ends.
+      Entry const& later = start > stop ? dst_ : std_;
+      Entry const& earlier = start > stop ? std_ : dst_;
+      if (std::max(start, stop) > start_) {
+        *end = later;
+        end++->transition = std::max(start, stop);
+      }
+      if (std::min(start, stop) > start_) {
+        *end = earlier;
+        end++->transition = std::min(start, stop);
+      }
+    }
+    return end;
+  }
+
+private:
+
+  void
+  get_transitions(
+    Year const year,
+    TimeOffset& start,
+    TimeOffset& stop)
+    const
+  {
+    size_t const i = year - first_year_;
+    if (i >= RULE_CACHE_YEARS) {
+      rule_.get_transitions(year, start, stop);
+      return;
+    }
+
+    // Cache each time as a 32-bit offset from the start of the year.
+    TimeOffset const base 
+      = ((TimeOffset) jan1_datenum(year) - DATENUM_UNIX_EPOCH) * SECS_PER_DAY;
+    uint64_t packed = cache_[i].load(std::memory_order_relaxed);
+    if (packed == RULE_CACHE_EMPTY) {
+      rule_.get_transitions(year, start, stop);
+      packed = 
+          (uint64_t) (uint32_t) (start - base) << 32 
+        | (uint64_t) (uint32_t) (stop - base);
+      cache_[i].store(packed, std::memory_order_relaxed);
+    }
+    else {
+      start = base + (int32_t) (packed >> 32);
+      stop = base + (int32_t) (uint32_t) packed;
+    }
+  }
+
+  TzRule const rule_;
+  // Entries for standard time and for DST; only the transition varies.
+  Entry const std_;
+  Entry const dst_;
+  TimeOffset const start_;
+  Year const first_year_;
+
+  mutable std::atomic<uint64_t> cache_[RULE_CACHE_YEARS];
+
+};
+
+
+TimeZone::Entry::Entry(
+  TimeOffset const transition_time,
+  TimeZoneParts const& parts,
+  uint8_t const type)
+  : transition(transition_time),
+    parts(parts),
+    type(type)
+{
 }
 
 
-TimeZone::TimeZone()
-  : name_("UTC")
+TimeZone::TimeZone(
+  TimeZoneId const id)
+  : serial_(next_serial++),
+    id_(id),
+    name_("UTC")
 {
-  entries_.emplace_back(
-    TIME_OFFSET_MIN, 
-    TzFile::Type{0, false, "UTC", true, true});
+  auto storage = std::make_shared<Storage>();
+  storage->types.push_back(
+    make_parts(TzFile::Type{0, false, "UTC", true, true}));
+  storage->entries.emplace_back(TIME_OFFSET_MIN, storage->types[0], 0);
+  set_storage(std::move(storage));
 }
 
 
 TimeZone::TimeZone(
   TzFile const& tz_file,
-  std::string const& name)
-  : name_(name)
+  std::string const& name,
+  TimeZoneId const id)
+  : serial_(next_serial++),
+    id_(id),
+    name_(name)
 {
-  entries_.reserve(tz_file.transitions_.size() + 1);
+  auto storage = std::make_shared<Storage>();
+  auto& types = storage->types;
+  auto& entries = storage->entries;
 
-  // Find the first non-DST time type.
   assert(tz_file.types_.size() > 0);
-  TzFile::Type const* default_type = nullptr;
-  for (auto type : tz_file.types_)
-    if (! type.is_dst_) {
-      default_type = &type;
+  assert(tz_file.types_.size() <= 256);
+  types.reserve(tz_file.types_.size());
+  for (auto const& type : tz_file.types_)
+    types.push_back(make_parts(type));
+
+  entries.reserve(tz_file.transitions_.size() + 1);
+
+  // Find the first non-DST time type.  If there is none, use the first type
+  // unconditionally.
+  uint8_t default_type = 0;
+  for (size_t t = 0; t < tz_file.types_.size(); ++t)
+    if (! tz_file.types_[t].is_dst_) {
+      default_type = t;
       break;
     }
-  // If we didn't find a non-DST type, use the first type unconditionally.
-  if (default_type == nullptr) 
-    default_type = &tz_file.types_.front();
   // Add a sentry entry.
-  entries_.emplace_back(TIME_OFFSET_MIN, *default_type);
+  entries.emplace_back(TIME_OFFSET_MIN, types[default_type], default_type);
 
   for (auto const& transition : tz_file.transitions_)
-    entries_.emplace_back(
-      transition.time_, 
-      tz_file.types_[transition.type_index_]);
-  assert(entries_.size() == tz_file.transitions_.size() + 1);
-  std::reverse(begin(entries_), end(entries_));
+    // Skip transitions before the sentry, such as the "big bang" transition
+    // that zic emits, so that the entries stay sorted.
+    if (transition.time_ > TIME_OFFSET_MIN)
+      entries.emplace_back(
+        transition.time_, 
+        types[transition.type_index_],
+        transition.type_index_);
+  std::reverse(begin(entries), end(entries));
+
+  // Make sure the rule's types are available.
+  TzRule const rule(tz_file.future_);
+  if (rule.has_dst())
+    for (auto const& parts : {
+           make_parts(rule.get_std(), false), 
+           make_parts(rule.get_dst(), true)})
+      if (std::none_of(
+            begin(types), end(types), 
+            [&parts] (TimeZoneParts const& p) { return same_parts(p, parts); })) {
+        if (types.size() == 256)
+          throw FormatError("too many time zone types");
+        types.push_back(parts);
+      }
+
+  set_storage(std::move(storage));
+  set_rule(rule);
+}
+
+
+TimeZone::TimeZone(
+  std::string const& name, 
+  TimeZoneId const id,
+  std::shared_ptr<void const> storage,
+  Array<TimeZoneParts> const types, 
+  Array<Entry> const entries, 
+  TimeOffset const index_start, 
+  int const index_shift, 
+  Array<uint32_t> const index,
+  TzRule const& rule)
+  : serial_(next_serial++),
+    id_(id),
+    name_(name),
+    storage_(std::move(storage)),
+    types_(types),
+    entries_(entries),
+    index_start_(index_start),
+    index_shift_(index_shift),
+    index_(index)
+{
+  set_rule(rule);
+}
+
+
+void
+TimeZone::set_storage(
+  std::shared_ptr<Storage> const storage)
+{
+  auto const& entries = storage->entries;
+
+  // Count the transitions to index, skipping the sentry as well as ancient
+  // transitions, which would stretch the index without making it more useful.
+  size_t num = 0;
+  while (num < entries.size() - 1 
+         && entries[num].transition >= INDEX_TIME_MIN)
+    ++num;
+
+  if (num == 0) {
+    // Nothing to index; search everything.
+    index_start_ = TIME_OFFSET_INVALID;
+    index_shift_ = 0;
+  }
+  else {
+    // Choose a power-of-two bucket width to give a few buckets per
+    // transition, so that each bucket contains at most a transition or two.
+    index_start_ = entries[num - 1].transition;
+    uint64_t const span = entries[0].transition - index_start_;
+    index_shift_ = 0;
+    while ((span >> index_shift_) > INDEX_BUCKETS_PER_TRANSITION * num)
+      ++index_shift_;
+
+    // For each bucket, store the entry in effect at its start.
+    size_t const num_buckets = (span >> index_shift_) + 1;
+    auto& index = storage->index;
+    index.reserve(num_buckets);
+    size_t pos = num - 1;
+    for (size_t b = 0; b < num_buckets; ++b) {
+      TimeOffset const start = index_start_ + ((TimeOffset) b << index_shift_);
+      while (pos > 0 && entries[pos - 1].transition <= start)
+        --pos;
+      index.push_back(pos);
+    }
+  }
+
+  types_ = storage->types;
+  entries_ = storage->entries;
+  index_ = storage->index;
+  storage_ = storage;
+}
+
+
+void
+TimeZone::set_rule(
+  TzRule const& rule)
+{
+  if (! rule.has_dst())
+    // The last transition remains in effect.
+    return;
+
+  auto const find_type = [this] (TimeZoneParts const& parts) {
+    auto const type = std::find_if(
+      types_.cbegin(), types_.cend(), 
+      [&parts] (TimeZoneParts const& p) { return same_parts(p, parts); });
+    if (type == types_.cend())
+      throw FormatError("no type for TZ rule");
+    return Entry(0, parts, type - types_.cbegin());
+  };
+  rule_ = std::make_shared<Rule const>(
+    rule, 
+    find_type(make_parts(rule.get_std(), false)), 
+    find_type(make_parts(rule.get_dst(), true)),
+    entries_[0].transition);
+}
+
+
+TimeZone::EntryIter
+TimeZone::get_window(
+  TimeOffset const time,
+  Entry* const window)
+  const
+{
+  // Use the window for local times that may fall after the last transition.
+  if (rule_ == nullptr || time < rule_->get_start() - SECS_PER_DAY)
+    return nullptr;
+  Year const year = get_year(time);
+  if (! year_is_valid(year))
+    // Too far out to evaluate; the last transition remains in effect.
+    return nullptr;
+
+  // Generated transitions, followed by enough of the last entries that local
+  // times near the last transition have their neighbors.
+  auto end = rule_->get_entries(year, window);
+  for (size_t i = 0; i < 3 && i < entries_.size(); ++i)
+    *end++ = entries_[i];
+  assert(end <= window + WINDOW_SIZE);
+  return end;
+}
+
+
+TimeZone::EntryIter
+TimeZone::find_entry(
+  EntryIter const begin,
+  EntryIter const end,
+  TimeOffset const time)
+{
+  EntryIter iter = begin;
+  while (iter->transition > time && iter + 1 != end)
+    ++iter;
+  return iter;
+}
+
+
+TimeZone::EntryIter
+TimeZone::find_entry(
+  TimeOffset const time)
+  const
+{
+  if (time >= index_start_) {
+    uint64_t const bucket = (uint64_t) (time - index_start_) >> index_shift_;
+    if (bucket >= index_.size())
+      // After the last transition.
+      return entries_.cbegin();
+    // Start at the entry in effect at the start of the bucket, and advance past
+    // any later transitions in the bucket.
+    size_t pos = index_[bucket];
+    while (pos > 0 && entries_[pos - 1].transition <= time)
+      --pos;
+    return entries_.cbegin() + pos;
+  }
+  else
+    // Before the indexed transitions.  The sentry protects from no result.
+    return std::lower_bound(
+      entries_.cbegin(), entries_.cend(), 
+      time,
+      [] (Entry const& entry, TimeOffset time) { 
+        return entry.transition > time; 
+      });
+}
+
+
+TimeZone::Cursor const&
+TimeZone::get_thread_cursor()
+{
+  return thread_cursor;
 }
 
 
@@ -102,11 +528,72 @@ TimeZone::get_parts(
   TimeOffset time)
   const
 {
-  auto iter = std::lower_bound(
-    entries_.cbegin(), entries_.cend(), 
-    time,
-    [] (Entry const& entry, TimeOffset time) { return entry.transition > time; });
-  return iter->parts;
+  return get_parts(time, thread_cursor);
+}
+
+
+TimeZoneParts
+TimeZone::get_parts(
+  TimeOffset const time,
+  Cursor& cursor)
+  const
+{
+  return lookup(time, cursor).parts;
+}
+
+
+TimeZoneIdParts
+TimeZone::get_id_parts(
+  TimeOffset const time)
+  const
+{
+  return get_id_parts(time, thread_cursor);
+}
+
+
+TimeZoneIdParts
+TimeZone::get_id_parts(
+  TimeOffset const time,
+  Cursor& cursor)
+  const
+{
+  auto const& interval = lookup(time, cursor);
+  return {interval.parts.offset, id_, interval.type, interval.parts.is_dst};
+}
+
+
+TimeZone::Cursor::Interval const&
+TimeZone::lookup(
+  TimeOffset const time,
+  Cursor& cursor)
+  const
+{
+  if (cursor.serial_ == serial_ && cursor.utc_.contains(time)) {
+    ++cursor.hits_;
+    return cursor.utc_;
+  }
+
+  ++cursor.misses_;
+  if (cursor.serial_ != serial_) {
+    cursor.serial_ = serial_;
+    cursor.local_ = {};
+  }
+  Entry window[WINDOW_SIZE];
+  auto begin = entries_.cbegin();
+  auto iter = begin;
+  if (auto const end = get_window(time, window))
+    iter = find_entry(begin = window, end, time);
+  else
+    iter = find_entry(time);
+  cursor.utc_.start = iter->transition;
+  cursor.utc_.end = iter == begin ? TIME_OFFSET_END : (iter - 1)->transition;
+  if (rule_ != nullptr && iter == entries_.cbegin())
+    // Past the last transition but outside the window, so too far out for the
+    // rule.  Don't cache the rule's range along with it.
+    cursor.utc_.start = std::max(cursor.utc_.start, RULE_WINDOW_END);
+  cursor.utc_.parts = iter->parts;
+  cursor.utc_.type = iter->type;
+  return cursor.utc_;
 }
 
 
@@ -115,14 +602,130 @@ TimeZone::get_parts_local(
   TimeOffset time,
   bool first)
   const
+{
+  return get_parts_local(time, thread_cursor, first);
+}
+
+
+TimeZoneParts
+TimeZone::get_parts_local(
+  TimeOffset const time,
+  Cursor& cursor,
+  bool const first)
+  const
+{
+  if (cursor.serial_ == serial_ && cursor.local_.contains(time)) {
+    ++cursor.hits_;
+    return cursor.local_.parts;
+  }
+
+  ++cursor.misses_;
+  if (cursor.serial_ != serial_) {
+    cursor.serial_ = serial_;
+    cursor.utc_ = {};
+  }
+  return find_parts_local(time, cursor, first);
+}
+
+
+LocalTimeStatus
+TimeZone::get_parts_local(
+  TimeOffset const time,
+  TimeZoneParts& parts,
+  bool const first)
+  const
+{
+  auto& cursor = thread_cursor;
+  if (cursor.serial_ == serial_ && cursor.local_.contains(time)) {
+    ++cursor.hits_;
+    parts = cursor.local_.parts;
+    return LocalTimeStatus::UNIQUE;
+  }
+
+  ++cursor.misses_;
+  if (cursor.serial_ != serial_) {
+    cursor.serial_ = serial_;
+    cursor.utc_ = {};
+  }
+  return resolve_local(time, cursor, first, parts);
+}
+
+
+void
+TimeZone::cache_local(
+  EntryIter const begin,
+  EntryIter const end,
+  EntryIter const iter,
+  Cursor& cursor)
+{
+  // Cache the local times that fall only in this interval: those that are not
+  // also in the previous interval, nor in the next.
+  auto const offset = iter->parts.offset;
+  auto& local = cursor.local_;
+  local.start = iter->transition + offset;
+  if (iter + 1 != end)
+    local.start = std::max(
+      local.start, iter->transition + (iter + 1)->parts.offset);
+  if (iter == begin)
+    local.end = TIME_OFFSET_END;
+  else {
+    auto const next = iter - 1;
+    local.end = std::min(
+      next->transition + offset, next->transition + next->parts.offset);
+  }
+  local.parts = iter->parts;
+  local.type = iter->type;
+}
+
+
+TimeZoneParts
+TimeZone::find_parts_local(
+  TimeOffset const time,
+  Cursor& cursor,
+  bool const first)
+  const
+{
+  TimeZoneParts parts;
+  if (resolve_local(time, cursor, first, parts) == LocalTimeStatus::NONEXISTENT)
+    throw NonexistentLocalTime(); 
+  return parts;
+}
+
+
+LocalTimeStatus
+TimeZone::resolve_local(
+  TimeOffset const time,
+  Cursor& cursor,
+  bool const first,
+  TimeZoneParts& parts)
+  const
+{
+  Entry window[WINDOW_SIZE];
+  if (auto const end = get_window(time, window))
+    return resolve_local(window, end, time, cursor, first, parts);
+
+  auto const status = resolve_local(
+    entries_.cbegin(), entries_.cend(), time, cursor, first, parts);
+  if (rule_ != nullptr && cursor.local_.end == TIME_OFFSET_END)
+    // As in lookup(), don't cache the rule's range.
+    cursor.local_.start = std::max(cursor.local_.start, RULE_WINDOW_END);
+  return status;
+}
+
+
+LocalTimeStatus
+TimeZone::resolve_local(
+  EntryIter const begin,
+  EntryIter const end,
+  TimeOffset const time,
+  Cursor& cursor,
+  bool const first,
+  TimeZoneParts& parts)
 {
   // First, find the most recent transition, pretending the time is UTC.
-  auto const iter = std::lower_bound(
-    entries_.cbegin(), entries_.cend(), 
-    time,
-    [] (Entry const& entry, TimeOffset time) { return entry.transition > time; });
+  auto const iter = find_entry(begin, end, time);
   // The sentry protects from no result.
-  assert(iter != entries_.cend());
+  assert(iter != end);
 
   // We've found the most recent transition for the UTC time, but we want the
   // transition for the local time.  The local time may be before this
@@ -139,17 +742,17 @@ TimeZone::get_parts_local(
   auto const next = iter - 1;
 
   bool const in_prev
-    = prev != entries_.cend()
+    = prev != end
       && prev->transition + prev->parts.offset <= time
       && time < (prev - 1)->transition + prev->parts.offset;
   bool const in_this
     = iter->transition + iter->parts.offset <= time
-      && (iter == entries_.cbegin()
+      && (iter == begin
           || time < (iter - 1)->transition + iter->parts.offset);
   bool const in_next
-    = iter != entries_.cbegin()
+    = iter != begin
       && next->transition + next->parts.offset <= time
-      && (next == entries_.cbegin()
+      && (next == begin
           || time < (next - 1)->transition + next->parts.offset);
 
   // FIXME: For debugging.
@@ -175,28 +778,64 @@ TimeZone::get_parts_local(
       << " -> " << (in_next ? "true" : "false") << '\n';
   }
 
-  if (in_this)
-    // The local time is part of the transition interval we found, but if it
-    // occurred in the previous or next as well, we need to disambiguate.
-    return 
+  if (in_prev + in_this + in_next == 1) {
+    // The local time is unambiguous.  Cache the interval in which we found it.
+    auto const found = in_this ? iter : in_prev ? prev : next;
+    cache_local(begin, end, found, cursor);
+    parts = found->parts;
+    return LocalTimeStatus::UNIQUE;
+  }
+  else if (in_this) {
+    // The local time is part of the transition interval we found, but it
+    // occurred in the previous or next as well, so we need to disambiguate.
+    parts = 
         in_prev ? (first ? (iter + 1)->parts : iter->parts)
-      : in_next ? (first ? iter->parts : (iter - 1)->parts)
-      : iter->parts;
-  else if (in_prev)
-    // Actually, it's only in the previous transition interval.
-    return (iter + 1)->parts;
-  else if (in_next)
-    // Actually, it's only in the next transition interval.
-    return (iter - 1)->parts;
+      : (first ? iter->parts : (iter - 1)->parts);
+    return LocalTimeStatus::AMBIGUOUS;
+  }
+  else if (in_prev || in_next) {
+    // It's not in the transition interval we found, but in both the previous
+    // and the next.
+    parts = in_prev ? prev->parts : next->parts;
+    return LocalTimeStatus::AMBIGUOUS;
+  }
   else
     // The local time does not exist.
-    throw NonexistentLocalTime(); 
+    return LocalTimeStatus::NONEXISTENT;
 }
 
 
-TimeZone_ptr const
-UTC 
-  = make_shared<TimeZone>();
+void
+TimeZone::get_offsets_local(
+  TimeOffset const* const times,
+  size_t const count,
+  bool const first,
+  TimeZoneOffset* const offsets,
+  LocalTimeStatus* const statuses)
+  const
+{
+  Cursor cursor;
+  cursor.serial_ = serial_;
+  for (size_t i = 0; i < count; ) {
+    // Resolve the run of times in the cached interval without searching.
+    auto const& local = cursor.local_;
+    for (; i < count && local.contains(times[i]); ++i) {
+      offsets[i] = local.parts.offset;
+      statuses[i] = LocalTimeStatus::UNIQUE;
+    }
+    if (i == count)
+      break;
+
+    // Look up the next time, which also caches its interval if it is unique.
+    TimeZoneParts parts;
+    statuses[i] = resolve_local(times[i], cursor, first, parts);
+    offsets[i] = 
+      statuses[i] == LocalTimeStatus::NONEXISTENT 
+      ? TIME_ZONE_OFFSET_INVALID 
+      : parts.offset;
+    ++i;
+  }
+}
 
 
 //------------------------------------------------------------------------------
@@ -221,30 +860,211 @@ fs::Filename const
 ZONEINFO_DIR_DEFAULT
   = "/usr/share/zoneinfo";
 
-fs::Filename
-zoneinfo_dir 
-  {""};
+char const* const
+ZONEINFO_DB_ENVVAR
+  = "ZONEINFO_DB";
+
+/*
+ * Returns the compiled time zone database named by the environment, or null
+ * if there is none.
+ */
+TzDatabase const*
+get_time_zone_db()
+{
+  // Initialized once, from the environment if set.
+  static std::unique_ptr<TzDatabase const> const db = [] () {
+    char const* const env_val = getenv(ZONEINFO_DB_ENVVAR);
+    return 
+      env_val != nullptr && *env_val != '\0'
+      ? std::unique_ptr<TzDatabase const>(new TzDatabase(env_val))
+      : nullptr;
+  }();
+  return db.get();
+}
+
+/*
+ * Registry of loaded time zones, by name and by ID.
+ *
+ * The registry is an insert-only hash table with a fixed number of buckets,
+ * each a singly-linked list of nodes.  Nodes are prepended with a release
+ * store and never removed, so lookups of loaded time zones take no lock and
+ * never wait.  Loading a new time zone takes a mutex, so that each is loaded
+ * only once.
+ *
+ * Each loaded time zone is also assigned the next ID, and stored at that 
+ * position in an array, which is published by a release store of its size.
+ *
+ * Time zones are loaded from the compiled database named by $ZONEINFO_DB, if
+ * set and it contains them, otherwise from zoneinfo files.
+ */
+class Registry
+{
+public:
+
+  struct Node
+  {
+    string const name;
+    TimeZone_ptr const tz;
+    Node const* const next;
+  };
+
+  Registry()
+  {
+    for (auto& bucket : buckets_)
+      bucket.store(nullptr, std::memory_order_relaxed);
+    // UTC is built in, with the first ID.  It isn't registered by name, so
+    // get_time_zone("UTC") still loads the zoneinfo file.
+    utc_ = make_shared<TimeZone const>(UTC_ID);
+    zones_[UTC_ID] = utc_.get();
+    size_.store(UTC_ID + 1, std::memory_order_relaxed);
+  }
+
+  Registry(Registry const&) = delete;
+  void operator=(Registry const&) = delete;
+
+  ~Registry()
+  {
+    for (auto& bucket : buckets_) 
+      for (Node const* node = bucket.load(std::memory_order_relaxed); 
+           node != nullptr; ) {
+        Node const* const next = node->next;
+        delete node;
+        node = next;
+      }
+  }
+
+  /*
+   * Returns the node for the time zone named `name`, or null if it isn't 
+   * loaded.
+   */
+  Node const*
+  find(
+    string const& name)
+    const
+  {
+    auto const& bucket = get_bucket(name);
+    for (Node const* node = bucket.load(std::memory_order_acquire);
+         node != nullptr;
+         node = node->next)
+      if (node->name == name)
+        return node;
+    return nullptr;
+  }
+
+  /*
+   * Returns the node for the time zone named `name`, loading it if necessary.
+   */
+  Node const&
+  get(
+    string const& name)
+  {
+    auto node = find(name);
+    if (node == nullptr) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // Another thread may have loaded it meanwhile.
+      node = find(name);
+      if (node == nullptr) {
+        size_t const id = size_.load(std::memory_order_relaxed);
+        if (id >= MAX_ZONES)
+          throw RuntimeError("too many time zones");
+        // Prefer the compiled database, if any, to zoneinfo files.
+        auto const db = get_time_zone_db();
+        auto const tz = 
+          db != nullptr && db->contains(name)
+          ? make_shared<TimeZone const>(
+              db->get_time_zone(name, (TimeZoneId) id))
+          : make_shared<TimeZone const>(
+              TzFile::load(find_time_zone_file(name)), name, (TimeZoneId) id);
+
+        zones_[id] = tz.get();
+        size_.store(id + 1, std::memory_order_release);
+
+        auto& bucket = get_bucket(name);
+        node = new Node{name, tz, bucket.load(std::memory_order_relaxed)};
+        bucket.store(node, std::memory_order_release);
+      }
+    }
+    return *node;
+  }
+
+  /*
+   * Returns the built-in UTC time zone.
+   */
+  TimeZone_ptr const& get_utc() const { return utc_; }
+
+  /*
+   * Returns the time zone with ID `id`, or null if there is none.
+   */
+  TimeZone const*
+  get(
+    TimeZoneId const id)
+    const
+  {
+    return id < size_.load(std::memory_order_acquire) ? zones_[id] : nullptr;
+  }
+
+private:
+
+  static size_t constexpr NUM_BUCKETS = 256;
+  static size_t constexpr MAX_ZONES = TIME_ZONE_ID_INVALID;
+  static TimeZoneId constexpr UTC_ID = 0;
+
+  std::atomic<Node const*>&
+  get_bucket(
+    string const& name)
+  {
+    return buckets_[std::hash<string>()(name) % NUM_BUCKETS];
+  }
+
+  std::atomic<Node const*> const&
+  get_bucket(
+    string const& name)
+    const
+  {
+    return buckets_[std::hash<string>()(name) % NUM_BUCKETS];
+  }
+
+  std::atomic<Node const*> buckets_[NUM_BUCKETS];
+  std::mutex mutex_;
+
+  // Time zones by ID.  The nodes own them.  Untouched pages of the array are
+  // never committed, so its size costs nothing.
+  std::atomic<size_t> size_{0};
+  TimeZone const* zones_[MAX_ZONES];
+
+  TimeZone_ptr utc_;
+
+};
+
+
+TimeZoneId constexpr
+Registry::UTC_ID;
+
+
+Registry&
+get_registry()
+{
+  static Registry registry;
+  return registry;
+}
 
-// Cache of loaded time zone objects.  
-//
-// Pointers in this cache should not be 
-std::map<string, TimeZone_ptr>
-time_zones;
 
 }  // anonymous namespace
 
 
+TimeZone_ptr const
+UTC 
+  = get_registry().get_utc();
+
+
 extern fs::Filename
 get_zoneinfo_dir()
 {
-  if (zoneinfo_dir == fs::Filename{""}) {
-    // Not initialized.  Try from the environment.
+  // Initialized once, from the environment if set.
+  static fs::Filename const zoneinfo_dir = [] () {
     char const* const env_val = getenv(ZONEINFO_ENVVAR);
-    zoneinfo_dir = 
-      env_val != nullptr ? fs::Filename(env_val) : ZONEINFO_DIR_DEFAULT;
-    time_zones.clear();
-  }
-
+    return env_val != nullptr ? fs::Filename(env_val) : ZONEINFO_DIR_DEFAULT;
+  }();
   return zoneinfo_dir;
 }
 
@@ -262,29 +1082,93 @@ find_time_zone_file(
 }
 
 
+namespace {
+
+/*
+ * Returns true if `filename` starts like a tz file.
+ */
+bool
+is_tz_file(
+  fs::Filename const& filename)
+{
+  std::ifstream file(filename.as_string(), std::ios::binary);
+  char magic[4];
+  return file.read(magic, sizeof(magic)) && memcmp(magic, "TZif", 4) == 0;
+}
+
+
+/*
+ * Appends to `names` the names of tz files under `dir`, prefixed by `prefix`.
+ */
+void
+find_time_zone_names(
+  fs::Filename const& dir,
+  string const& prefix,
+  std::vector<string>& names)
+{
+  DIR* const entries = opendir(dir);
+  if (entries == nullptr)
+    throw SystemError("opendir", string("can't read ") + dir);
+  while (struct dirent const* const entry = readdir(entries)) {
+    string const base = entry->d_name;
+    if (base == "." || base == "..")
+      continue;
+    auto const filename = dir / base;
+    if (check(filename, fs::EXISTS, fs::DIRECTORY))
+      find_time_zone_names(filename, prefix + base + "/", names);
+    else if (is_tz_file(filename))
+      names.push_back(prefix + base);
+  }
+  closedir(entries);
+}
+
+
+}  // anonymous namespace
+
+
+extern std::vector<string>
+get_time_zone_names(
+  fs::Filename const& zoneinfo_dir)
+{
+  std::vector<string> names;
+  find_time_zone_names(zoneinfo_dir, "", names);
+  return names;
+}
+
+
 extern TimeZone_ptr
 get_time_zone(
   std::string const& name)
 {
-  auto find = time_zones.find(name);
-  if (find != end(time_zones))
-    return find->second;
-  else {
-    auto const filename = find_time_zone_file(name);
-    // We can safely return a reference because we never remove or replace
-    // time zone objects from the cache map.
-    return time_zones[name] 
-      = make_shared<TimeZone const>(TzFile::load(filename), name);
-  }
+  return get_registry().get(name).tz;
+}
+
+
+extern TimeZoneId
+get_time_zone_id(
+  std::string const& name)
+{
+  return get_registry().get(name).tz->get_id();
+}
+
+
+extern TimeZone const&
+get_time_zone(
+  TimeZoneId const id)
+{
+  auto const tz = get_registry().get(id);
+  if (tz == nullptr)
+    throw ValueError("no time zone with ID " + std::to_string(id));
+  return *tz;
 }
 
 
-extern inline TimeZone
+extern TimeZone
 get_time_zone(
   std::string const& name,
   fs::Filename const& zoneinfo_dir)
 {
-  auto filename = find_time_zone_file(name);
+  auto filename = find_time_zone_file(name, zoneinfo_dir);
   return TimeZone(TzFile::load(filename), name);
 }
 
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "aslib/exc.hh"
+#include "aslib/file.hh"
+#include "aslib/filename.hh"
+#include "cron/time_zone.hh"
+#include "cron/tzdb.hh"
+#include "cron/tzfile.hh"
+#include "cron/tzrule.hh"
+
+namespace cron {
+
+using namespace aslib;
+
+using std::string;
+
+//------------------------------------------------------------------------------
+// Image layout
+//------------------------------------------------------------------------------
+
+/*
+ * The image starts with a header, followed by a zone record for each time
+ * zone, sorted by name.  Each record locates the time zone's arrays.  A string
+ * table of nul-terminated names and POSIX TZ rules comes last.  All offsets are
+ * from the start of the image, and all arrays are 8-byte aligned.
+ */
+struct TzDatabase::Header
+{
+  char magic[8];
+  uint32_t version;
+  // BYTE_ORDER_MARK, as written by the compiling machine.
+  uint32_t byte_order;
+  // Layout of the compiling machine's arrays.
+  uint32_t entry_size;
+  uint32_t parts_size;
+  uint32_t num_zones;
+  uint32_t reserved;
+  // Total size of the image.
+  uint64_t size;
+  uint64_t zones_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+};
+
+
+struct TzDatabase::ZoneRecord
+{
+  // Offsets into the string table.
+  uint64_t name_offset;
+  uint64_t rule_offset;
+  uint64_t types_offset;
+  uint64_t entries_offset;
+  uint64_t index_offset;
+  TimeOffset index_start;
+  uint32_t num_types;
+  uint32_t num_entries;
+  uint32_t num_index;
+  int32_t index_shift;
+};
+
+
+namespace {
+
+char constexpr
+MAGIC[8]
+  = {'c', 'r', 'o', 'n', 't', 'z', 'd', 'b'};
+
+uint32_t constexpr
+BYTE_ORDER_MARK
+  = 0x01020304;
+
+size_t constexpr
+ALIGNMENT
+  = 8;
+
+static_assert(
+  std::is_trivially_copyable<TimeZoneParts>::value,
+  "TimeZoneParts must be trivially copyable");
+
+
+/*
+ * A database image under construction.
+ */
+class Image
+{
+public:
+
+  /*
+   * Appends `size` zero bytes, aligned; returns their offset.
+   */
+  size_t
+  allocate(
+    size_t const size)
+  {
+    data_.resize((data_.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+    size_t const offset = data_.size();
+    data_.resize(offset + size, '\0');
+    return offset;
+  }
+
+  /*
+   * Appends `size` bytes from `src`, aligned; returns their offset.
+   */
+  size_t
+  append(
+    void const* const src,
+    size_t const size)
+  {
+    size_t const offset = allocate(size);
+    if (size > 0)
+      memcpy(&data_[offset], src, size);
+    return offset;
+  }
+
+  /*
+   * Copies `size` bytes from `src` to `offset` in the image.
+   */
+  void
+  write(
+    size_t const offset,
+    void const* const src,
+    size_t const size)
+  {
+    memcpy(&data_[offset], src, size);
+  }
+
+  size_t get_size() const { return data_.size(); }
+  string release() { return std::move(data_); }
+
+private:
+
+  string data_;
+
+};
+
+
+/*
+ * Checks that `length` bytes at `offset` lie within an image of `size` bytes,
+ * aligned.
+ */
+void
+check_region(
+  size_t const size,
+  uint64_t const offset,
+  uint64_t const length)
+{
+  if (offset % ALIGNMENT != 0 || offset > size || length > size - offset)
+    throw FormatError("invalid tz database offset");
+}
+
+
+}  // anonymous namespace
+
+
+//------------------------------------------------------------------------------
+// Class TzDatabase
+//------------------------------------------------------------------------------
+
+string
+TzDatabase::compile(
+  fs::Filename const& zoneinfo_dir,
+  std::vector<string> const& names,
+  std::vector<string>* const errors)
+{
+  using Entry = TimeZone::Entry;
+
+  // Records are sorted by name, for lookup.
+  std::vector<string> sorted = names;
+  std::sort(begin(sorted), end(sorted));
+  sorted.erase(std::unique(begin(sorted), end(sorted)), end(sorted));
+
+  // Load the time zones first, so that we know which to include.  Keep each
+  // with its TZ rule.
+  std::vector<std::pair<TimeZone, string>> zones;
+  zones.reserve(sorted.size());
+  for (auto const& name : sorted)
+    try {
+      auto const tz_file 
+        = TzFile::load(find_time_zone_file(name, zoneinfo_dir));
+      zones.emplace_back(TimeZone(tz_file, name), tz_file.future_);
+    }
+    catch (std::exception const& exc) {
+      if (errors == nullptr)
+        throw;
+      errors->push_back(name + ": " + exc.what());
+    }
+
+  // Build the string table as we go.  It starts with an empty string.
+  string strings(1, '\0');
+  auto const add_string = [&strings] (string const& str) {
+    size_t const offset = strings.size();
+    strings.append(str.c_str(), str.size() + 1);
+    return offset;
+  };
+
+  Image image;
+  size_t const header_offset = image.allocate(sizeof(Header));
+  size_t const zones_offset
+    = image.allocate(zones.size() * sizeof(ZoneRecord));
+
+  for (size_t z = 0; z < zones.size(); ++z) {
+    auto const& tz = zones[z].first;
+
+    ZoneRecord zone;
+    memset(&zone, 0, sizeof(zone));
+    zone.name_offset    = add_string(tz.get_name());
+    zone.rule_offset    = add_string(zones[z].second);
+    zone.num_types      = tz.types_.size();
+    zone.types_offset   = image.append(
+      tz.types_.cbegin(), tz.types_.size() * sizeof(TimeZoneParts));
+
+    // Copy entries field by field, so that padding is zero and the image is
+    // reproducible.
+    zone.num_entries    = tz.entries_.size();
+    zone.entries_offset = image.allocate(tz.entries_.size() * sizeof(Entry));
+    for (size_t i = 0; i < tz.entries_.size(); ++i) {
+      auto const& entry = tz.entries_[i];
+      size_t const offset = zone.entries_offset + i * sizeof(Entry);
+      image.write(
+        offset + offsetof(Entry, transition),
+        &entry.transition, sizeof(entry.transition));
+      image.write(
+        offset + offsetof(Entry, parts), &entry.parts, sizeof(entry.parts));
+      image.write(
+        offset + offsetof(Entry, type), &entry.type, sizeof(entry.type));
+    }
+
+    zone.index_start    = tz.index_start_;
+    zone.index_shift    = tz.index_shift_;
+    zone.num_index      = tz.index_.size();
+    zone.index_offset   = image.append(
+      tz.index_.cbegin(), tz.index_.size() * sizeof(uint32_t));
+
+    image.write(zones_offset + z * sizeof(ZoneRecord), &zone, sizeof(zone));
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version        = VERSION;
+  header.byte_order     = BYTE_ORDER_MARK;
+  header.entry_size     = sizeof(Entry);
+  header.parts_size     = sizeof(TimeZoneParts);
+  header.num_zones      = zones.size();
+  header.zones_offset   = zones_offset;
+  header.strings_offset = image.append(strings.data(), strings.size());
+  header.strings_size   = strings.size();
+  header.size           = image.get_size();
+  image.write(header_offset, &header, sizeof(header));
+
+  return image.release();
+}
+
+
+TzDatabase::TzDatabase(
+  fs::Filename const& filename)
+  : file_(std::make_shared<fs::MappedFile const>(filename))
+{
+  char const* const data = file_->get_data();
+  size_t const size = file_->get_size();
+
+  if (size < sizeof(Header) || memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    throw FormatError("not a tz database");
+  header_ = reinterpret_cast<Header const*>(data);
+  if (header_->version != VERSION)
+    throw FormatError("unsupported tz database version");
+  if (   header_->byte_order != BYTE_ORDER_MARK
+      || header_->entry_size != sizeof(TimeZone::Entry)
+      || header_->parts_size != sizeof(TimeZoneParts))
+    throw FormatError("tz database compiled for another machine");
+  if (header_->size != size)
+    throw FormatError("tz database wrong size");
+
+  // Check the layout up front, so that lookups needn't.
+  check_region(
+    size, header_->zones_offset, header_->num_zones * sizeof(ZoneRecord));
+  check_region(size, header_->strings_offset, header_->strings_size);
+  if (   header_->strings_size == 0
+      || data[header_->strings_offset + header_->strings_size - 1] != '\0')
+    throw FormatError("invalid tz database strings");
+  zones_ = reinterpret_cast<ZoneRecord const*>(data + header_->zones_offset);
+
+  for (size_t z = 0; z < header_->num_zones; ++z) {
+    auto const& zone = zones_[z];
+    if (   zone.name_offset >= header_->strings_size
+        || zone.rule_offset >= header_->strings_size
+        || zone.num_types == 0
+        || zone.num_types > 256
+        || zone.num_entries == 0
+        // Lookups shift by this much.
+        || zone.index_shift < 0
+        || zone.index_shift >= 64)
+      throw FormatError("invalid tz database zone");
+    check_region(
+      size, zone.types_offset, zone.num_types * sizeof(TimeZoneParts));
+    check_region(
+      size, zone.entries_offset, zone.num_entries * sizeof(TimeZone::Entry));
+    check_region(size, zone.index_offset, zone.num_index * sizeof(uint32_t));
+  }
+}
+
+
+std::vector<string>
+TzDatabase::get_names()
+  const
+{
+  std::vector<string> names;
+  names.reserve(header_->num_zones);
+  for (size_t z = 0; z < header_->num_zones; ++z)
+    names.emplace_back(get_string(zones_[z].name_offset));
+  return names;
+}
+
+
+bool
+TzDatabase::contains(
+  string const& name)
+  const
+{
+  return find(name) != nullptr;
+}
+
+
+TimeZone
+TzDatabase::get_time_zone(
+  string const& name,
+  TimeZoneId const id)
+  const
+{
+  using Entry = TimeZone::Entry;
+
+  auto const zone = find(name);
+  if (zone == nullptr)
+    throw ValueError(string("no time zone in database: ") + name);
+
+  char const* const data = file_->get_data();
+  TimeZone::Array<TimeZoneParts> const types(
+    reinterpret_cast<TimeZoneParts const*>(data + zone->types_offset),
+    zone->num_types);
+  TimeZone::Array<Entry> const entries(
+    reinterpret_cast<Entry const*>(data + zone->entries_offset),
+    zone->num_entries);
+  TimeZone::Array<uint32_t> const index(
+    reinterpret_cast<uint32_t const*>(data + zone->index_offset),
+    zone->num_index);
+
+  // The index is small; check it so that lookups stay in bounds.
+  for (size_t i = 0; i < index.size(); ++i)
+    if (index[i] >= entries.size())
+      throw FormatError("invalid tz database index");
+
+  // Lookups scan the entries in descending order, and hand out abbreviations
+  // as C strings.
+  auto const is_terminated = [] (TimeZoneParts const& parts) {
+    return
+      memchr(parts.abbreviation, '\0', sizeof(parts.abbreviation)) != nullptr;
+  };
+  for (size_t i = 0; i < types.size(); ++i)
+    if (! is_terminated(types[i]))
+      throw FormatError("invalid tz database type");
+  for (size_t i = 0; i < entries.size(); ++i)
+    if (   ! is_terminated(entries[i].parts)
+        || entries[i].type >= types.size()
+        || (i > 0 && entries[i - 1].transition < entries[i].transition))
+      throw FormatError("invalid tz database entry");
+
+  return TimeZone(
+    name, id, file_, types, entries,
+    zone->index_start, zone->index_shift, index,
+    TzRule(get_string(zone->rule_offset)));
+}
+
+
+TzDatabase::ZoneRecord const*
+TzDatabase::find(
+  string const& name)
+  const
+{
+  auto const end = zones_ + header_->num_zones;
+  auto const zone = std::lower_bound(
+    zones_, end, name,
+    [this] (ZoneRecord const& zone, string const& name) {
+      return strcmp(get_string(zone.name_offset), name.c_str()) < 0;
+    });
+  return
+    zone != end && name == get_string(zone->name_offset) ? zone : nullptr;
+}
+
+
+char const*
+TzDatabase::get_string(
+  uint64_t const offset)
+  const
+{
+  return file_->get_data() + header_->strings_offset + offset;
+}
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
+
@@ -6,6 +6,7 @@
 #define be64toh __builtin_bswap64
 #endif
 
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 
@@ -46,7 +47,7 @@ inline void
 Scanner::skip(
   size_t size)
 {
-  if (end_ < pos_ + size)
+  if ((size_t) (end_ - pos_) < size)
     throw FormatError("unexpected end of data");
   pos_ += size;
 }
@@ -56,9 +57,11 @@ template<typename T>
 inline T
 Scanner::next()
 {
-  if (end_ < pos_ + sizeof(T))
+  if ((size_t) (end_ - pos_) < sizeof(T))
     throw FormatError("unexpected end of data");
-  T const value = *reinterpret_cast<T const*>(pos_);
+  // The data need not be aligned.
+  T value;
+  memcpy(&value, pos_, sizeof(T));
   pos_ += sizeof(T);
   return swap(value);
 }
@@ -93,8 +96,10 @@ check_header(
       || scanner.next<char>() != 'i'
       || scanner.next<char>() != 'f')
     throw FormatError("not a tz file");
-  if (scanner.next<char>() != '2')
-    throw FormatError("not a tz file version 2");
+  // Version 3 differs only in extensions to the POSIX TZ string.
+  char const version = scanner.next<char>();
+  if (version != '2' && version != '3')
+    throw FormatError("not a tz file version 2 or 3");
   for (size_t i = 0; i < 15; ++i)
     if (scanner.next<char>() != 0)
       throw FormatError("tz file wrong padding");
@@ -115,8 +120,9 @@ TzFile
 TzFile::load(
   fs::Filename const& filename)
 {
-  string data = load_text(filename);
-  return TzFile(data.c_str(), data.length());
+  // Parse directly from the mapped file.
+  fs::MappedFile const file(filename);
+  return TzFile(file.get_data(), file.get_size());
 }
 
 
@@ -171,20 +177,26 @@ TzFile::TzFile(
     transitions_[i].type_index_ = type_index;
   }
 
-  // Compute the start of the abbreviation character block.
-  char const* abbreviations = scanner.get_position() +  6 * typecnt;
+  // Find the abbreviation character block, after the local time types.  The
+  // data need not be nul-terminated, so make sure the block is present.
+  Scanner types_scanner = scanner;
+  scanner.skip(6 * typecnt);
+  char const* const abbreviations = scanner.get_position();
+  scanner.skip(charcnt);
+
   // Get local time types.
   types_.resize(typecnt);
   for (size_t i = 0; i < typecnt; ++i) {
     Type& type = types_[i];
-    type.gmt_offset_ = scanner.next<int32_t>();
-    type.is_dst_ = scanner.next<int8_t>() != 0;
-    type.abbreviation_ = string(abbreviations + scanner.next<uint8_t>());
+    type.gmt_offset_ = types_scanner.next<int32_t>();
+    type.is_dst_ = types_scanner.next<int8_t>() != 0;
+    size_t const index = types_scanner.next<uint8_t>();
+    if (charcnt <= index)
+      throw FormatError("invalid abbreviation index");
+    type.abbreviation_ = string(
+      abbreviations + index, strnlen(abbreviations + index, charcnt - index));
   }
 
-  // Skip over the abbreviation block; we've already used it.
-  scanner.skip(charcnt);
-
   // Get leap seconds.
   leap_seconds_.resize(leapcnt);
   for (size_t i = 0; i < leapcnt; ++i) {
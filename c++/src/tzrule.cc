@@ -0,0 +1,267 @@
+#include <cassert>
+#include <cctype>
+#include <string>
+
+#include "aslib/exc.hh"
+#include "cron/date_math.hh"
+#include "cron/tzrule.hh"
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+using aslib::FormatError;
+using std::string;
+
+using namespace cron;
+
+/*
+ * Default transition time: 02:00:00 local time.
+ */
+int32_t constexpr
+DEFAULT_TIME
+  = 2 * 3600;
+
+class RuleScanner
+{
+public:
+
+  RuleScanner(string const& str) : str_(str), pos_(0) {}
+
+  bool is_empty() const { return pos_ == str_.length(); }
+  char peek() const { return is_empty() ? '\0' : str_[pos_]; }
+
+  bool
+  skip(
+    char const c)
+  {
+    if (peek() == c) {
+      ++pos_;
+      return true;
+    }
+    else
+      return false;
+  }
+
+  void
+  expect(
+    char const c)
+  {
+    if (! skip(c))
+      throw FormatError(string("expected '") + c + "' in TZ rule: " + str_);
+  }
+
+  string name();
+  unsigned number(unsigned max);
+  int32_t seconds(unsigned max_hours);
+  TzRule::Date date();
+
+private:
+
+  string const& str_;
+  size_t pos_;
+
+};
+
+
+/*
+ * Scans a time zone abbreviation, either alphabetic or in angle brackets.
+ * POSIX allows any character but '>' inside the brackets; zic's Factory zone
+ * relies on this.
+ */
+string
+RuleScanner::name()
+{
+  size_t const start = pos_;
+  if (skip('<')) {
+    while (pos_ < str_.length() && str_[pos_] != '>')
+      ++pos_;
+    string const name = str_.substr(start + 1, pos_ - start - 1);
+    expect('>');
+    if (name.length() < 3)
+      throw FormatError("invalid abbreviation in TZ rule: " + str_);
+    return name;
+  }
+  else {
+    while (isalpha(peek()))
+      ++pos_;
+    if (pos_ - start < 3)
+      throw FormatError("invalid abbreviation in TZ rule: " + str_);
+    return str_.substr(start, pos_ - start);
+  }
+}
+
+
+unsigned
+RuleScanner::number(
+  unsigned const max)
+{
+  if (! isdigit(peek()))
+    throw FormatError("expected number in TZ rule: " + str_);
+  unsigned value = 0;
+  while (isdigit(peek())) {
+    value = value * 10 + (str_[pos_++] - '0');
+    if (value > max)
+      throw FormatError("number out of range in TZ rule: " + str_);
+  }
+  return value;
+}
+
+
+/*
+ * Scans a signed [+-]hh[:mm[:ss]] duration, in seconds.
+ */
+int32_t
+RuleScanner::seconds(
+  unsigned const max_hours)
+{
+  bool const negative = skip('-');
+  if (! negative)
+    skip('+');
+  int32_t value = number(max_hours) * 3600;
+  if (skip(':')) {
+    value += number(59) * 60;
+    if (skip(':'))
+      value += number(59);
+  }
+  return negative ? -value : value;
+}
+
+
+TzRule::Date
+RuleScanner::date()
+{
+  TzRule::Date date{TzRule::Date::ORDINAL, 0, 0, 0, 0, DEFAULT_TIME};
+  if (skip('J')) {
+    date.kind = TzRule::Date::JULIAN;
+    date.day = number(365);
+    if (date.day < 1)
+      throw FormatError("invalid Julian day in TZ rule: " + str_);
+  }
+  else if (skip('M')) {
+    date.kind = TzRule::Date::MONTH_WEEK_DAY;
+    unsigned const month = number(12);
+    expect('.');
+    date.week = number(5);
+    expect('.');
+    // POSIX numbers weekdays from Sunday.
+    date.weekday = (number(6) + SUNDAY) % 7;
+    if (month < 1 || date.week < 1)
+      throw FormatError("invalid month or week in TZ rule: " + str_);
+    date.month = month - 1;
+  }
+  else
+    date.day = number(365);
+  if (skip('/'))
+    // Version 3 extends the range of the time.
+    date.time = seconds(167);
+  return date;
+}
+
+
+}  // anonymous namespace
+
+
+//------------------------------------------------------------------------------
+
+namespace cron {
+
+TimeOffset
+TzRule::Date::get_local(
+  Year const year)
+  const
+{
+  Datenum datenum;
+  switch (kind) {
+  case JULIAN:
+    // Feb 29 is never counted, so skip it.
+    datenum = jan1_datenum(year) + day - 1
+      + (is_leap_year(year) && day >= 60 ? 1 : 0);
+    break;
+
+  case ORDINAL:
+    datenum = jan1_datenum(year) + day;
+    break;
+
+  case MONTH_WEEK_DAY:
+    {
+      // Find the first matching weekday in the month, then advance by weeks,
+      // backing off if week 5 is past the end of the month.
+      Datenum const first = ymd_to_datenum(year, month, 0);
+      datenum = first + (weekday + 7 - get_weekday(first)) % 7 + 7 * (week - 1);
+      if (datenum >= first + days_per_month(year, month))
+        datenum -= 7;
+    }
+    break;
+
+  default:
+    assert(false);
+  }
+
+  return
+      ((TimeOffset) datenum - DATENUM_UNIX_EPOCH) * SECS_PER_DAY
+    + (TimeOffset) time;
+}
+
+
+TzRule::TzRule(
+  std::string const& str)
+  : empty_(str.empty()),
+    has_dst_(false),
+    std_{0, "UTC"},
+    dst_{0, "UTC"},
+    start_{},
+    end_{}
+{
+  if (empty_)
+    return;
+
+  RuleScanner scanner(str);
+  std_.abbreviation = scanner.name();
+  std_.offset = -scanner.seconds(24);
+
+  if (! scanner.is_empty()) {
+    has_dst_ = true;
+    dst_.abbreviation = scanner.name();
+    // DST is an hour ahead, unless specified otherwise.
+    dst_.offset =
+      scanner.is_empty() || scanner.peek() == ','
+      ? std_.offset + 3600
+      : -scanner.seconds(24);
+
+    if (scanner.skip(',')) {
+      start_ = scanner.date();
+      scanner.expect(',');
+      end_ = scanner.date();
+    }
+    else {
+      // No rule; use the US rule, as zic does.
+      start_ = {Date::MONTH_WEEK_DAY, 0, 2, 2, SUNDAY, DEFAULT_TIME};
+      end_ = {Date::MONTH_WEEK_DAY, 0, 10, 1, SUNDAY, DEFAULT_TIME};
+    }
+  }
+
+  if (! scanner.is_empty())
+    throw FormatError("unexpected text in TZ rule: " + str);
+}
+
+
+void
+TzRule::get_transitions(
+  Year const year,
+  TimeOffset& start,
+  TimeOffset& end)
+  const
+{
+  assert(has_dst_);
+  // DST starts at a standard local time, and ends at a DST local time.
+  start = start_.get_local(year) - std_.offset;
+  end = end_.get_local(year) - dst_.offset;
+}
+
+
+//------------------------------------------------------------------------------
+
+}  // namespace cron
+
+
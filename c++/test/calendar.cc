@@ -9,6 +9,55 @@ using namespace aslib;
 using namespace cron;
 using namespace cron::ez;
 
+namespace {
+
+/*
+ * Reference implementations that step one day at a time.
+ */
+
+Date
+step_shift(
+  Calendar const& cal,
+  Date date,
+  ssize_t shift)
+{
+  while (shift > 0)
+    if (cal.contains(++date))
+      shift--;
+  while (shift < 0)
+    if (cal.contains(--date))
+      shift++;
+  return date;
+}
+
+
+Date
+step_nearest(
+  Calendar const& cal,
+  Date date,
+  bool forward)
+{
+  while (!cal.contains(date))
+    date += forward ? 1 : -1;
+  return date;
+}
+
+
+ssize_t
+step_count(
+  Calendar const& cal,
+  Date date0,
+  Date date1)
+{
+  ssize_t count = 0;
+  for (; date0 < date1; ++date0)
+    count += cal.contains(date0);
+  return count;
+}
+
+
+}  // anonymous namespace
+
 //------------------------------------------------------------------------------
 // Class AllCalendar.
 
@@ -46,6 +95,20 @@ TEST(AllCalendar, contains1) {
   EXPECT_FALSE(cal.contains(Date16::MISSING));
 }
 
+TEST(AllCalendar, shift) {
+  AllCalendar const cal;
+  EXPECT_EQ(2013/JUL/16, 2013/JUL/11 + 5 * cal.DAY);
+  EXPECT_EQ(2012/JUL/12, 2013/JUL/11 - 364 * cal.DAY);
+  EXPECT_EQ(2013/JUL/11, 2013/JUL/11 >> cal);
+  EXPECT_EQ(365, cal.count(2013/JAN/ 1, 2014/JAN/ 1));
+  EXPECT_EQ(-365, cal.count(2014/JAN/ 1, 2013/JAN/ 1));
+  EXPECT_TRUE(cal.shift(Date::INVALID, 1).is_invalid());
+
+  // Copies have their own intervals.
+  auto const copy = std::make_shared<AllCalendar>(cal);
+  EXPECT_EQ(copy.get(), &copy->DAY.get_calendar());
+}
+
 //------------------------------------------------------------------------------
 // Class WeekdaysCalendar.
 
@@ -103,6 +166,46 @@ TEST(WeekdaysCalendar, shift) {
   EXPECT_THROW((1600/DEC/ 1 - 600000 * cal.DAY).is_invalid(), DateRangeError);
 }
 
+TEST(WeekdaysCalendar, weeks) {
+  for (auto const& weekdays : std::vector<std::vector<Weekday>>{
+         {MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY},
+         {SUNDAY, THURSDAY},
+         {SATURDAY},
+         {MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY, SATURDAY, SUNDAY}}) {
+    WeekdaysCalendar const cal(weekdays);
+    for (auto date = 2013/JUL/ 1; date < 2013/JUL/15; ++date) {
+      for (auto const shift : {-100, -8, -7, -6, -5, -2, -1, 0, 1, 2, 5, 6, 7, 8, 100})
+        EXPECT_EQ(step_shift(cal, date, shift), cal.shift(date, shift));
+      for (auto const days : {0, 1, 6, 7, 8, 13, 14, 100})
+        EXPECT_EQ(step_count(cal, date, date + days), cal.count(date, date + days));
+    }
+  }
+}
+
+/*
+ * A templated algorithm, which uses a concrete calendar without virtual calls.
+ */
+template<class CAL>
+size_t
+count_contained(
+  CAL const& cal,
+  std::vector<Date> const& dates)
+{
+  size_t count = 0;
+  for (auto const& date : dates)
+    count += cal.contains(date);
+  return count;
+}
+
+TEST(WeekdaysCalendar, template) {
+  WeekdaysCalendar const cal({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY});
+  std::vector<Date> dates;
+  for (auto date = 2013/JUL/ 1; date < 2013/AUG/ 1; ++date)
+    dates.push_back(date);
+  EXPECT_EQ(23u, count_contained(cal, dates));
+  EXPECT_EQ(23u, count_contained<Calendar>(cal, dates));
+}
+
 TEST(WeekdaysCalendar, nearest) {
   // Monday through Friday.
   WeekdaysCalendar const cal({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY});
@@ -122,6 +225,139 @@ TEST(WeekdaysCalendar, nearest) {
   EXPECT_EQ(2013/JUL/26, date);
 }
 
+//------------------------------------------------------------------------------
+// Class CalendarIndex.
+
+TEST(CalendarIndex, basic) {
+  // Ranges that are, and aren't, a multiple of the word size, with dense and
+  // sparse contents.
+  for (auto const size : {0, 1, 63, 64, 65, 640, 1000})
+    for (auto const period : {1, 2, 3, 7, 50, 129}) {
+      auto const min = 2000/JAN/ 1;
+      auto const max = min + size;
+      auto const pred = [=](Date date) { return (date - min) % period == 0; };
+      CalendarIndex const index(min, max, pred);
+      EXPECT_EQ(min, index.get_min());
+      EXPECT_EQ(max, index.get_max());
+      EXPECT_EQ((size_t) (size + period - 1) / period, index.get_count());
+
+      size_t rank = 0;
+      for (auto date = min; date < max; ++date) {
+        EXPECT_TRUE(index.covers(date));
+        EXPECT_EQ(pred(date), index.contains(date));
+        EXPECT_EQ(rank, index.rank(date));
+        if (pred(date)) {
+          EXPECT_EQ(date, index.select(rank));
+          ++rank;
+        }
+
+        auto next = date;
+        if (index.nearest(next, true))
+          EXPECT_EQ(min + ((date - min + period - 1) / period) * period, next);
+        else
+          EXPECT_EQ(max, next);
+        auto prev = date;
+        EXPECT_TRUE(index.nearest(prev, false));
+        EXPECT_EQ(min + ((date - min) / period) * period, prev);
+      }
+      EXPECT_EQ(rank, index.rank(max));
+      EXPECT_FALSE(index.covers(max));
+      EXPECT_FALSE(index.covers(min - 1));
+    }
+}
+
+TEST(CalendarIndex, set) {
+  auto const min = 2000/JAN/ 1;
+  CalendarIndex index(min, min + 300, [](Date) { return false; });
+  for (auto const i : {0, 299, 63, 64, 128, 127, 200})
+    index.set(min + i, true);
+  EXPECT_EQ(7u, index.get_count());
+  EXPECT_EQ(min + 127, index.select(3));
+  EXPECT_EQ(4u, index.rank(min + 128));
+  index.set(min + 127, false);
+  index.set(min + 127, false);
+  EXPECT_EQ(6u, index.get_count());
+  EXPECT_EQ(min + 128, index.select(3));
+  EXPECT_EQ(3u, index.rank(min + 128));
+  auto date = min + 299;
+  EXPECT_EQ(0, index.shift(date, -4));
+  EXPECT_EQ(min + 63, date);
+  EXPECT_EQ(2, index.shift(date, 6));
+  EXPECT_EQ(min + 299, date);
+}
+
+TEST(CalendarIndex, set_matches_build) {
+  // Setting and clearing dates one at a time gives the same index as building
+  // it with those dates.
+  auto const min = 2000/JAN/ 1;
+  size_t const size = 2000;
+  std::vector<bool> contained(size, false);
+  CalendarIndex index(min, min + size, [](Date) { return false; });
+  uint64_t x = 12345;
+  for (int step = 0; step < 3000; ++step) {
+    x = x * 6364136223846793005 + 1442695040888963407;
+    size_t const i = (x >> 33) % size;
+    // Mostly add, so the calendar fills up, with some removals.
+    bool const value = (x >> 20) % 4 != 0;
+    contained[i] = value;
+    index.set(min + i, value);
+
+    if (step % 250 == 0 || step == 2999) {
+      CalendarIndex const built(
+        min, min + size, [&](Date date) { return contained[date - min]; });
+      ASSERT_EQ(built.get_count(), index.get_count());
+      for (size_t k = 0; k < built.get_count(); ++k)
+        ASSERT_EQ(built.select(k), index.select(k));
+      for (size_t j = 0; j <= size; ++j)
+        ASSERT_EQ(built.rank(min + j), index.rank(min + j));
+    }
+  }
+}
+
+TEST(CalendarIndex, bits) {
+  // Edge cases, then pseudorandom words of varying density.
+  std::vector<uint64_t> words{
+    0, 1, 0x8000000000000000, ~(uint64_t) 0, 0x5555555555555555,
+    0x00ff00000000ff00};
+  uint64_t x = 88172645463325252;
+  for (int i = 0; i < 3000; ++i) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    words.push_back(i % 3 == 0 ? x : i % 3 == 1 ? x & (x >> 5) : x | (x >> 3));
+  }
+
+#ifdef CRON_CALENDAR_X86
+  __builtin_cpu_init();
+  bool const has_popcnt = __builtin_cpu_supports("popcnt");
+  bool const has_bmi2 = __builtin_cpu_supports("bmi2");
+#endif
+
+  for (auto const word : words) {
+    unsigned const count = CalendarIndex::popcount_portable(word);
+    ASSERT_EQ((unsigned) __builtin_popcountll(word), count);
+#ifdef CRON_CALENDAR_X86
+    if (has_popcnt) {
+      ASSERT_EQ(count, CalendarIndex::popcount_popcnt(word));
+    }
+#endif
+
+    // The set bit of each rank, by the slow way.
+    unsigned k = 0;
+    for (unsigned pos = 0; pos < 64; ++pos)
+      if (word >> pos & 1) {
+        ASSERT_EQ(pos, CalendarIndex::select_in_word_portable(word, k))
+          << std::hex << word << std::dec << " rank " << k;
+#ifdef CRON_CALENDAR_X86
+        if (has_bmi2) {
+          ASSERT_EQ(pos, CalendarIndex::select_in_word_bmi2(word, k));
+        }
+#endif
+        ++k;
+      }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Class HolidayCalendar.
 
@@ -132,6 +368,53 @@ TEST(HolidayCalendar, load) {
   EXPECT_FALSE(cal[2012/JUL/ 3]);
   EXPECT_TRUE (cal[2012/JUL/ 4]);
   EXPECT_FALSE(cal[2012/JUL/ 5]);
+  EXPECT_FALSE(cal[2009/DEC/31]);
+  EXPECT_FALSE(cal[2021/JAN/ 1]);
+}
+
+TEST(HolidayCalendar, shift) {
+  HolidayCalendar const cal = load_holiday_calendar(fs::Filename("holidays.cal"));
+  EXPECT_EQ(2012/JUL/ 4, 2012/JUL/ 3 + cal.DAY);
+  EXPECT_EQ(2012/SEP/ 3, 2012/JUL/ 4 + cal.DAY);
+  EXPECT_EQ(2012/MAY/28, 2012/JUL/ 4 - cal.DAY);
+  EXPECT_EQ(2012/JUL/ 4, cal.nearest(2012/JUL/ 4));
+  EXPECT_EQ(2012/SEP/ 3, cal.nearest(2012/JUL/ 5));
+  EXPECT_EQ(2012/JUL/ 4, cal.nearest(2012/JUL/ 5, false));
+
+  for (auto date = 2011/JAN/ 1; date < 2020/JAN/ 1; date += 17) {
+    for (auto const shift : {-9, -3, -1, 0, 1, 2, 5, 9})
+      EXPECT_EQ(step_shift(cal, date, shift), cal.shift(date, shift));
+    EXPECT_EQ(step_nearest(cal, date, true), cal.nearest(date, true));
+    EXPECT_EQ(step_nearest(cal, date, false), cal.nearest(date, false));
+    EXPECT_EQ(step_count(cal, date, 2020/DEC/31), cal.count(date, 2020/DEC/31));
+  }
+
+  // Dates outside the calendar's range aren't holidays.
+  EXPECT_EQ(11, cal.count(2009/JAN/ 1, 2011/JAN/ 1));
+  EXPECT_EQ(-11, cal.count(2011/JAN/ 1, 2009/JAN/ 1));
+  EXPECT_EQ(0, cal.count(2021/JAN/ 1, 2030/JAN/ 1));
+  EXPECT_THROW(cal.count(Date::INVALID, 2030/JAN/ 1), InvalidDateError);
+}
+
+TEST(HolidayCalendar, set) {
+  HolidayCalendar cal(2013/JAN/ 1, 2014/JAN/ 1);
+  EXPECT_EQ(0, cal.count(2013/JAN/ 1, 2014/JAN/ 1));
+  cal.add(2013/JUL/ 4);
+  cal.add(2013/DEC/25);
+  cal.add(2013/JAN/ 1);
+  cal.add(2013/DEC/25);
+  EXPECT_EQ(3, cal.count(2013/JAN/ 1, 2014/JAN/ 1));
+  EXPECT_EQ(2013/DEC/25, 2013/JUL/ 4 + cal.DAY);
+  EXPECT_EQ(2013/JAN/ 1, 2013/DEC/25 - 2 * cal.DAY);
+  cal.remove(2013/JUL/ 4);
+  cal.remove(2013/JUL/ 5);
+  EXPECT_EQ(2, cal.count(2013/JAN/ 1, 2014/JAN/ 1));
+  EXPECT_EQ(2013/DEC/25, 2013/JAN/ 1 + cal.DAY);
+  EXPECT_EQ(2013/DEC/25, cal.nearest(2013/JUL/ 4));
+  EXPECT_THROW(cal.add(2014/JAN/ 1), ValueError);
+
+  EXPECT_THROW(
+    HolidayCalendar(2013/JAN/ 1, 2014/JAN/ 1, {2012/DEC/25}), ValueError);
 }
 
 //------------------------------------------------------------------------------
@@ -148,5 +431,197 @@ TEST(WorkdayCalendar, contains) {
   EXPECT_TRUE (cal[2012/JUL/ 5]);
   EXPECT_TRUE (cal[2012/JUL/ 6]);
   EXPECT_FALSE(cal[2012/JUL/ 7]);  // Saturday
+  EXPECT_TRUE (cal[2009/DEC/31]);  // before the holiday calendar
+  EXPECT_FALSE(cal[2021/JAN/ 2]);  // Saturday, after the holiday calendar
+  EXPECT_TRUE (cal[2021/JAN/ 4]);
+}
+
+TEST(WorkdayCalendar, shift) {
+  WorkdayCalendar const cal(
+    {MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY},
+    fs::Filename("holidays.cal"));
+  EXPECT_EQ(2012/JUL/ 5, 2012/JUL/ 3 + cal.DAY);
+  EXPECT_EQ(2012/JUL/ 3, 2012/JUL/ 5 - cal.DAY);
+  EXPECT_EQ(2012/JUL/ 5, 2012/JUL/ 4 >> cal);
+  EXPECT_EQ(2012/JUL/ 3, 2012/JUL/ 4 << cal);
+  EXPECT_EQ(2, cal.count(2012/JUL/ 3, 2012/JUL/ 6));
+
+  // Across and beyond the range of the holiday calendar.
+  for (auto date = 2009/JUN/ 1; date < 2021/JUN/ 1; date += 13) {
+    for (auto const shift : {-600, -250, -20, -1, 0, 1, 3, 20, 250, 600})
+      EXPECT_EQ(step_shift(cal, date, shift), cal.shift(date, shift));
+    EXPECT_EQ(step_nearest(cal, date, true), cal.nearest(date, true));
+    EXPECT_EQ(step_nearest(cal, date, false), cal.nearest(date, false));
+    for (auto const& other : {2008/JAN/ 1, 2010/JAN/ 1, 2015/MAR/17, 2022/JAN/ 1})
+      EXPECT_EQ(
+        date < other ? step_count(cal, date, other) : -step_count(cal, other, date),
+        cal.count(date, other));
+  }
+
+  EXPECT_TRUE(cal.shift(Date::INVALID, 1).is_invalid());
+  EXPECT_TRUE(cal.nearest(Date::MISSING).is_missing());
+}
+
+TEST(WorkdayCalendar, arrays) {
+  WorkdayCalendar const workdays(
+    {MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY},
+    fs::Filename("holidays.cal"));
+  WeekdaysCalendar const weekdays({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY});
+
+  std::vector<Date> dates;
+  for (auto date = 2009/JUN/ 1; date < 2021/JUN/ 1; date += 5)
+    dates.push_back(date);
+  // Not sorted.
+  dates.push_back(2015/JUL/ 4);
+  dates.push_back(2021/JAN/ 1);
+  dates.push_back(2010/JAN/ 1);
+  dates.push_back(Date::INVALID);
+  dates.push_back(Date::MISSING);
+  auto const size = dates.size();
+
+  for (Calendar const* const cal : {(Calendar const*) &workdays, (Calendar const*) &weekdays}) {
+    std::unique_ptr<bool[]> contained(new bool[size]);
+    cal->contains(dates.data(), size - 2, contained.get());
+    for (size_t i = 0; i < size - 2; ++i)
+      EXPECT_EQ(cal->contains(dates[i]), contained[i]);
+
+    std::vector<Date> results(size);
+    for (auto const shift : {-300, -1, 0, 1, 5, 300}) {
+      cal->shift(dates.data(), size, shift, results.data());
+      for (size_t i = 0; i < size - 2; ++i)
+        EXPECT_EQ(cal->shift(dates[i], shift), results[i]);
+      EXPECT_TRUE(results[size - 2].is_invalid());
+      EXPECT_TRUE(results[size - 1].is_missing());
+    }
+
+    for (auto const forward : {false, true}) {
+      cal->nearest(dates.data(), size, forward, results.data());
+      for (size_t i = 0; i < size - 2; ++i)
+        EXPECT_EQ(cal->nearest(dates[i], forward), results[i]);
+      EXPECT_TRUE(results[size - 2].is_invalid());
+      EXPECT_TRUE(results[size - 1].is_missing());
+    }
+
+    // Count over spans of various lengths and directions.
+    std::vector<Date> ends;
+    for (size_t i = 0; i < size - 2; ++i)
+      ends.push_back(dates[i] + ((ssize_t) (i * 37 % 1200) - 400));
+    std::vector<ssize_t> counts(size - 2);
+    cal->count(dates.data(), ends.data(), size - 2, counts.data());
+    for (size_t i = 0; i < size - 2; ++i)
+      EXPECT_EQ(cal->count(dates[i], ends[i]), counts[i]);
+    EXPECT_THROW(
+      cal->count(dates.data(), dates.data(), size, counts.data()),
+      InvalidDateError);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Class CompositeCalendar.
+
+TEST(CompositeCalendar, ops) {
+  Calendar_ptr const us = std::make_shared<WorkdayCalendar const>(
+    std::vector<Weekday>{MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY},
+    fs::Filename("holidays.cal"));
+  // Some other holidays, over a shorter range.
+  Calendar_ptr const other = std::make_shared<WorkdayCalendar const>(
+    WeekdaysCalendar({MONDAY, TUESDAY, WEDNESDAY, THURSDAY, FRIDAY}),
+    HolidayCalendar(
+      2012/JAN/ 1, 2014/JAN/ 1,
+      {2012/JAN/ 2, 2012/APR/ 6, 2012/DEC/25, 2013/JAN/ 1, 2013/MAY/ 6}));
+  Calendar_ptr const sundays
+    = std::make_shared<WeekdaysCalendar const>(std::vector<Weekday>{SUNDAY});
+
+  auto const both = get_intersection_calendar(us, other);
+  auto const either = get_union_calendar(us, other);
+  auto const only = get_difference_calendar(us, other);
+  auto const any = get_union_calendar(either, sundays);
+  EXPECT_EQ(2012/JAN/ 1, both->get_min());
+  EXPECT_EQ(2014/JAN/ 1, both->get_max());
+  EXPECT_EQ(2012/JAN/ 1, any->get_min());
+
+  for (auto date = 2011/JUN/ 1; date < 2014/JUN/ 1; ++date) {
+    auto const a = us->contains(date);
+    auto const b = other->contains(date);
+    EXPECT_EQ(a && b, both->contains(date));
+    EXPECT_EQ(a || b, either->contains(date));
+    EXPECT_EQ(a && !b, only->contains(date));
+    EXPECT_EQ(a || b || date.get_weekday() == SUNDAY, any->contains(date));
+  }
+
+  EXPECT_EQ(2012/APR/ 9, 2012/APR/ 6 >> *both);
+  EXPECT_EQ(2012/APR/ 6, 2012/APR/ 6 >> *either);
+  EXPECT_EQ(2012/APR/ 9, 2012/APR/ 5 + both->DAY);
+  EXPECT_EQ(2012/APR/ 6, 2012/APR/ 5 + either->DAY);
+  EXPECT_EQ(2012/APR/ 6, 2012/JAN/ 1 >> *only);
+
+  // Only the other calendar's holidays that are US workdays.
+  EXPECT_EQ(2, only->count(2011/JAN/ 1, 2015/JAN/ 1));
+  Date const dates[] = {2012/APR/ 6, 2012/APR/ 7, 2013/JAN/ 1, 2014/JAN/ 1};
+  bool contained[4];
+  only->contains(dates, 4, contained);
+  EXPECT_TRUE (contained[0]);
+  EXPECT_FALSE(contained[1]);
+  EXPECT_FALSE(contained[2]);
+  EXPECT_FALSE(contained[3]);
+  Date shifted[3];
+  only->shift(dates, 3, 1, shifted);
+  EXPECT_EQ(2013/MAY/ 6, shifted[0]);
+  EXPECT_EQ(2013/MAY/ 6, shifted[1]);
+  EXPECT_EQ(2013/MAY/ 6, shifted[2]);
+  EXPECT_EQ(2013/MAY/ 6, 2012/APR/ 6 + only->DAY);
+  EXPECT_EQ(2012/APR/ 6, 2013/MAY/ 6 - only->DAY);
+  EXPECT_EQ(2012/APR/ 6, 2012/DEC/24 << *only);
+
+  // Across and beyond the common range.
+  for (auto const& cal : {both, either, any})
+    for (auto date = 2011/JUN/ 1; date < 2014/JAN/20; date += 11) {
+      for (auto const shift : {-300, -20, -1, 0, 1, 20, 300})
+        EXPECT_EQ(step_shift(*cal, date, shift), cal->shift(date, shift));
+      EXPECT_EQ(step_nearest(*cal, date, true), cal->nearest(date, true));
+      EXPECT_EQ(step_nearest(*cal, date, false), cal->nearest(date, false));
+      EXPECT_EQ(step_count(*cal, date, 2014/FEB/ 1), cal->count(date, 2014/FEB/ 1));
+      EXPECT_EQ(-step_count(*cal, 2011/FEB/ 1, date), cal->count(date, 2011/FEB/ 1));
+    }
+}
+
+TEST(CompositeCalendar, cache) {
+  Calendar_ptr const cal0 = std::make_shared<WeekdaysCalendar const>(
+    std::vector<Weekday>{MONDAY, TUESDAY, WEDNESDAY, THURSDAY});
+  Calendar_ptr const cal1 = std::make_shared<HolidayCalendar const>(
+    2013/JAN/ 1, 2014/JAN/ 1, std::vector<Date>{2013/JUL/ 4});
+
+  EXPECT_EQ(get_union_calendar(cal0, cal1), get_union_calendar(cal0, cal1));
+  EXPECT_EQ(get_union_calendar(cal0, cal1), get_union_calendar(cal1, cal0));
+  EXPECT_EQ(
+    get_intersection_calendar(cal0, cal1), get_intersection_calendar(cal1, cal0));
+  EXPECT_NE(
+    get_difference_calendar(cal0, cal1), get_difference_calendar(cal1, cal0));
+  EXPECT_NE(get_union_calendar(cal0, cal1), get_intersection_calendar(cal0, cal1));
+
+  EXPECT_TRUE (get_intersection_calendar(cal0, cal1)->contains(2013/JUL/ 4));
+  EXPECT_FALSE(get_difference_calendar(cal0, cal1)->contains(2013/JUL/ 4));
+  EXPECT_TRUE (get_difference_calendar(cal0, cal1)->contains(2014/JUL/ 7));
+  EXPECT_THROW(get_union_calendar(cal0, nullptr), ValueError);
+}
+
+TEST(CompositeCalendar, cache_lifetime) {
+  auto cal0 = std::make_shared<WeekdaysCalendar const>(
+    std::vector<Weekday>{MONDAY, TUESDAY});
+  auto cal1 = std::make_shared<WeekdaysCalendar const>(
+    std::vector<Weekday>{TUESDAY, WEDNESDAY});
+  std::weak_ptr<Calendar const> const weak0 = cal0;
+  std::weak_ptr<Calendar const> const weak1 = cal1;
+
+  auto cal = get_union_calendar(std::move(cal0), std::move(cal1));
+  std::weak_ptr<Calendar const> const weak = cal;
+  EXPECT_TRUE(cal->contains(2016/MAR/ 2));
+  EXPECT_FALSE(weak0.expired());
+
+  // Once the caller releases the composite, it and its calendars are freed.
+  cal.reset();
+  EXPECT_TRUE(weak.expired());
+  EXPECT_TRUE(weak0.expired());
+  EXPECT_TRUE(weak1.expired());
 }
 
@@ -1,8 +1,10 @@
 #include <string>
+#include <vector>
 
 #include "cron/date.hh"
 #include "cron/ez.hh"
 #include "cron/format.hh"
+#include "../src/date_math_batch.hh"
 #include "gtest/gtest.h"
 
 using namespace aslib;
@@ -112,6 +114,44 @@ TEST(Date, range_error) {
   EXPECT_THROW(Date::MAX  + 1000000, DateRangeError);
 }
 
+TEST(Date, error_code) {
+  ErrorCode error = ErrorCode::INVALID_TIME;
+  EXPECT_EQ(Date(2016/JUL/4), Date::from_ymd(2016, 6, 3, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_TRUE(Date::from_ymd(2016, 12, 3, error).is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+  EXPECT_TRUE(Date::from_ymd(DateParts{2015, 1, 28}, error).is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+
+  EXPECT_EQ(Date(2016/JUL/4), Date::from_datenum(736148, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_TRUE(Date::from_datenum(DATENUM_INVALID, error).is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+
+  EXPECT_EQ(Date(2016/JUL/4), Date::from_ymdi(20160704, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_TRUE(Date::from_ymdi(20160732, error).is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+
+  EXPECT_EQ(Date(2016/JUL/4), Date::from_week_date(2016, 26, MONDAY, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_TRUE(Date::from_week_date(2016, 52, MONDAY, error).is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+
+  EXPECT_EQ(Date(2016/JUL/4), Date::from_ordinal_date(2016, 185, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+
+  // Valid, but out of range.
+  EXPECT_TRUE(Date16::from_ymd(1969, 11, 30, error).is_invalid());
+  EXPECT_EQ(ErrorCode::DATE_RANGE, error);
+  EXPECT_TRUE(Date16::from_offset(Date16::MAX.get_offset() + 1, error).is_invalid());
+  EXPECT_EQ(ErrorCode::DATE_RANGE, error);
+  EXPECT_EQ(Date16::MAX, Date16::from_offset(Date16::MAX.get_offset(), error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+
+  EXPECT_THROW(throw_error(ErrorCode::DATE_RANGE), DateRangeError);
+}
+
 TEST(Date, invalid_parts) {
   EXPECT_THROW(Date::INVALID.get_parts(), InvalidDateError);
   EXPECT_THROW(Date::INVALID.get_datenum(), InvalidDateError);
@@ -219,6 +259,119 @@ TEST(Date16, from_ymd) {
   EXPECT_EQ(2,      parts1.day);
 }
 
+//------------------------------------------------------------------------------
+// Date math functions
+//------------------------------------------------------------------------------
+
+TEST(date_math, datenum_to_ymd) {
+  // Walk every date, counting calendar parts alongside.
+  Year year = 1;
+  Month month = 0;
+  Day day = 0;
+  Ordinal ordinal = 0;
+  for (Datenum datenum = DATENUM_MIN; datenum <= DATENUM_MAX; ++datenum) {
+    auto const ymd = datenum_to_ymd(datenum);
+    ASSERT_EQ(year, ymd.year);
+    ASSERT_EQ(month, ymd.month);
+    ASSERT_EQ(day, ymd.day);
+
+    auto const ord = datenum_to_ordinal_date(datenum);
+    ASSERT_EQ(year, ord.year);
+    ASSERT_EQ(ordinal, ord.ordinal);
+
+    auto const ymd1 = datenum_to_ymd(datenum, ord);
+    ASSERT_EQ(year, ymd1.year);
+    ASSERT_EQ(month, ymd1.month);
+    ASSERT_EQ(day, ymd1.day);
+
+    ASSERT_EQ(datenum, ymd_to_datenum(year, month, day));
+
+    // Advance to the next date.
+    ++ordinal;
+    if (++day == days_per_month(year, month)) {
+      day = 0;
+      if (++month == MONTH_BOUND) {
+        month = 0;
+        ordinal = 0;
+        ++year;
+      }
+    }
+  }
+
+  // Invalid datenums give invalid parts.
+  for (auto const datenum : {DATENUM_BOUND, DATENUM_BOUND + 1000, DATENUM_INVALID})
+    EXPECT_EQ(YEAR_INVALID, datenum_to_ymd(datenum).year);
+}
+
+TEST(date_math, datenum_to_ymd_batch) {
+  // All valid datenums, a few invalid ones, and an odd count to exercise the
+  // scalar tail.
+  std::vector<Datenum> datenums;
+  for (Datenum datenum = DATENUM_MIN; datenum <= DATENUM_MAX; ++datenum)
+    datenums.push_back(datenum);
+  for (auto const datenum : {DATENUM_BOUND, DATENUM_INVALID, 1u << 31, 12345u})
+    datenums.push_back(datenum);
+  ASSERT_EQ(1u, datenums.size() % 2);
+
+  // Check each kernel the CPU supports, as well as the dispatch.
+  std::vector<DateMathKernel> kernels{
+    {"dispatch", true, datenum_to_ymd, ymd_to_datenum}};
+  for (auto const& kernel : get_date_math_kernels())
+    if (kernel.supported)
+      kernels.push_back(kernel);
+  ASSERT_STREQ("scalar", kernels[1].name);
+
+  for (auto const& kernel : kernels) {
+    SCOPED_TRACE(kernel.name);
+    std::vector<YmdDate> ymds(datenums.size());
+    kernel.datenum_to_ymd(datenums.data(), datenums.size(), ymds.data());
+    for (size_t i = 0; i < datenums.size(); ++i) {
+      auto const datenum = datenums[i];
+      auto const ymd =
+        datenum_is_valid(datenum) ? datenum_to_ymd(datenum)
+        : YmdDate::get_invalid();
+      ASSERT_EQ(ymd.year, ymds[i].year);
+      ASSERT_EQ(ymd.month, ymds[i].month);
+      ASSERT_EQ(ymd.day, ymds[i].day);
+    }
+
+    // The round trip.
+    std::vector<Datenum> datenums1(datenums.size());
+    kernel.ymd_to_datenum(ymds.data(), ymds.size(), datenums1.data());
+    for (size_t i = 0; i < datenums.size(); ++i)
+      ASSERT_EQ(
+        datenum_is_valid(datenums[i]) ? datenums[i] : DATENUM_INVALID,
+        datenums1[i]);
+  }
+}
+
+TEST(date_math, ymd_to_datenum_batch) {
+  // Every combination of parts, valid or not, near the valid ranges.
+  std::vector<YmdDate> ymds;
+  for (int year = YEAR_MIN - 2; year <= YEAR_MAX + 2; ++year)
+    for (int month = 0; month <= MONTH_BOUND; ++month)
+      for (int day = 0; day <= DAY_BOUND; ++day)
+        ymds.push_back({(Year) year, (Month) month, (Day) day});
+  ymds.push_back(YmdDate::get_invalid());
+
+  for (auto const& kernel : get_date_math_kernels()) {
+    if (! kernel.supported)
+      continue;
+    SCOPED_TRACE(kernel.name);
+    std::vector<Datenum> datenums(ymds.size());
+    kernel.ymd_to_datenum(ymds.data(), ymds.size(), datenums.data());
+    for (size_t i = 0; i < ymds.size(); ++i) {
+      auto const& ymd = ymds[i];
+      ASSERT_EQ(
+        ymd_is_valid(ymd.year, ymd.month, ymd.day)
+        ? ymd_to_datenum(ymd.year, ymd.month, ymd.day)
+        : DATENUM_INVALID,
+        datenums[i])
+        << ymd.year << '-' << (int) ymd.month << '-' << (int) ymd.day;
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 // Easy literals.
 
@@ -1,4 +1,5 @@
 #include "cron/ez.hh"
+#include "cron/fixed_format.hh"
 #include "cron/format.hh"
 #include "gtest/gtest.h"
 
@@ -20,6 +21,22 @@ TEST(TimeFormat, basic) {
   EXPECT_THROW(TimeFormat("foo %c")(time), TimeFormatError);
 }
 
+TEST(TimeFormat, time_zone_id) {
+  Time const time = Time::from_offset(4262126704878682112l);
+  auto const tz_id = get_time_zone_id("US/Eastern");
+  TimeFormat const format("%Y-%m-%d %H:%M:%S %~Z");
+  EXPECT_EQ("2013-07-28 15:37:38 EDT", format(time, tz_id));
+  EXPECT_EQ("2013-07-28 15:37:38 EDT", format(time, "US/Eastern"));
+  EXPECT_EQ("2013-07-28 15:37:38 EDT", format(time.get_id_parts(tz_id)));
+
+  // UTC has an ID too.
+  EXPECT_EQ("2013-07-28 19:37:38 UTC", format(time.get_id_parts(*UTC)));
+
+  // A time zone from outside the registry has none.
+  auto const tz = get_time_zone("US/Eastern", get_zoneinfo_dir());
+  EXPECT_THROW(format(time.get_id_parts(tz)), ValueError);
+}
+
 TEST(TimeFormat, invalid) {
   // FIXME
 }
@@ -140,6 +157,26 @@ TEST(TimeFormat, str_case) {
   EXPECT_EQ("2 = Tuesday",      TimeFormat("%0w = %W")(time));
 }
 
+TEST(TimeFormat, pattern) {
+  auto const tz = get_time_zone("US/Eastern");
+  Time const time(2013/JAN/1, Daytime(6, 7, 8.01234), *tz);
+  EXPECT_EQ("",                 TimeFormat("")(time, *tz));
+  EXPECT_EQ("no escapes",       TimeFormat("no escapes")(time, *tz));
+  EXPECT_EQ("100% at 06%",      TimeFormat("100%% at %H%%")(time, *tz));
+  EXPECT_EQ("%%",               TimeFormat("%%%%")(time, *tz));
+  EXPECT_EQ("[06][07]",         TimeFormat("[%H][%M]")(time, *tz));
+
+  // Errors in the pattern are raised when formatting.
+  TimeFormat const unterminated(std::string("%Y-%"));
+  EXPECT_THROW(unterminated(time, *tz), ValueError);
+  TimeFormat const decimal(std::string("%.3.3S"));
+  EXPECT_THROW(decimal(time, *tz), ValueError);
+  TimeFormat const unknown(std::string("%Y %!"));
+  EXPECT_THROW(unknown(time, *tz), TimeFormatError);
+  TimeFormat const alternative(std::string("%EY"));
+  EXPECT_THROW(alternative(time, *tz), TimeFormatError);
+}
+
 TEST(TimeFormat, display_time_zone) {
   auto const tz = get_time_zone("US/Eastern");
   Time const time(2013/JUL/28, Daytime(15, 37, 38.0), *tz);
@@ -177,6 +214,117 @@ TEST(TimeFormat, iso_invalid) {
   EXPECT_EQ("MISSING                  ",    TimeFormat::ISO_ZONE_EXTENDED(Time::MISSING));
 }
 
+TEST(TimeFormat, format_to) {
+  auto const tz = get_time_zone("US/Eastern");
+  Time const time(2013/JUL/28, Daytime(15, 37, 38.0), *tz);
+  auto const& format = TimeFormat::ISO_ZONE_EXTENDED;
+
+  char buf[32];
+  EXPECT_EQ(25u, format.format_to(buf, sizeof(buf), time, *tz));
+  EXPECT_EQ("2013-07-28T15:37:38-04:00", string(buf, 25));
+  EXPECT_EQ(25u, format.format_to(buf, sizeof(buf), Time::MISSING, *tz));
+  EXPECT_EQ(format.get_missing(), string(buf, 25));
+
+  // Truncated.
+  memset(buf, '#', sizeof(buf));
+  EXPECT_EQ(25u, format.format_to(buf, 10, time, *tz));
+  EXPECT_EQ("2013-07-28##", string(buf, 12));
+
+  StringBuilder sb;
+  sb << "at ";
+  format.format_to(sb, time, *tz);
+  sb << ' ';
+  format.format_to(sb, Time::INVALID, *tz);
+  EXPECT_EQ("at 2013-07-28T15:37:38-04:00 " + format.get_invalid(), sb.str());
+}
+
+TEST(TimeFormat, max_width) {
+  EXPECT_EQ(20u, TimeFormat::ISO_UTC_EXTENDED.get_max_width());
+  EXPECT_EQ(25u, TimeFormat::ISO_ZONE_EXTENDED.get_max_width());
+  EXPECT_EQ(26u, TimeFormat::get_default().get_max_width());
+  EXPECT_EQ(36u, TimeFormat("%W, %b %d, %Y %~Z").get_max_width());
+  EXPECT_EQ(15u, TimeFormat("%8Y %o").get_max_width());
+  EXPECT_EQ(10u, DateFormat::ISO_CALENDAR_EXTENDED.get_max_width());
+  EXPECT_EQ(18u, DaytimeFormat::ISO_EXTENDED_NSEC.get_max_width());
+  // The invalid representation is wider.
+  EXPECT_EQ(7u, DateFormat("%y", "INVALID", "MISSING").get_max_width());
+
+  // Every output fits.
+  auto const tz = get_time_zone("America/New_York");
+  TimeFormat const format("%W %b %~Z %h %p %.9S");
+  for (auto const& date : {2013/SEP/25, 2013/MAY/1, 2016/DEC/31})
+    for (auto const& daytime : {Daytime::MIN, Daytime(12, 0, 59.9999999999)}) {
+      Time const time(date, daytime, *tz);
+      EXPECT_LE(format(time, *tz).length(), format.get_max_width());
+    }
+}
+
+//------------------------------------------------------------------------------
+// Class TimeFormatter
+//------------------------------------------------------------------------------
+
+TEST(TimeFormatter, sequential) {
+  auto const tz = get_time_zone("America/New_York");
+  // Across the start of DST, at 2016-03-13 07:00 UTC.
+  auto const start = NsecTime(2016/MAR/13, Daytime(1, 58, 0), *tz);
+  for (auto const pattern : {
+         "%Y-%m-%d %H:%M:%.9S %~Z",
+         "%H:%M:%S%U%Q:%q (%~Z) on %d %~b",
+         "%H%M",
+         "%.3S.%k%K%l"}) {
+    TimeFormat const format(pattern);
+    TimeFormatter formatter(format, tz);
+    // Steps of 0.3 sec.
+    for (int i = 0; i < 1000; ++i) {
+      auto const time = NsecTime::from_offset(
+        start.get_offset() + (NsecTime::Offset) i * NsecTime::DENOMINATOR * 3 / 10);
+      EXPECT_EQ(format(time, *tz), formatter(time));
+    }
+    // About one miss per minute.
+    EXPECT_LE(formatter.get_misses(), 7u);
+    EXPECT_EQ(1000u, formatter.get_hits() + formatter.get_misses());
+  }
+}
+
+TEST(TimeFormatter, jumps) {
+  auto const tz = get_time_zone("Europe/London");
+  TimeFormat const format("%Y-%m-%d %H:%M:%S %~Z");
+  TimeFormatter formatter(format, "Europe/London");
+  for (auto const offset : {1000000000l, 1000000059l, 1000000060l, 999999999l,
+                            1477789200l, 1477789199l, 1477789200l, 1477785600l,
+                            1400000000l, 1400000001l}) {
+    auto const time = Unix64Time::from_offset(offset);
+    EXPECT_EQ(format(time, *tz), formatter(time));
+  }
+
+  char buf[32];
+  auto const time = Unix64Time::from_offset(1000000000l);
+  EXPECT_EQ(23u, formatter.format_to(buf, sizeof(buf), time));
+  EXPECT_EQ("2001-09-09 02:46:40 BST", string(buf, 23));
+  EXPECT_EQ(format.get_invalid(), formatter(Unix64Time::INVALID));
+  EXPECT_EQ(format.get_missing(), formatter(Unix64Time::MISSING));
+}
+
+TEST(TimeFormatter, time_types) {
+  // Time types with different bases share the cached minute.
+  TimeFormat const format("%Y-%m-%d %H:%M:%S");
+  TimeFormatter formatter(format, UTC);
+  Time const time = Time::from_offset(
+    (Time::Offset) 26000000 * SECS_PER_MIN * Time::DENOMINATOR);
+  auto const unix_time = Unix64Time::from_offset(26000000l * SECS_PER_MIN);
+  EXPECT_EQ("2019-06-08 13:20:00", format(unix_time, *UTC));
+  EXPECT_EQ(format(time, *UTC), formatter(time));
+  EXPECT_EQ(format(unix_time, *UTC), formatter(unix_time));
+  EXPECT_EQ(format(time, *UTC), formatter(time));
+
+  auto const nsec_time = NsecTime(2019/JUN/ 8, Daytime(13, 20, 30), *UTC);
+  auto const small_time = SmallTime(nsec_time);
+  EXPECT_EQ("2019-06-08 13:20:30", formatter(nsec_time));
+  EXPECT_EQ("2019-06-08 13:20:30", formatter(small_time));
+  EXPECT_EQ("2019-06-08 13:20:30", formatter(Unix64Time(nsec_time)));
+  EXPECT_EQ(2u, formatter.get_hits());
+}
+
 //------------------------------------------------------------------------------
 // Class DateFormat
 //------------------------------------------------------------------------------
@@ -205,6 +353,27 @@ TEST(DateFormat, iso_special) {
   EXPECT_EQ("MISSING   ", DateFormat::ISO_CALENDAR_EXTENDED(Date::MISSING));
 }
 
+TEST(DateFormat, format_to) {
+  auto const& format = DateFormat::ISO_CALENDAR_EXTENDED;
+  char buf[10];
+  EXPECT_EQ(10u, format.format_to(buf, sizeof(buf), 2013/AUG/7));
+  EXPECT_EQ("2013-08-07", string(buf, 10));
+  EXPECT_EQ(10u, format.format_to(buf, sizeof(buf), Date16::INVALID));
+  EXPECT_EQ("INVALID   ", string(buf, 10));
+
+  StringBuilder sb;
+  format.format_to(sb, 2013/AUG/7);
+  EXPECT_EQ("2013-08-07", sb.str());
+
+  // Stays in a buffer narrower than the widest string, if the result fits.
+  DateFormat const names("%W %b %d");
+  char small[20];
+  StringBuilder small_sb(small, sizeof(small));
+  names.format_to(small_sb, 2013/MAY/7);
+  EXPECT_EQ(small, small_sb.data());
+  EXPECT_EQ("Tuesday May 07", small_sb.str());
+}
+
 TEST(DateFormat, iso_invalid) {
   EXPECT_EQ("INVALID ",   DateFormat::ISO_CALENDAR_BASIC(Date::INVALID));
   EXPECT_EQ("MISSING   ", DateFormat::ISO_CALENDAR_EXTENDED(Date::MISSING));
@@ -242,3 +411,126 @@ TEST(DaytimeFormat, iso_invalid) {
   EXPECT_EQ("INVALID           ",   DaytimeFormat::ISO_EXTENDED_NSEC(Daytime::INVALID));
 }
 
+TEST(DaytimeFormat, subsecond_exact) {
+  // The fraction is 265311839123 / 2^47 sec, or 0.00188515399999...; in
+  // floating point, its nanoseconds round up.
+  auto const daytime = Daytime::from_offset(6375267750319842195ull);
+  EXPECT_EQ("12:34:59.001885153", DaytimeFormat("%H:%M:%S.%k%K%l")(daytime));
+  EXPECT_EQ("12:34:59.001885154", DaytimeFormat("%H:%M:%.9S")(daytime));
+  EXPECT_EQ("12:34:59.00189",     DaytimeFormat("%H:%M:%.5S")(daytime));
+  EXPECT_EQ("12:34:59.0",         DaytimeFormat("%H:%M:%.1S")(daytime));
+
+  // Rounding carries into seconds, as before.
+  // One tick before 23:59:59.
+  auto const late = Daytime::from_offset(
+    ((Daytime::Offset) SECS_PER_DAY - 1) * Daytime::DENOMINATOR - 1);
+  EXPECT_EQ("23:59 999",    DaytimeFormat("%H:%M %k")(late));
+  EXPECT_EQ("23:59:59.000", DaytimeFormat("%H:%M:%.3S")(late));
+}
+
+TEST(TimeFormat, subsecond_exact) {
+  // One tick, 2^-30 sec, before and after a second.
+  auto const base = NsecTime::from_offset(
+    (NsecTime::Offset) 1500000000 * NsecTime::DENOMINATOR);
+  auto const after = NsecTime::from_offset(base.get_offset() + 1);
+  auto const before = NsecTime::from_offset(base.get_offset() - 1);
+  TimeFormat const format("%H:%M:%.9S %k%K%l");
+  EXPECT_EQ("02:40:00.000000001 000000000", format(after, *UTC));
+  EXPECT_EQ("02:39:59.999999999 999999999", format(before, *UTC));
+}
+
+TEST(DaytimeFormat, format_to) {
+  auto const& format = DaytimeFormat::ISO_EXTENDED_MSEC;
+  char buf[12];
+  EXPECT_EQ(12u, format.format_to(buf, sizeof(buf), Daytime(14, 5, 17.789)));
+  EXPECT_EQ("14:05:17.789", string(buf, 12));
+
+  StringBuilder sb;
+  format.format_to(sb, Daytime::MISSING);
+  EXPECT_EQ("MISSING     ", sb.str());
+}
+
+//------------------------------------------------------------------------------
+// Class FixedFormat
+//------------------------------------------------------------------------------
+
+namespace {
+
+template<class FORMAT, class... ARGS>
+string
+fixed_str(
+  ARGS const&... args)
+{
+  char buf[FORMAT::WIDTH + 1];
+  char* const end = format<FORMAT>(args..., buf);
+  EXPECT_EQ(FORMAT::WIDTH, (size_t) (end - buf));
+  return string(buf, end);
+}
+
+}  // anonymous namespace
+
+TEST(FixedFormat, time) {
+  auto const tz = get_time_zone("US/Eastern");
+  for (auto const offset : {0l, 1l, 1374982658l, 1388552399l, 2147483647l}) {
+    auto const time = Unix64Time::from_offset(offset);
+    EXPECT_EQ(TimeFormat::ISO_LOCAL_BASIC(time, *tz),
+              fixed_str<fixed::IsoLocalBasic>(time, *tz));
+    EXPECT_EQ(TimeFormat::ISO_LOCAL_EXTENDED(time, *tz),
+              fixed_str<fixed::IsoLocalExtended>(time, *tz));
+    EXPECT_EQ(TimeFormat::ISO_UTC_BASIC(time, *UTC),
+              fixed_str<fixed::IsoUtcBasic>(time, *UTC));
+    EXPECT_EQ(TimeFormat::ISO_UTC_EXTENDED(time, *UTC),
+              fixed_str<fixed::IsoUtcExtended>(time, *UTC));
+    EXPECT_EQ(TimeFormat::ISO_ZONE_BASIC(time, *tz),
+              fixed_str<fixed::IsoZoneBasic>(time, *tz));
+    EXPECT_EQ(TimeFormat::ISO_ZONE_EXTENDED(time, *tz),
+              fixed_str<fixed::IsoZoneExtended>(time, *tz));
+  }
+
+  auto const time = Unix64Time::from_offset(1374982658);
+  EXPECT_EQ("2013-07-28T03:37:38Z", fixed_str<fixed::IsoUtcExtended>(time, *UTC));
+  EXPECT_EQ("20130727T233738-0400", fixed_str<fixed::IsoZoneBasic>(time, *tz));
+  EXPECT_EQ("100% 2013", (fixed_str<FixedFormat<'1','0','0','%','%',' ','%','Y'>>(time, *UTC)));
+}
+
+TEST(FixedFormat, time_invalid) {
+  EXPECT_EQ(TimeFormat::ISO_UTC_EXTENDED(Time::INVALID),
+            fixed_str<fixed::IsoUtcExtended>(Time::INVALID, *UTC));
+  EXPECT_EQ(TimeFormat::ISO_ZONE_BASIC(Time::MISSING),
+            fixed_str<fixed::IsoZoneBasic>(Time::MISSING, *UTC));
+}
+
+TEST(FixedFormat, date) {
+  for (auto const& date : {Date::MIN, 1985/APR/12, 2016/JAN/1, 2016/DEC/31, Date::MAX}) {
+    EXPECT_EQ(DateFormat::ISO_CALENDAR_BASIC(date),
+              fixed_str<fixed::IsoCalendarBasic>(date));
+    EXPECT_EQ(DateFormat::ISO_CALENDAR_EXTENDED(date),
+              fixed_str<fixed::IsoCalendarExtended>(date));
+    EXPECT_EQ(DateFormat::ISO_ORDINAL_BASIC(date),
+              fixed_str<fixed::IsoOrdinalBasic>(date));
+    EXPECT_EQ(DateFormat::ISO_ORDINAL_EXTENDED(date),
+              fixed_str<fixed::IsoOrdinalExtended>(date));
+    EXPECT_EQ(DateFormat::ISO_WEEK_BASIC(date),
+              fixed_str<fixed::IsoWeekBasic>(date));
+    EXPECT_EQ(DateFormat::ISO_WEEK_EXTENDED(date),
+              fixed_str<fixed::IsoWeekExtended>(date));
+  }
+  EXPECT_EQ("1985-04-12", fixed_str<fixed::IsoCalendarExtended>(1985/APR/12));
+  EXPECT_EQ("INVALID   ", fixed_str<fixed::IsoCalendarExtended>(Date::INVALID));
+  EXPECT_EQ("MISSING ",   fixed_str<fixed::IsoCalendarBasic>(Date16::MISSING));
+}
+
+TEST(FixedFormat, daytime) {
+  for (auto const& daytime : {Daytime::MIN, Daytime(14, 5, 17.7890123456), Daytime(23, 59, 59.5)}) {
+    EXPECT_EQ(DaytimeFormat::ISO_EXTENDED(daytime),
+              fixed_str<fixed::IsoDaytimeExtended>(daytime));
+    EXPECT_EQ(DaytimeFormat::ISO_BASIC_MSEC(daytime),
+              fixed_str<fixed::IsoDaytimeBasicMsec>(daytime));
+    EXPECT_EQ(DaytimeFormat::ISO_EXTENDED_USEC(daytime),
+              fixed_str<fixed::IsoDaytimeExtendedUsec>(daytime));
+    EXPECT_EQ(DaytimeFormat::ISO_EXTENDED_NSEC(daytime),
+              fixed_str<fixed::IsoDaytimeExtendedNsec>(daytime));
+  }
+  EXPECT_EQ("14:05:17.789", fixed_str<fixed::IsoDaytimeExtendedMsec>(Daytime(14, 5, 17.7890123456)));
+  EXPECT_EQ("MISSING     ", fixed_str<fixed::IsoDaytimeExtendedMsec>(Daytime::MISSING));
+}
@@ -0,0 +1,389 @@
+#include <cstring>
+#include <string>
+
+#include "cron/ez.hh"
+#include "cron/format.hh"
+#include "cron/parse.hh"
+#include "gtest/gtest.h"
+
+using namespace aslib;
+using namespace cron;
+using namespace cron::ez;
+
+using std::string;
+
+//------------------------------------------------------------------------------
+// Class DateParser
+//------------------------------------------------------------------------------
+
+TEST(DateParser, basic) {
+  DateParser const parser("%Y-%m-%d");
+  EXPECT_EQ(2016/JUL/4,         parser.parse("2016-07-04"));
+  EXPECT_EQ(1/JAN/1,            parser.parse("0001-01-01"));
+  EXPECT_EQ(9999/DEC/31,        parser.parse("9999-12-31"));
+  EXPECT_EQ(2016/FEB/29,        parser.parse<Date16>("2016-02-29"));
+
+  EXPECT_THROW(parser.parse("2016-7-04"),       TimeParseError);
+  EXPECT_THROW(parser.parse("2016-07-04 "),     TimeParseError);
+  EXPECT_THROW(parser.parse("2016/07/04"),      TimeParseError);
+  EXPECT_THROW(parser.parse(""),                TimeParseError);
+  EXPECT_THROW(parser.parse("2015-02-29"),      InvalidDateError);
+  EXPECT_THROW(parser.parse("2016-13-01"),      InvalidDateError);
+  EXPECT_THROW(parser.parse("0000-01-01"),      InvalidDateError);
+  EXPECT_THROW(parser.parse<Date16>("1969-12-31"), DateRangeError);
+}
+
+TEST(DateParser, formats) {
+  EXPECT_EQ(2013/JUL/28, DateParser(DateFormat::ISO_CALENDAR_BASIC).parse("20130728"));
+  EXPECT_EQ(2013/JUL/28, DateParser(DateFormat::ISO_ORDINAL_BASIC).parse("2013209"));
+  EXPECT_EQ(2013/JUL/28, DateParser(DateFormat::ISO_ORDINAL_EXTENDED).parse("2013-209"));
+  EXPECT_EQ(2013/JUL/28, DateParser("week %V of %G, %W").parse("week 30 of 2013, Sunday"));
+  EXPECT_EQ(2013/JUL/28, DateParser("%~W %d %~b %y").parse("sun 28 JUL 13"));
+  EXPECT_EQ(1999/JUL/28, DateParser("%d %b %y").parse("28 July 99"));
+  EXPECT_EQ(2013/JUL/28, DateParser("%#_4d.%m.%Y").parse("__28.07.2013"));
+
+  // The weekday must agree with the date.
+  EXPECT_THROW(DateParser("%~W %Y-%m-%d").parse("Mon 2013-07-28"), InvalidDateError);
+
+  // Round-trip through the formatter.
+  for (auto const& format : {
+         DateFormat::ISO_CALENDAR_BASIC, DateFormat::ISO_CALENDAR_EXTENDED,
+         DateFormat::ISO_ORDINAL_BASIC, DateFormat::ISO_ORDINAL_EXTENDED,
+         DateFormat("%G week %V %W"), DateFormat("%~b %d %Y")}) {
+    DateParser const parser(format);
+    for (Date date = 1900/JAN/1; date < 2100/JAN/1; date += 97)
+      EXPECT_EQ(date, parser.parse(format(date)));
+  }
+}
+
+TEST(DateParser, pattern) {
+  EXPECT_THROW(DateParser("%Y-%m"), TimeFormatError);
+  EXPECT_THROW(DateParser("%Y-%m-%d %H"), TimeFormatError);
+  EXPECT_THROW(DateParser("%Y-%m-%q"), TimeFormatError);
+  EXPECT_THROW(DateParser("%Y-%m-%"), ValueError);
+  EXPECT_EQ("%Y-%m-%d", DateParser("%Y-%m-%d").get_pattern());
+
+  // Modifiers and escapes are scanned as the formatter scans them.
+  EXPECT_THROW(DateParser("%Y-%m-%#"), ValueError);
+  EXPECT_THROW(DateParser("%Y-%m-%.1.2d"), ValueError);
+  EXPECT_THROW(DateParser("%EY-%m-%d"), TimeFormatError);
+  EXPECT_EQ(2013/JUL/28, DateParser("%Y-%m-%d %%").parse("2013-07-28 %"));
+}
+
+TEST(DateParser, error_code) {
+  DateParser const parser(DateFormat::ISO_CALENDAR_EXTENDED);
+  string const text = "2016-07-04";
+  ErrorCode error;
+  EXPECT_EQ(2016/JUL/4, parser.parse(text.data(), text.data() + 10, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_TRUE(parser.parse(text.data(), text.data() + 9, error).is_invalid());
+  EXPECT_EQ(ErrorCode::PARSE, error);
+}
+
+TEST(DateParser, batch) {
+  DateParser const parser(DateFormat::ISO_CALENDAR_EXTENDED);
+  string const text = "2016-07-04\n2016-02-30\nfoo\n1970-01-01\n";
+  Date dates[8];
+  EXPECT_EQ(
+    4u, parser.parse(text.data(), text.data() + text.size(), '\n', dates, 8));
+  EXPECT_EQ(2016/JUL/4, dates[0]);
+  EXPECT_TRUE(dates[1].is_invalid());
+  EXPECT_TRUE(dates[2].is_invalid());
+  EXPECT_EQ(1970/JAN/1, dates[3]);
+
+  // Stops after `max` fields.
+  EXPECT_EQ(
+    2u, parser.parse(text.data(), text.data() + text.size(), '\n', dates, 2));
+}
+
+//------------------------------------------------------------------------------
+// Class DaytimeParser
+//------------------------------------------------------------------------------
+
+TEST(DaytimeParser, basic) {
+  DaytimeParser const parser(DaytimeFormat::ISO_EXTENDED);
+  EXPECT_EQ(Daytime(15, 37, 38), parser.parse("15:37:38"));
+  EXPECT_EQ(Daytime(0, 0, 0), parser.parse("00:00:00"));
+  EXPECT_EQ(Daytime32(23, 59, 59), parser.parse<Daytime32>("23:59:59"));
+  EXPECT_THROW(parser.parse("24:00:00"), InvalidDaytimeError);
+  EXPECT_THROW(parser.parse("15:37"), TimeParseError);
+
+  DaytimeParser const hm("%H%M");
+  EXPECT_EQ(Daytime(9, 30, 0), hm.parse("0930"));
+
+  DaytimeParser const pm("%h:%M %p");
+  EXPECT_EQ(Daytime(0, 30, 0), pm.parse("12:30 AM"));
+  EXPECT_EQ(Daytime(12, 30, 0), pm.parse("12:30 pm"));
+  EXPECT_EQ(Daytime(21, 30, 0), pm.parse("09:30 PM"));
+  EXPECT_THROW(pm.parse("13:30 PM"), InvalidDaytimeError);
+
+  EXPECT_THROW(DaytimeParser("%M:%S"), TimeFormatError);
+  EXPECT_THROW(DaytimeParser("%Y %H"), TimeFormatError);
+}
+
+TEST(DaytimeParser, fraction) {
+  EXPECT_EQ(
+    Daytime::from_daytick(Daytime(15, 37, 38).get_daytick() + DAYTICK_PER_SEC / 2),
+    DaytimeParser(DaytimeFormat::ISO_EXTENDED_MSEC).parse("15:37:38.500"));
+  EXPECT_NEAR(
+    38.123456789,
+    DaytimeParser(DaytimeFormat::ISO_EXTENDED_NSEC).parse("15:37:38.123456789")
+      .get_hms().second,
+    1e-12);
+  EXPECT_NEAR(
+    38.123456789,
+    DaytimeParser("%H:%M:%S.%k%K%l").parse("15:37:38.123456789")
+      .get_hms().second,
+    1e-12);
+  EXPECT_THROW(
+    DaytimeParser(DaytimeFormat::ISO_EXTENDED_MSEC).parse("15:37:38.5"),
+    TimeParseError);
+
+  // Round-trip through the formatter.
+  for (auto const& format : {
+         DaytimeFormat::ISO_BASIC_USEC, DaytimeFormat::ISO_EXTENDED_USEC}) {
+    DaytimeParser const parser(format);
+    for (double ssm = 0; ssm < SECS_PER_DAY; ssm += 1234.567891) {
+      auto const daytime = Daytime::from_ssm(ssm);
+      EXPECT_NEAR(
+        daytime.get_ssm(), parser.parse(format(daytime)).get_ssm(), 1e-6);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Class TimeParser
+//------------------------------------------------------------------------------
+
+TEST(TimeParser, basic) {
+  auto const tz = get_time_zone("US/Eastern");
+  Time const time(2013/JUL/28, Daytime(15, 37, 38), *tz);
+
+  TimeParser const parser(TimeFormat::ISO_LOCAL_EXTENDED);
+  EXPECT_EQ(time, parser.parse("2013-07-28T15:37:38", *tz));
+  EXPECT_EQ(Unix64Time(time), parser.parse<Unix64Time>("2013-07-28T15:37:38", *tz));
+  EXPECT_EQ(time, TimeParser(TimeFormat::ISO_UTC_BASIC).parse("20130728T193738Z", *UTC));
+
+  // The time zone abbreviation is matched but not used.
+  EXPECT_EQ(time, TimeParser(TimeFormat::get_default()).parse("2013-07-28 15:37:38 EDT", *tz));
+
+  EXPECT_THROW(parser.parse("2013-03-10T02:30:00", *tz), NonexistentLocalTime);
+  EXPECT_THROW(
+    parser.parse<Unix32Time>("2038-01-19T03:14:07", *UTC), InvalidTimeError);
+  EXPECT_THROW(parser.parse("2013-07-28 15:37:38", *tz), TimeParseError);
+  EXPECT_THROW(TimeParser("%Y-%m-%d"), TimeFormatError);
+  EXPECT_THROW(TimeParser("%H:%M:%S"), TimeFormatError);
+}
+
+TEST(TimeParser, offset) {
+  auto const tz = get_time_zone("US/Eastern");
+  Time const time(2013/JUL/28, Daytime(15, 37, 38), *tz);
+
+  // An explicit offset overrides the time zone.
+  TimeParser const parser(TimeFormat::ISO_ZONE_EXTENDED);
+  EXPECT_EQ(time, parser.parse("2013-07-28T15:37:38-04:00", *UTC));
+  EXPECT_EQ(time, parser.parse("2013-07-28T20:37:38+01:00", *tz));
+  EXPECT_EQ(time, TimeParser(TimeFormat::ISO_ZONE_BASIC).parse("20130728T193738+0000", *tz));
+  EXPECT_EQ(time, TimeParser("%Y-%m-%d %H:%M:%S UTC%o").parse("2013-07-28 15:37:38 UTC-14400", *UTC));
+
+  // Round-trip through the formatter.
+  for (auto const& format : {
+         TimeFormat::ISO_ZONE_EXTENDED, TimeFormat("%Y-%m-%dT%H:%M:%.6S%U%Q:%q")}) {
+    TimeParser const parser(format);
+    auto const start = Unix64Time(1900/JAN/1, Daytime::MIDNIGHT, *UTC);
+    auto const stop = Unix64Time(2100/JAN/1, Daytime::MIDNIGHT, *UTC);
+    for (auto offset = start.get_offset(); offset < stop.get_offset();
+         offset += 9876543) {
+      auto const time = Unix64Time::from_offset(offset);
+      EXPECT_EQ(time, parser.parse<Unix64Time>(format(time, *tz), *UTC));
+    }
+  }
+}
+
+TEST(TimeParser, error_code) {
+  auto const tz = get_time_zone("US/Eastern");
+  TimeParser const parser(TimeFormat::ISO_LOCAL_EXTENDED);
+  ErrorCode error;
+  auto const parse = [&] (char const* const text) {
+    return parser.parse<Time>(text, text + strlen(text), *tz, true, error);
+  };
+
+  EXPECT_EQ(Time(2013/JUL/28, Daytime(15, 37, 38), *tz), parse("2013-07-28T15:37:38"));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_TRUE(parse("2013-03-10T02:30:00").is_invalid());
+  EXPECT_EQ(ErrorCode::NONEXISTENT_LOCAL_TIME, error);
+  EXPECT_TRUE(parse("2013-02-29T02:30:00").is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+  EXPECT_TRUE(parse("2013-02-28T02:60:00").is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DAYTIME, error);
+  EXPECT_TRUE(parse("2013-02-28").is_invalid());
+  EXPECT_EQ(ErrorCode::PARSE, error);
+}
+
+TEST(TimeParser, batch) {
+  auto const tz = get_time_zone("US/Eastern");
+  string const text =
+    "2013-07-28 15:37:38,2013-03-10 02:30:00,bogus,2013-11-03 01:30:00";
+
+  TimeParser const parser("%Y-%m-%d %H:%M:%S");
+  Time times[4];
+  EXPECT_EQ(
+    4u,
+    parser.parse(text.data(), text.data() + text.size(), ',', times, 4, *tz));
+  EXPECT_EQ(Time(2013/JUL/28, Daytime(15, 37, 38), *tz), times[0]);
+  EXPECT_TRUE(times[1].is_invalid());
+  EXPECT_TRUE(times[2].is_invalid());
+  EXPECT_EQ(Time(2013/NOV/3, Daytime(5, 30, 0), *UTC), times[3]);
+
+  // With an explicit offset.
+  string const utc_text = "2013-07-28T19:37:38Z\n2013-07-28T19:37:3Z\n";
+  EXPECT_EQ(
+    2u,
+    TimeParser(TimeFormat::ISO_UTC_EXTENDED).parse(
+      utc_text.data(), utc_text.data() + utc_text.size(), '\n', times, 4,
+      *UTC));
+  EXPECT_EQ(Time(2013/JUL/28, Daytime(15, 37, 38), *tz), times[0]);
+  EXPECT_TRUE(times[1].is_invalid());
+
+  // More than one chunk.
+  string many;
+  for (int i = 0; i < 1000; ++i)
+    many += "2013-07-28 15:37:38,";
+  Time many_times[1000];
+  EXPECT_EQ(
+    1000u,
+    parser.parse(
+      many.data(), many.data() + many.size(), ',', many_times, 1000, *tz));
+  for (auto const time : many_times)
+    EXPECT_EQ(times[0], time);
+}
+
+//------------------------------------------------------------------------------
+// ISO 8601 fast path
+//------------------------------------------------------------------------------
+
+TEST(parse_iso_time, basic) {
+  auto const tz = get_time_zone("US/Eastern");
+  Time const time(2013/JUL/28, Daytime(15, 37, 38), *tz);
+  EXPECT_EQ(time, parse_iso_time("2013-07-28T19:37:38Z"));
+  EXPECT_EQ(time, parse_iso_time("2013-07-28T15:37:38-04:00"));
+  EXPECT_EQ(time, parse_iso_time("2013-07-28T20:07:38+00:30"));
+  EXPECT_EQ(Unix64Time(time), parse_iso_time<Unix64Time>("2013-07-28T19:37:38Z"));
+  EXPECT_EQ(
+    NsecTime(2013/JUL/28, Daytime(19, 37, 38.123456789), *UTC),
+    parse_iso_time<NsecTime>("2013-07-28T19:37:38.123456789Z"));
+  EXPECT_EQ(
+    Unix64Time(1/JAN/1, Daytime::MIDNIGHT, *UTC),
+    parse_iso_time<Unix64Time>("0001-01-01T00:00:00Z"));
+  EXPECT_EQ(
+    Unix64Time(9999/DEC/31, Daytime(23, 59, 59), *UTC),
+    parse_iso_time<Unix64Time>("9999-12-31T23:59:59Z"));
+
+  EXPECT_THROW(parse_iso_time("2013-07-28T19:37:38"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-28 19:37:38Z"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-28T19:37:38.Z"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-28T19:37:38.1234567890Z"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-28T19:37:38+0400"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-28T19:37:38Z "), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-2xT19:37:38Z"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-07-28T19:3/:38Z"), TimeParseError);
+  EXPECT_THROW(parse_iso_time("2013-02-29T19:37:38Z"), InvalidDateError);
+  EXPECT_THROW(parse_iso_time("2013-02-28T24:00:00Z"), InvalidDaytimeError);
+  EXPECT_THROW(parse_iso_time<Unix32Time>("2040-01-01T00:00:00Z"), InvalidTimeError);
+
+  ErrorCode error;
+  string const text = "1969-12-31T23:59:59Z";
+  EXPECT_TRUE(
+    parse_iso_time<SmallTime>(text.data(), text.data() + text.size(), error)
+    .is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_TIME, error);
+}
+
+TEST(parse_iso_time, scan_head) {
+  // The scalar and SIMD scans agree, on valid heads and on each one-char
+  // corruption of them.
+  for (char const* const head : {
+         "2013-07-28T19:37", "0001-01-01T00:00", "9999-12-31T23:59",
+         "9999-99-99T99:99"}) {
+    for (size_t i = 0; i < 16; ++i)
+      for (char const c : {'0', '5', '9', '/', ':', '-', 'T', ' ', 'x', '\x80'}) {
+        char text[17];
+        memcpy(text, head, sizeof(text));
+        text[i] = c;
+
+        unsigned y0 = 0, m0 = 0, d0 = 0, h0 = 0, n0 = 0;
+        bool const ok = scan_iso_head_scalar(text, y0, m0, d0, h0, n0);
+        EXPECT_EQ(
+          c == head[i] || (isdigit((unsigned char) c) && isdigit(head[i])), ok)
+          << text;
+#ifdef __SSE2__
+        unsigned y1 = 0, m1 = 0, d1 = 0, h1 = 0, n1 = 0;
+        EXPECT_EQ(ok, scan_iso_head_sse2(text, y1, m1, d1, h1, n1)) << text;
+        if (ok) {
+          EXPECT_EQ(y0, y1);
+          EXPECT_EQ(m0, m1);
+          EXPECT_EQ(d0, d1);
+          EXPECT_EQ(h0, h1);
+          EXPECT_EQ(n0, n1);
+        }
+#endif
+      }
+  }
+
+  unsigned year, month, day, hour, minute;
+  ASSERT_TRUE(
+    scan_iso_head_scalar("2013-07-28T19:37", year, month, day, hour, minute));
+  EXPECT_EQ(2013u, year);
+  EXPECT_EQ(7u, month);
+  EXPECT_EQ(28u, day);
+  EXPECT_EQ(19u, hour);
+  EXPECT_EQ(37u, minute);
+}
+
+TEST(parse_iso_time, round_trip) {
+  // Agrees with the general parser on formatted times.
+  auto const tz = get_time_zone("America/Sao_Paulo");
+  for (auto const& format : {
+         TimeFormat::ISO_UTC_EXTENDED, TimeFormat::ISO_ZONE_EXTENDED,
+         TimeFormat("%Y-%m-%dT%H:%M:%.9S%U%Q:%q")}) {
+    TimeParser const parser(format);
+    auto const& zone = format.get_pattern().back() == 'Z' ? *UTC : *tz;
+    // The formatter rounds seconds, so use fractions only if it shows them.
+    bool const frac = format.get_pattern().find(".9S") != string::npos;
+    for (auto offset = NsecTime(1970/JAN/1, Daytime::MIDNIGHT, *UTC).get_offset();
+         offset < NsecTime(2200/JAN/1, Daytime::MIDNIGHT, *UTC).get_offset();
+         offset += 7654321 * NsecTime::DENOMINATOR + (frac ? 12345678 : 0)) {
+      auto const time = NsecTime::from_offset(offset);
+      auto const str = format(time, zone);
+      EXPECT_EQ(parser.parse<NsecTime>(str, *UTC), parse_iso_time<NsecTime>(str));
+    }
+  }
+}
+
+TEST(parse_iso_time, batch) {
+  string const text =
+    "2013-07-28T19:37:38Z\r\n"
+    "2013-07-28T15:37:38.5-04:00\n"
+    "garbage\n"
+    "\n"
+    "2013-07-28T19:37:38Z";
+  Time times[8];
+  EXPECT_EQ(5u, parse_iso_times(text.data(), text.data() + text.size(), times, 8));
+  Time const time(2013/JUL/28, Daytime(19, 37, 38), *UTC);
+  EXPECT_EQ(time, times[0]);
+  EXPECT_EQ(Time::from_offset(time.get_offset() + Time::DENOMINATOR / 2), times[1]);
+  EXPECT_TRUE(times[2].is_invalid());
+  EXPECT_TRUE(times[3].is_invalid());
+  EXPECT_EQ(time, times[4]);
+}
+
+TEST(parse_iso_date, basic) {
+  EXPECT_EQ(2016/JUL/4, parse_iso_date("2016-07-04"));
+  EXPECT_EQ(2016/JUL/4, parse_iso_date<Date16>("2016-07-04"));
+  EXPECT_THROW(parse_iso_date("2016-07-4"), TimeParseError);
+  EXPECT_THROW(parse_iso_date("2016-07-04T"), TimeParseError);
+  EXPECT_THROW(parse_iso_date("2016-06-31"), InvalidDateError);
+  EXPECT_THROW(parse_iso_date("0000-01-01"), InvalidDateError);
+  EXPECT_THROW(parse_iso_date<Date16>("1900-01-01"), DateRangeError);
+}
+
@@ -55,3 +55,41 @@ TEST(StringBuilder, long0) {
   }
 }
 
+
+TEST(StringBuilder, buffer) {
+  char buf[8];
+  {
+    StringBuilder sb(buf, sizeof(buf));
+    (sb << "x=").format(123456);
+    EXPECT_EQ(buf, sb.data());
+    EXPECT_FALSE(sb.on_heap());
+    EXPECT_EQ("x=123456", sb.str());
+  }
+  {
+    // Outgrows the buffer, and moves to the heap.
+    StringBuilder sb(buf, sizeof(buf));
+    (sb << "x=").format(1234567);
+    EXPECT_NE(buf, sb.data());
+    EXPECT_TRUE(sb.on_heap());
+    EXPECT_EQ("x=1234567", sb.str());
+  }
+}
+
+TEST(StringBuilder, digits) {
+  EXPECT_EQ(1u, count_digits(0));
+  EXPECT_EQ(1u, count_digits(9));
+  EXPECT_EQ(2u, count_digits(10));
+  EXPECT_EQ(4u, count_digits(9999));
+  EXPECT_EQ(5u, count_digits(10000));
+  EXPECT_EQ(20u, count_digits(18446744073709551615ull));
+
+  StringBuilder sb;
+  for (uint64_t value : {0ull, 7ull, 42ull, 100ull, 999ull, 1000ull, 2016ull,
+                         12345ull, 18446744073709551615ull}) {
+    sb.format(value, 4, '0');
+    sb << ' ';
+  }
+  EXPECT_EQ(
+    "0000 0007 0042 0100 0999 1000 2016 12345 18446744073709551615 ",
+    sb.str());
+}
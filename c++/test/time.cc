@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "cron/ez.hh"
 #include "cron/format.hh"
 #include "cron/time.hh"
@@ -122,6 +124,133 @@ TEST(Time, from_parts_invalid) {
   EXPECT_TRUE(Time( 2013,  2,  9,  3,  0,  0, *tz, false).is_valid());
 }
 
+TEST(Time, from_local_error_code) {
+  auto const tz = get_time_zone("US/Eastern");
+  ErrorCode error;
+
+  auto const time = from_local<Time>(
+    (2013/JUL/28).get_datenum(), Daytime(15, 37, 38).get_daytick(), *tz, 
+    true, error);
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_EQ(Time(2013/JUL/28, Daytime(15, 37, 38), *tz), time);
+
+  EXPECT_TRUE(from_local<Time>(
+    DATENUM_INVALID, 0, *tz, true, error).is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DATE, error);
+  EXPECT_TRUE(Time::from_local(
+    (2013/JUL/28).get_datenum(), DAYTICK_INVALID, *tz, true, error)
+    .is_invalid());
+  EXPECT_EQ(ErrorCode::INVALID_DAYTIME, error);
+  EXPECT_TRUE(Unix64Time::from_local(
+    (2013/MAR/10).get_datenum(), Daytime(2, 30, 0).get_daytick(), *tz, 
+    true, error).is_invalid());
+  EXPECT_EQ(ErrorCode::NONEXISTENT_LOCAL_TIME, error);
+
+  // Ambiguous times are resolved by `first`.
+  auto const date = (2013/NOV/3).get_datenum();
+  auto const daytick = Daytime(1, 30, 0).get_daytick();
+  EXPECT_EQ(
+    Time(2013/NOV/3, Daytime(5, 30, 0), *UTC), 
+    Time::from_local(date, daytick, *tz, true, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+  EXPECT_EQ(
+    Time(2013/NOV/3, Daytime(6, 30, 0), *UTC), 
+    Time::from_local(date, daytick, *tz, false, error));
+  EXPECT_EQ(ErrorCode::NONE, error);
+
+  // Local times past the end of the range are invalid.
+  auto const end = (2038/JAN/19).get_datenum();
+  EXPECT_TRUE(Unix32Time::from_local(
+    end, Daytime(3, 14, 5).get_daytick(), *UTC, true, error).is_valid());
+  EXPECT_EQ(ErrorCode::NONE, error);
+  for (Second const second : {6, 7}) {
+    EXPECT_TRUE(Unix32Time::from_local(
+      end, Daytime(3, 14, second).get_daytick(), *UTC, true, error)
+      .is_invalid());
+    EXPECT_EQ(ErrorCode::INVALID_TIME, error);
+  }
+}
+
+TEST(Time, from_local_batch) {
+  auto const tz = get_time_zone("US/Eastern");
+
+  // Every ten minutes through 2013, and some invalid values.
+  std::vector<Datenum> datenums;
+  std::vector<Daytick> dayticks;
+  for (Datenum d = (2013/JAN/1).get_datenum(); d < (2014/JAN/1).get_datenum(); ++d)
+    for (Daytick y = 0; y < DAYTICK_BOUND; y += 600 * DAYTICK_PER_SEC) {
+      datenums.push_back(d);
+      dayticks.push_back(y);
+    }
+  datenums.push_back(DATENUM_INVALID);
+  dayticks.push_back(0);
+  datenums.push_back(datenums[0]);
+  dayticks.push_back(DAYTICK_INVALID);
+  size_t const count = datenums.size();
+
+  for (bool const first : {true, false}) {
+    std::vector<Time> times(count);
+    std::vector<LocalTimeStatus> statuses(count);
+    from_local(
+      datenums.data(), dayticks.data(), count, *tz, first,
+      times.data(), statuses.data());
+
+    // Matches the scalar conversion.
+    size_t num_nonexistent = 0;
+    size_t num_ambiguous = 0;
+    for (size_t i = 0; i < count - 2; ++i) {
+      Time const expected(datenums[i], dayticks[i], *tz, first);
+      EXPECT_TRUE(expected.is(times[i]));
+      if (statuses[i] == LocalTimeStatus::NONEXISTENT) {
+        EXPECT_TRUE(times[i].is_invalid());
+        ++num_nonexistent;
+      }
+      else if (statuses[i] == LocalTimeStatus::AMBIGUOUS)
+        ++num_ambiguous;
+      else
+        EXPECT_EQ(LocalTimeStatus::UNIQUE, statuses[i]);
+    }
+    // One hour in the spring and one in the fall.
+    EXPECT_EQ(6u, num_nonexistent);
+    EXPECT_EQ(6u, num_ambiguous);
+
+    EXPECT_EQ(LocalTimeStatus::INVALID, statuses[count - 2]);
+    EXPECT_TRUE(times[count - 2].is_invalid());
+    EXPECT_EQ(LocalTimeStatus::INVALID, statuses[count - 1]);
+    EXPECT_TRUE(times[count - 1].is_invalid());
+  }
+
+  // Local times past the end of the range are invalid.
+  Datenum const end_datenums[] = {
+    (2038/JAN/19).get_datenum(),
+    (2038/JAN/19).get_datenum(),
+    (2038/JAN/19).get_datenum(),
+  };
+  Daytick const end_dayticks[] = {
+    Daytime(3, 14, 5).get_daytick(),
+    Daytime(3, 14, 6).get_daytick(),
+    Daytime(3, 14, 7).get_daytick(),
+  };
+  Unix32Time times[3];
+  LocalTimeStatus statuses[3];
+  from_local(end_datenums, end_dayticks, 3, *UTC, true, times, statuses);
+  EXPECT_EQ(LocalTimeStatus::UNIQUE, statuses[0]);
+  EXPECT_TRUE(times[0].is_valid());
+  for (size_t i = 1; i < 3; ++i) {
+    EXPECT_EQ(LocalTimeStatus::INVALID, statuses[i]);
+    EXPECT_TRUE(times[i].is_invalid());
+  }
+
+  // Likewise before the start.
+  Datenum const start = (1969/DEC/31).get_datenum();
+  Daytick const start_daytick = Daytime(23, 59, 59).get_daytick();
+  SmallTime small;
+  LocalTimeStatus status;
+  from_local(&start, &start_daytick, 1, *UTC, true, &small, &status);
+  EXPECT_EQ(LocalTimeStatus::INVALID, status);
+  EXPECT_TRUE(small.is_invalid());
+}
+
 TEST(Time, get_parts) {
   // 2013 July 28 15:37:38.125 EDT [UTC-4].
   Time const time = Time::from_offset(4262126704887070720l);
@@ -1,3 +1,7 @@
+#include <thread>
+#include <vector>
+
+#include "aslib/file.hh"
 #include "cron/time.hh"
 #include "cron/time_zone.hh"
 #include "gtest/gtest.h"
@@ -5,6 +9,70 @@
 using namespace aslib;
 using namespace cron;
 
+//------------------------------------------------------------------------------
+// Class TzFile.
+
+TEST(TzFile, load) {
+  auto const filename = find_time_zone_file("US/Eastern");
+  auto const text = fs::load_text(filename);
+
+  // Loading from the mapped file matches parsing a copy of the contents.
+  auto const tz_file0 = TzFile::load(filename);
+  TzFile const tz_file1(text.data(), text.size());
+  ASSERT_EQ(tz_file1.types_.size(), tz_file0.types_.size());
+  for (size_t i = 0; i < tz_file0.types_.size(); ++i) {
+    EXPECT_EQ(tz_file1.types_[i].gmt_offset_, tz_file0.types_[i].gmt_offset_);
+    EXPECT_EQ(tz_file1.types_[i].abbreviation_, tz_file0.types_[i].abbreviation_);
+  }
+  ASSERT_EQ(tz_file1.transitions_.size(), tz_file0.transitions_.size());
+  for (size_t i = 0; i < tz_file0.transitions_.size(); ++i)
+    EXPECT_EQ(tz_file1.transitions_[i].time_, tz_file0.transitions_[i].time_);
+  EXPECT_EQ("EST5EDT,M3.2.0,M11.1.0", tz_file0.future_);
+
+  // Truncated data is a format error.
+  for (size_t const size : {0ul, 10ul, text.size() / 2, text.size() - 1})
+    EXPECT_THROW(TzFile(text.data(), size), FormatError);
+}
+
+//------------------------------------------------------------------------------
+// Class TzRule.
+
+TEST(TzRule, parse) {
+  TzRule const eastern("EST5EDT,M3.2.0,M11.1.0");
+  EXPECT_TRUE(eastern.has_dst());
+  EXPECT_EQ(-18000, eastern.get_std().offset);
+  EXPECT_EQ("EDT", eastern.get_dst().abbreviation);
+  EXPECT_EQ(-14400, eastern.get_dst().offset);
+  TimeOffset start, end;
+  eastern.get_transitions(2100, start, end);
+  EXPECT_EQ(4108690800, start);
+  EXPECT_EQ(4129250400, end);
+
+  TzRule const chatham("<+1245>-12:45<+1345>,M9.5.0/2:45,M4.1.0/3:45");
+  EXPECT_EQ(45900, chatham.get_std().offset);
+  EXPECT_EQ("+1345", chatham.get_dst().abbreviation);
+  EXPECT_EQ(49500, chatham.get_dst().offset);
+
+  TzRule const julian("XXX3YYY,J60/-1,300/26");
+  julian.get_transitions(2000, start, end);
+  EXPECT_EQ(951868800 - 3600 + 10800, start);  // 2000-03-01T-01:00 local
+  EXPECT_EQ(972604800 + 93600 + 7200, end);   // 2000-10-27T26:00 local
+
+  EXPECT_FALSE(TzRule("<+0530>-5:30").has_dst());
+  // Any character but '>' may appear in brackets, as in the Factory zone.
+  TzRule const factory("<Local time zone must be set--see zic manual page>0");
+  EXPECT_FALSE(factory.has_dst());
+  EXPECT_EQ(
+    "Local time zone must be set--see zic manual page", 
+    factory.get_std().abbreviation);
+  EXPECT_THROW(TzRule("<EST5"), FormatError);
+  EXPECT_TRUE(TzRule("").is_empty());
+  EXPECT_THROW(TzRule("E5"), FormatError);
+  EXPECT_THROW(TzRule("EST5EDT,M3.2.0"), FormatError);
+  EXPECT_THROW(TzRule("EST5EDT,M13.2.0,M11.1.0"), FormatError);
+  EXPECT_THROW(TzRule("EST5 "), FormatError);
+}
+
 //------------------------------------------------------------------------------
 // Class TimeZone.
 
@@ -13,6 +81,81 @@ TEST(TimeZone, get_time_zone) {
   ASSERT_EQ("US/Eastern", tz->get_name());
 }
 
+TEST(TimeZone, get_time_zone_factory) {
+  auto const tz = get_time_zone("Factory");
+  auto const parts = tz->get_parts((TimeOffset) 1451606400);
+  EXPECT_EQ(0, parts.offset);
+  EXPECT_FALSE(parts.is_dst);
+  EXPECT_STREQ("Local ", parts.abbreviation);
+}
+
+TEST(TimeZone, get_time_zone_all) {
+  // Every zone in the zoneinfo directory loads.
+  auto const zoneinfo_dir = get_zoneinfo_dir();
+  auto const names = get_time_zone_names(zoneinfo_dir);
+  EXPECT_GT(names.size(), 500u);
+  for (auto const& name : names)
+    EXPECT_NO_THROW(get_time_zone(name, zoneinfo_dir)) << name;
+}
+
+TEST(TimeZone, get_time_zone_id) {
+  auto const id = get_time_zone_id("US/Eastern");
+  EXPECT_NE(TIME_ZONE_ID_INVALID, id);
+  EXPECT_EQ(id, get_time_zone_id("US/Eastern"));
+  EXPECT_NE(id, get_time_zone_id("US/Pacific"));
+
+  auto const tz = get_time_zone("US/Eastern");
+  EXPECT_EQ(id, tz->get_id());
+  EXPECT_EQ(tz.get(), &get_time_zone(id));
+  EXPECT_EQ("US/Pacific", get_time_zone(get_time_zone_id("US/Pacific")).get_name());
+
+  EXPECT_THROW(get_time_zone(TIME_ZONE_ID_INVALID), ValueError);
+  EXPECT_NE(TIME_ZONE_ID_INVALID, UTC->get_id());
+  EXPECT_EQ(UTC.get(), &get_time_zone(UTC->get_id()));
+  EXPECT_EQ(
+    TIME_ZONE_ID_INVALID, 
+    get_time_zone("US/Eastern", get_zoneinfo_dir()).get_id());
+}
+
+TEST(TimeZone, get_id_parts) {
+  auto const& tz = get_time_zone(get_time_zone_id("US/Eastern"));
+  for (TimeOffset const time : {1374863198l, 1356998400l, -2000000000l}) {
+    auto const parts = tz.get_parts(time);
+    auto const id_parts = tz.get_id_parts(time);
+    EXPECT_EQ(tz.get_id(), id_parts.id);
+    EXPECT_EQ(parts.offset, id_parts.offset);
+    EXPECT_EQ(parts.is_dst, id_parts.is_dst);
+    EXPECT_STREQ(
+      parts.abbreviation, tz.get_type_parts(id_parts.type).abbreviation);
+  }
+}
+
+TEST(TimeZone, get_time_zone_threads) {
+  std::vector<std::string> const names = {
+    "America/Chicago", "America/Denver", "Asia/Tokyo", "Europe/Berlin",
+    "Europe/Paris", "US/Eastern", "UTC"};
+
+  // Many threads look up the same time zones concurrently.
+  size_t const num_threads = 16;
+  std::vector<std::vector<TimeZone_ptr>> results(num_threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; ++t)
+    threads.emplace_back([&names, &results, t] () {
+      for (int i = 0; i < 100; ++i)
+        for (auto const& name : names)
+          results[t].push_back(get_time_zone(name));
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  // Each name resolves to the same object every time.
+  for (auto const& result : results)
+    for (size_t i = 0; i < result.size(); ++i) {
+      EXPECT_EQ(get_time_zone(names[i % names.size()]), result[i]);
+      EXPECT_EQ(names[i % names.size()], result[i]->get_name());
+    }
+}
+
 TEST(TimeZone, get_parts) {
   // 2013 July 26 14:26:38 EDT.
   auto const time = Unix64Time::from_offset(1374863198);
@@ -24,6 +167,31 @@ TEST(TimeZone, get_parts) {
   EXPECT_STREQ("EDT", parts.abbreviation);
 }
 
+TEST(TimeZone, get_parts_transitions) {
+  // Check the parts at and just before every transition.
+  for (auto const name : {
+      "US/Eastern", "Europe/London", "Australia/Lord_Howe", "Asia/Kolkata",
+      "America/Sao_Paulo", "UTC"}) {
+    auto const tz_file = TzFile::load(find_time_zone_file(name));
+    auto const tz = get_time_zone(name);
+    TzFile::Type const* prev = nullptr;
+    for (auto const& transition : tz_file.transitions_) {
+      if (transition.time_ < TIME_OFFSET_MIN)
+        continue;
+      auto const& type = tz_file.types_[transition.type_index_];
+      auto const parts = tz->get_parts(transition.time_);
+      EXPECT_EQ(type.gmt_offset_, parts.offset) << name;
+      EXPECT_EQ(type.is_dst_, parts.is_dst) << name;
+      if (prev != nullptr) {
+        auto const parts = tz->get_parts(transition.time_ - 1);
+        EXPECT_EQ(prev->gmt_offset_, parts.offset) << name;
+        EXPECT_EQ(prev->is_dst_, parts.is_dst) << name;
+      }
+      prev = &type;
+    }
+  }
+}
+
 TEST(TimeZone, get_parts_local) {
   auto const tz = get_time_zone("US/Eastern");
 
@@ -38,6 +206,124 @@ TEST(TimeZone, get_parts_local) {
   EXPECT_EQ(-14400, parts2.offset);
 }
 
+TEST(TimeZone, cursor) {
+  auto const tz = get_time_zone("US/Eastern");
+  TimeZone::Cursor cursor;
+
+  // Walk through 2016 in ten-minute steps, checking against uncached lookups.
+  size_t num = 0;
+  for (TimeOffset time = 1451606400; time < 1483228800; time += 600) {
+    TimeZone::Cursor uncached;
+    auto const parts = tz->get_parts(time, cursor);
+    auto const expected = tz->get_parts(time, uncached);
+    EXPECT_EQ(expected.offset, parts.offset);
+    EXPECT_EQ(expected.is_dst, parts.is_dst);
+    EXPECT_EQ(1u, uncached.get_misses());
+
+    for (bool const first : {true, false}) {
+      TimeZone::Cursor uncached;
+      try {
+        auto const expected = tz->get_parts_local(time, uncached, first);
+        auto const parts = tz->get_parts_local(time, cursor, first);
+        EXPECT_EQ(expected.offset, parts.offset);
+        EXPECT_EQ(expected.is_dst, parts.is_dst);
+      }
+      catch (NonexistentLocalTime const&) {
+        EXPECT_THROW(
+          tz->get_parts_local(time, cursor, first), NonexistentLocalTime);
+      }
+    }
+    num += 3;
+  }
+
+  // Only the transitions, and the local times near them, should miss.
+  EXPECT_EQ(num, cursor.get_hits() + cursor.get_misses());
+  EXPECT_LT(cursor.get_misses(), 40u);
+
+  // A cursor may be reused with another time zone.
+  auto const parts = get_time_zone("US/Pacific")->get_parts((TimeOffset) 1374863198, cursor);
+  EXPECT_EQ(-25200, parts.offset);
+  EXPECT_STREQ("PDT", parts.abbreviation);
+}
+
+TEST(TimeZone, get_parts_rule) {
+  // After 2037, transitions come from the TZ rule.
+  auto const tz = get_time_zone("US/Eastern");
+  TimeOffset const start = 4108690800;  // 2100-03-14T07:00:00Z
+  TimeOffset const end   = 4129250400;  // 2100-11-07T06:00:00Z
+  EXPECT_STREQ("EST", tz->get_parts(start - 1).abbreviation);
+  EXPECT_STREQ("EDT", tz->get_parts(start    ).abbreviation);
+  EXPECT_EQ(-14400,   tz->get_parts(end - 1  ).offset);
+  EXPECT_EQ(-18000,   tz->get_parts(end      ).offset);
+
+  // Local times in the gap don't exist; those in the overlap are ambiguous.
+  EXPECT_THROW(tz->get_parts_local(start - 18000 + 1800), NonexistentLocalTime);
+  EXPECT_EQ(-14400, tz->get_parts_local(end - 14400 - 1800, true).offset);
+  EXPECT_EQ(-18000, tz->get_parts_local(end - 14400 - 1800, false).offset);
+
+  // The type IDs refer to the zone's types.
+  auto const id_parts = tz->get_id_parts(start);
+  EXPECT_TRUE(id_parts.is_dst);
+  EXPECT_STREQ("EDT", tz->get_type_parts(id_parts.type).abbreviation);
+
+  // In the southern hemisphere, DST spans the new year.
+  auto const sydney = get_time_zone("Australia/Sydney");
+  TimeOffset const sydney_end   = 4110451200;  // 2100-04-03T16:00:00Z
+  TimeOffset const sydney_start = 4126176000;  // 2100-10-02T16:00:00Z
+  EXPECT_STREQ("AEDT", sydney->get_parts(sydney_end - 1).abbreviation);
+  EXPECT_STREQ("AEST", sydney->get_parts(sydney_end).abbreviation);
+  EXPECT_EQ(36000, sydney->get_parts(sydney_start - 1).offset);
+  EXPECT_EQ(39600, sydney->get_parts(sydney_start).offset);
+
+  // Zones without DST keep their last offset.
+  EXPECT_EQ(19800, get_time_zone("Asia/Kolkata")->get_parts(end).offset);
+
+  // The rule applies through the last year.
+  auto const new_york = get_time_zone("America/New_York");
+  TimeOffset const last_summer = 253386446400;  // 9999-07-01T12:00:00Z
+  EXPECT_STREQ("EDT", new_york->get_parts(last_summer).abbreviation);
+  EXPECT_EQ(-14400, new_york->get_parts_local(last_summer).offset);
+  EXPECT_EQ(-18000, new_york->get_parts(253402300799).offset);
+}
+
+TEST(TimeZone, cursor_rule) {
+  auto const tz = get_time_zone("Europe/London");
+  TimeZone::Cursor cursor;
+
+  // Walk across the last transition and through the rule's transitions.
+  for (TimeOffset time = 2100000000; time < 2300000000; time += 3600) {
+    TimeZone::Cursor uncached;
+    auto const parts = tz->get_parts(time, cursor);
+    EXPECT_EQ(tz->get_parts(time, uncached).offset, parts.offset);
+    try {
+      auto const expected = tz->get_parts_local(time, uncached);
+      EXPECT_EQ(expected.offset, tz->get_parts_local(time, cursor).offset);
+    }
+    catch (NonexistentLocalTime const&) {
+      EXPECT_THROW(tz->get_parts_local(time, cursor), NonexistentLocalTime);
+    }
+  }
+  // Only transitions miss: two a year, for UTC and local lookups.
+  EXPECT_LT(cursor.get_misses(), 60u);
+}
+
+TEST(TimeZone, cursor_rule_end) {
+  // Past the rule's range, the last transition remains in effect, but the
+  // rule's transitions before then mustn't be cached with it.
+  auto const tz = get_time_zone("America/New_York");
+  TimeOffset const summer = 2225001600;  // 2040-07-04T08:00:00Z
+  TimeOffset const far    = 253418716800;  // 10000-07-09T00:00:00Z
+  TimeZone::Cursor cursor;
+  EXPECT_EQ(-14400, tz->get_parts(summer, cursor).offset);
+  EXPECT_EQ(-18000, tz->get_parts(far, cursor).offset);
+  EXPECT_EQ(-14400, tz->get_parts(summer, cursor).offset);
+  EXPECT_STREQ("EDT", tz->get_parts(summer, cursor).abbreviation);
+
+  EXPECT_EQ(-14400, tz->get_parts_local(summer, cursor).offset);
+  EXPECT_EQ(-18000, tz->get_parts_local(far, cursor).offset);
+  EXPECT_EQ(-14400, tz->get_parts_local(summer, cursor).offset);
+}
+
 // FIXME: Not general.
 TEST(TimeZone, DISABLED_get_system_time_zone) {
   auto const tz = get_system_time_zone();
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "aslib/xsys.hh"
+#include "cron/time_zone.hh"
+#include "cron/tzdb.hh"
+#include "gtest/gtest.h"
+
+using namespace aslib;
+using namespace cron;
+
+using std::string;
+
+//------------------------------------------------------------------------------
+
+namespace {
+
+/*
+ * Writes `data` to a new temporary file, and returns its name.
+ */
+fs::Filename
+write_temp(
+  string const& data)
+{
+  char name[] = "/tmp/tzdb-test-XXXXXX";
+  int const fd = xmkstemp(name);
+  xclose(fd);
+  std::ofstream file(name, std::ios::binary);
+  file.write(data.data(), data.size());
+  return fs::Filename(name);
+}
+
+
+/*
+ * Returns the offset for local time `t`, or TIME_ZONE_OFFSET_INVALID if there
+ * is no such local time.
+ */
+TimeZoneOffset
+get_local_offset(
+  TimeZone const& tz,
+  TimeOffset const t)
+{
+  try {
+    return tz.get_parts_local(t).offset;
+  }
+  catch (NonexistentLocalTime const&) {
+    return TIME_ZONE_OFFSET_INVALID;
+  }
+}
+
+
+std::vector<string> const
+NAMES = {
+  "US/Eastern",
+  "Europe/London",
+  "Asia/Kolkata",
+  "Australia/Lord_Howe",
+  "America/Sao_Paulo",
+  "UTC",
+};
+
+}  // anonymous namespace
+
+//------------------------------------------------------------------------------
+// Class TzDatabase.
+
+TEST(TzDatabase, get_time_zone) {
+  auto const zoneinfo_dir = get_zoneinfo_dir();
+  auto const filename = write_temp(TzDatabase::compile(zoneinfo_dir, NAMES));
+  TzDatabase const db(filename);
+  xunlink(filename);
+
+  auto names = NAMES;
+  std::sort(begin(names), end(names));
+  EXPECT_EQ(names, db.get_names());
+
+  for (auto const& name : NAMES) {
+    ASSERT_TRUE(db.contains(name));
+    auto const tz0 = TimeZone(
+      TzFile::load(find_time_zone_file(name, zoneinfo_dir)), name);
+    auto const tz1 = db.get_time_zone(name);
+    EXPECT_EQ(name, tz1.get_name());
+
+    // Lookups match those of the time zone loaded from the zoneinfo file.
+    for (TimeOffset t = -4000000000; t < 4000000000; t += 3599 * 7) {
+      auto const parts0 = tz0.get_parts(t);
+      auto const parts1 = tz1.get_parts(t);
+      EXPECT_EQ(parts0.offset, parts1.offset);
+      EXPECT_EQ(parts0.is_dst, parts1.is_dst);
+      EXPECT_STREQ(parts0.abbreviation, parts1.abbreviation);
+      EXPECT_EQ(get_local_offset(tz0, t), get_local_offset(tz1, t));
+    }
+  }
+}
+
+TEST(TzDatabase, compile_all) {
+  // The whole zoneinfo directory compiles, and each zone matches its file.
+  auto const zoneinfo_dir = get_zoneinfo_dir();
+  auto const names = get_time_zone_names(zoneinfo_dir);
+  std::vector<string> errors;
+  auto const filename 
+    = write_temp(TzDatabase::compile(zoneinfo_dir, names, &errors));
+  TzDatabase const db(filename);
+  xunlink(filename);
+  EXPECT_TRUE(errors.empty());
+
+  for (auto const& name : names) {
+    auto const tz0 = get_time_zone(name, zoneinfo_dir);
+    auto const tz1 = db.get_time_zone(name);
+    for (TimeOffset t = -4000000000; t < 4000000000; t += 86399 * 97) {
+      auto const parts0 = tz0.get_parts(t);
+      auto const parts1 = tz1.get_parts(t);
+      EXPECT_EQ(parts0.offset, parts1.offset) << name;
+      EXPECT_STREQ(parts0.abbreviation, parts1.abbreviation) << name;
+    }
+  }
+}
+
+TEST(TzDatabase, tzcompile) {
+  // The tzcompile tool builds a database of every zone in the directory.
+  auto const zoneinfo_dir = get_zoneinfo_dir();
+  auto const filename = write_temp("");
+  auto const command 
+    = string("../src/bin/tzcompile ") + zoneinfo_dir + " " + filename 
+      + " 2>/dev/null";
+  ASSERT_EQ(0, std::system(command.c_str()));
+  TzDatabase const db(filename);
+  xunlink(filename);
+
+  auto names = get_time_zone_names(zoneinfo_dir);
+  std::sort(begin(names), end(names));
+  EXPECT_EQ(names, db.get_names());
+  EXPECT_EQ(0, db.get_time_zone("Factory").get_parts((TimeOffset) 0).offset);
+}
+
+TEST(TzDatabase, lifetime) {
+  auto const filename 
+    = write_temp(TzDatabase::compile(get_zoneinfo_dir(), NAMES));
+  TimeZone tz;
+  {
+    // The time zone keeps the mapping alive.
+    TzDatabase const db(filename);
+    tz = db.get_time_zone("US/Eastern", 42);
+  }
+  xunlink(filename);
+  EXPECT_EQ(42, tz.get_id());
+  EXPECT_EQ(-18000, tz.get_parts((TimeOffset) 1451606400).offset);
+  EXPECT_EQ(-14400, tz.get_parts((TimeOffset) 1467331200).offset);
+}
+
+TEST(TzDatabase, errors) {
+  auto image = TzDatabase::compile(get_zoneinfo_dir(), NAMES);
+  {
+    auto const filename = write_temp(image);
+    TzDatabase const db(filename);
+    xunlink(filename);
+    EXPECT_FALSE(db.contains("US/Pacific"));
+    EXPECT_THROW(db.get_time_zone("US/Pacific"), ValueError);
+    EXPECT_THROW(db.get_time_zone(""), ValueError);
+  }
+
+  EXPECT_THROW(
+    TzDatabase::compile(get_zoneinfo_dir(), {"Nowhere/Special"}), 
+    ValueError);
+
+  // With an error list, time zones that fail to load are left out.
+  {
+    std::vector<string> errors;
+    auto const filename = write_temp(TzDatabase::compile(
+      get_zoneinfo_dir(), {"Nowhere/Special", "US/Eastern"}, &errors));
+    TzDatabase const db(filename);
+    xunlink(filename);
+    EXPECT_EQ(std::vector<string>{"US/Eastern"}, db.get_names());
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_EQ(0u, errors[0].find("Nowhere/Special: "));
+  }
+
+  // Bad magic.
+  {
+    auto bad = image;
+    bad[0] = 'X';
+    auto const filename = write_temp(bad);
+    EXPECT_THROW(TzDatabase{filename}, FormatError);
+    xunlink(filename);
+  }
+
+  // Truncated.
+  {
+    auto const filename = write_temp(image.substr(0, image.size() / 2));
+    EXPECT_THROW(TzDatabase{filename}, FormatError);
+    xunlink(filename);
+  }
+
+  // Empty.
+  {
+    auto const filename = write_temp("");
+    EXPECT_THROW(TzDatabase{filename}, FormatError);
+    xunlink(filename);
+  }
+
+  // The first zone record follows the 64-byte header; its entries offset is
+  // at 24 and its index shift at 60.  Entries are 24 bytes, with the
+  // transition first.
+  size_t const zone = 64;
+  uint64_t entries_offset;
+  memcpy(&entries_offset, &image[zone + 24], sizeof(entries_offset));
+
+  // Bad index shift.
+  for (int32_t const shift : {-1, 64}) {
+    auto bad = image;
+    memcpy(&bad[zone + 60], &shift, sizeof(shift));
+    auto const filename = write_temp(bad);
+    EXPECT_THROW(TzDatabase{filename}, FormatError);
+    xunlink(filename);
+  }
+
+  // Entries out of order.
+  {
+    auto bad = image;
+    auto const second = &bad[entries_offset + 24];
+    std::swap_ranges(&bad[entries_offset], &bad[entries_offset + 8], second);
+    auto const filename = write_temp(bad);
+    TzDatabase const db(filename);
+    xunlink(filename);
+    EXPECT_THROW(db.get_time_zone(NAMES[4]), FormatError);
+    EXPECT_NO_THROW(db.get_time_zone(NAMES[0]));
+  }
+
+  // Unterminated abbreviation.
+  {
+    auto bad = image;
+    memset(&bad[entries_offset + 8 + 4], 'X', 7);
+    auto const filename = write_temp(bad);
+    TzDatabase const db(filename);
+    xunlink(filename);
+    EXPECT_THROW(db.get_time_zone(NAMES[4]), FormatError);
+  }
+}
+